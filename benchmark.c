@@ -19,6 +19,7 @@
 
 #include "module.h"
 #include "device.h"
+#include "page.h"
 
 #ifdef USE_LEGACY_RANDOM
 #pragma message "Disable linux kernel supported random generator"
@@ -78,6 +79,8 @@ struct benchmark_parameter {
 
 	size_t block_sz;
 	size_t nr_blocks;
+	size_t flush_interval; /**< flush per this number of writes (0: off) */
+	int cache_policy; /**< replacement policy of the read cache */
 
 	char device_path[DEVICE_PATH_SIZE];
 
@@ -111,6 +114,8 @@ static void *write_data(void *);
 static void *read_data(void *);
 
 static void report_result(struct benchmark_parameter *parm);
+static void report_open_time(struct page_ftl *pgftl, int stage,
+			     uint64_t elapsed_ns, void *data);
 
 int main(int argc, char **argv)
 {
@@ -131,6 +136,14 @@ int main(int argc, char **argv)
 	path = parm->device_path;
 
 	g_assert(module_init(module, &flash, (uint64_t)device) == 0);
+	if (module == PAGE_FTL_MODULE) {
+		g_assert(page_ftl_set_cache_policy(
+				 (struct page_ftl *)flash->f_private,
+				 parm->cache_policy) == 0);
+		g_assert(page_ftl_set_open_hook(
+				 (struct page_ftl *)flash->f_private,
+				 report_open_time, NULL) == 0);
+	}
 	g_assert(flash->f_op->open(flash, path, O_CREAT | O_RDWR) == 0);
 	parm->flash = flash;
 
@@ -228,7 +241,7 @@ static void help_message(struct benchmark_parameter *parm, char **argv)
 	char *device_path = parm->device_path;
 
 	fprintf(stderr,
-		"%s -m <module name> -d <device name> -t <workload> -j <# of jobs> -b <block size(bytes)> -n <# of blocks> -p <device path>\n",
+		"%s -m <module name> -d <device name> -t <workload> -j <# of jobs> -b <block size(bytes)> -n <# of blocks> -p <device path> -f <flush interval> -c <cache policy>\n",
 		argv[0]);
 	fprintf(stderr, "\t- modules     [");
 	print_list(stderr, module_str);
@@ -244,6 +257,9 @@ static void help_message(struct benchmark_parameter *parm, char **argv)
 	fprintf(stderr, "\t- # of block  (default: %zu)\n", nr_blocks);
 	fprintf(stderr, "\t- path        (default: %s)\n",
 		strlen(device_path) > 0 ? device_path : NULL);
+	fprintf(stderr, "\t- flush       (default: 0, no flush)\n");
+	fprintf(stderr, "\t- cache       (default: %s)\n",
+		cache_get_policy_name(PAGE_FTL_CACHE_POLICY));
 }
 
 static void processing_parameters_error(char ch)
@@ -256,6 +272,8 @@ static void processing_parameters_error(char ch)
 	case 'n':
 	case 'b':
 	case 'p':
+	case 'f':
+	case 'c':
 		fprintf(stderr, "option -%c requires an arguments\n", ch);
 		break;
 	default:
@@ -341,6 +359,8 @@ static struct benchmark_parameter *init_parameters(int argc, char **argv)
 
 	size_t block_sz = (size_t)PAGE_SIZE;
 	size_t nr_blocks = (size_t)1;
+	size_t flush_interval = 0;
+	int cache_policy = PAGE_FTL_CACHE_POLICY;
 
 	char *device_path;
 
@@ -355,7 +375,7 @@ static struct benchmark_parameter *init_parameters(int argc, char **argv)
 	memset(device_path, 0, (size_t)(DEVICE_PATH_SIZE - 1));
 	nr_jobs = (int)g_get_num_processors();
 
-	while ((c = getopt(argc, argv, "m:d:t:j:b:n:p:h")) != -1) {
+	while ((c = getopt(argc, argv, "m:d:t:j:b:n:p:f:c:h")) != -1) {
 		switch (c) {
 		case 'm':
 			module_idx = get_index_from_list(module_str);
@@ -401,6 +421,19 @@ static struct benchmark_parameter *init_parameters(int argc, char **argv)
 		case 'p':
 			strncpy(device_path, optarg, DEVICE_PATH_SIZE - 1);
 			break;
+		case 'f':
+			flush_interval = (size_t)atoi(optarg);
+			break;
+		case 'c':
+			cache_policy = cache_get_policy(optarg);
+			if (cache_policy < 0) {
+				fprintf(stderr,
+					"error: unexpected argument detected (%s)\n",
+					optarg);
+				help_message(parm, argv);
+				exit(1);
+			}
+			break;
 		case 'h':
 			help_message(parm, argv);
 			exit(0);
@@ -422,6 +455,8 @@ static struct benchmark_parameter *init_parameters(int argc, char **argv)
 
 	parm->block_sz = block_sz;
 	parm->nr_blocks = nr_blocks;
+	parm->flush_interval = flush_interval;
+	parm->cache_policy = cache_policy;
 
 	/* initialize the crc32 list */
 	parm->crc32_list =
@@ -478,6 +513,9 @@ static void print_parameters(const struct benchmark_parameter *parm)
 	printf("\t- io size     %zuMiB\n",
 	       (parm->nr_blocks * parm->block_sz) >> 20);
 	printf("\t- path        %s\n", path);
+	printf("\t- flush       %zu\n", parm->flush_interval);
+	printf("\t- cache       %s\n",
+	       cache_get_policy_name(parm->cache_policy));
 }
 
 static void free_parameters(struct benchmark_parameter *parm)
@@ -590,8 +628,13 @@ static void *write_data(void *data)
 #endif
 		clock_gettime(CLOCK_MONOTONIC, &start);
 		ret = flash->f_op->write(flash, buffer, parm->block_sz, offset);
-		clock_gettime(CLOCK_MONOTONIC, &end);
 		g_assert(ret == (ssize_t)parm->block_sz);
+		if (parm->flush_interval &&
+		    (size_t)(i + 1) % parm->flush_interval == 0) {
+			g_assert(flash->f_op->ioctl(flash,
+						    PAGE_FTL_IOCTL_FLUSH) == 0);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
 		interval = (gsize)((end.tv_sec - start.tv_sec) * SEC_TO_NS) +
 			   (unsigned long)(end.tv_nsec - start.tv_nsec);
 		parm->total_time[thread_id] += interval;
@@ -662,6 +705,15 @@ static void *read_data(void *data)
 	return NULL;
 }
 
+static void report_open_time(struct page_ftl *pgftl, int stage,
+			     uint64_t elapsed_ns, void *data)
+{
+	(void)pgftl;
+	(void)data;
+	printf("open %-10s: %10.3lf ms\n", page_ftl_get_open_stage_name(stage),
+	       (double)elapsed_ns / NS_PER_MS);
+}
+
 static void report_result(struct benchmark_parameter *parm)
 {
 	GList *node;
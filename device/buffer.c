@@ -0,0 +1,268 @@
+/**
+ * @file buffer.c
+ * @brief pool of the aligned page buffers shared by the FTL and devices
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ */
+#include "device.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <glib.h>
+
+/**
+ * @brief each thread's cache of the free page buffers
+ *
+ * @note
+ * A free buffer keeps the next free buffer's pointer in its first bytes.
+ */
+struct device_buffer_cache {
+	void *head;
+	size_t nr_buffers;
+	int is_registered; /**< thread exit hook is registered */
+};
+
+static __thread struct device_buffer_cache buffer_cache;
+
+static void *buffer_pool; /**< buffers flushed from the threads' caches */
+static uint64_t buffer_pool_misses;
+
+static pthread_mutex_t buffer_slab_mutex = PTHREAD_MUTEX_INITIALIZER;
+static GList *buffer_slabs; /**< every slab allocated for the pool */
+
+static pthread_key_t buffer_cache_key;
+static pthread_once_t buffer_cache_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief distance between the buffers in a slab
+ */
+#define DEVICE_BUFFER_STRIDE                                                   \
+	((DEVICE_PAGE_SIZE + DEVICE_BUFFER_ALIGN - 1) &                        \
+	 ~((size_t)DEVICE_BUFFER_ALIGN - 1))
+
+static inline void *device_buffer_next(void *buffer)
+{
+	return *(void **)buffer;
+}
+
+static inline void device_buffer_set_next(void *buffer, void *next)
+{
+	*(void **)buffer = next;
+}
+
+/**
+ * @brief push the chain of the buffers to the shared pool
+ *
+ * @param head first buffer of the chain
+ * @param tail last buffer of the chain
+ */
+static void device_buffer_pool_push(void *head, void *tail)
+{
+	void *old;
+
+	old = __atomic_load_n(&buffer_pool, __ATOMIC_RELAXED);
+	do {
+		device_buffer_set_next(tail, old);
+	} while (!__atomic_compare_exchange_n(&buffer_pool, &old, head, true,
+					      __ATOMIC_RELEASE,
+					      __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief return the exiting thread's cache to the shared pool
+ *
+ * @param data pointer of the thread's cache
+ */
+static void device_buffer_cache_exit(void *data)
+{
+	struct device_buffer_cache *cache = (struct device_buffer_cache *)data;
+	void *tail = cache->head;
+
+	if (tail == NULL) {
+		return;
+	}
+	while (device_buffer_next(tail)) {
+		tail = device_buffer_next(tail);
+	}
+	device_buffer_pool_push(cache->head, tail);
+	cache->head = NULL;
+	cache->nr_buffers = 0;
+}
+
+static void device_buffer_cache_key_init(void)
+{
+	pthread_key_create(&buffer_cache_key, device_buffer_cache_exit);
+}
+
+/**
+ * @brief register the thread exit hook of the thread's cache
+ *
+ * @param cache pointer of the thread's cache
+ */
+static inline void
+device_buffer_cache_register(struct device_buffer_cache *cache)
+{
+	if (cache->is_registered) {
+		return;
+	}
+	pthread_once(&buffer_cache_once, device_buffer_cache_key_init);
+	pthread_setspecific(buffer_cache_key, (void *)cache);
+	cache->is_registered = 1;
+}
+
+/**
+ * @brief allocate a new slab and fill the thread's cache with its buffers
+ *
+ * @param cache pointer of the thread's cache
+ *
+ * @return 0 for success, negative number for fail
+ */
+static int device_buffer_cache_grow(struct device_buffer_cache *cache)
+{
+	size_t nr_buffers = DEVICE_BUFFER_SLAB_SIZE / DEVICE_BUFFER_STRIDE;
+	char *slab;
+	size_t i;
+	int ret;
+
+	ret = posix_memalign((void **)&slab, DEVICE_BUFFER_SLAB_SIZE,
+			     DEVICE_BUFFER_SLAB_SIZE);
+	if (ret) {
+		pr_err("slab allocation failed\n");
+		return -ret;
+	}
+#ifdef DEVICE_USE_HUGEPAGE_BUFFER
+	if (madvise(slab, DEVICE_BUFFER_SLAB_SIZE, MADV_HUGEPAGE)) {
+		pr_warn("transparent hugepage is not available\n");
+	}
+#endif
+	pthread_mutex_lock(&buffer_slab_mutex);
+	buffer_slabs = g_list_prepend(buffer_slabs, slab);
+	pthread_mutex_unlock(&buffer_slab_mutex);
+
+	for (i = 0; i < nr_buffers; i++) {
+		void *buffer = &slab[i * DEVICE_BUFFER_STRIDE];
+		device_buffer_set_next(buffer, cache->head);
+		cache->head = buffer;
+	}
+	cache->nr_buffers += nr_buffers;
+	return 0;
+}
+
+/**
+ * @brief allocate a page buffer
+ *
+ * @param dev pointer of the device structure
+ * @param flags DEVICE_BUFFER_ZERO to clear the buffer
+ *
+ * @return pointer of the buffer aligned to DEVICE_BUFFER_ALIGN, NULL for fail
+ *
+ * @note
+ * The buffer comes from the thread's cache, then the shared pool, then a
+ * new slab (counted as the pool miss). The content is not cleared unless
+ * DEVICE_BUFFER_ZERO is given.
+ */
+void *device_alloc_buffer(struct device *dev, uint64_t flags)
+{
+	struct device_buffer_cache *cache = &buffer_cache;
+	size_t page_size = device_get_page_size(dev);
+	void *buffer;
+
+	if (page_size != DEVICE_PAGE_SIZE) {
+		/** not a size of the pool */
+		if (posix_memalign(&buffer, DEVICE_BUFFER_ALIGN, page_size)) {
+			pr_err("buffer allocation failed\n");
+			return NULL;
+		}
+		goto out;
+	}
+
+	if (cache->head == NULL) {
+		void *list;
+		size_t nr_buffers = 0;
+		device_buffer_cache_register(cache);
+		list = __atomic_exchange_n(&buffer_pool, NULL,
+					   __ATOMIC_ACQUIRE);
+		for (buffer = list; buffer;
+		     buffer = device_buffer_next(buffer)) {
+			nr_buffers++;
+		}
+		cache->head = list;
+		cache->nr_buffers = nr_buffers;
+	}
+	if (cache->head == NULL) {
+		__atomic_fetch_add(&buffer_pool_misses, 1, __ATOMIC_RELAXED);
+		if (device_buffer_cache_grow(cache)) {
+			return NULL;
+		}
+	}
+
+	buffer = cache->head;
+	cache->head = device_buffer_next(buffer);
+	cache->nr_buffers--;
+out:
+	if (flags & DEVICE_BUFFER_ZERO) {
+		memset(buffer, 0, page_size);
+	}
+	return buffer;
+}
+
+/**
+ * @brief free the page buffer
+ *
+ * @param dev pointer of the device structure
+ * @param buffer buffer which is allocated by `device_alloc_buffer()`
+ *
+ * @note
+ * The buffer is kept in the thread's cache. When the cache grows twice of
+ * its size, the older buffers move to the shared pool.
+ */
+void device_free_buffer(struct device *dev, void *buffer)
+{
+	struct device_buffer_cache *cache = &buffer_cache;
+
+	if (buffer == NULL) {
+		return;
+	}
+	if (device_get_page_size(dev) != DEVICE_PAGE_SIZE) {
+		free(buffer);
+		return;
+	}
+
+	device_buffer_cache_register(cache);
+	device_buffer_set_next(buffer, cache->head);
+	cache->head = buffer;
+	cache->nr_buffers++;
+	if (cache->nr_buffers > 2 * DEVICE_BUFFER_CACHE_SIZE) {
+		void *last, *head, *tail;
+		size_t i;
+
+		/** newly freed buffers are warm; keep them in this thread */
+		last = cache->head;
+		for (i = 1; i < DEVICE_BUFFER_CACHE_SIZE; i++) {
+			last = device_buffer_next(last);
+		}
+		head = tail = device_buffer_next(last);
+		while (device_buffer_next(tail)) {
+			tail = device_buffer_next(tail);
+		}
+		device_buffer_set_next(last, NULL);
+		cache->nr_buffers = DEVICE_BUFFER_CACHE_SIZE;
+		device_buffer_pool_push(head, tail);
+	}
+}
+
+/**
+ * @brief get the number of the slab allocations of the buffer pool
+ *
+ * @return number of the pool misses
+ */
+uint64_t device_get_buffer_pool_misses(void)
+{
+	return __atomic_load_n(&buffer_pool_misses, __ATOMIC_RELAXED);
+}
@@ -51,17 +51,100 @@ static int (*submodule_init[])(struct device *, uint64_t) = {
 };
 
 /**
- * @brief dynamic allocate the device request
+ * @brief each thread's cache of the free requests
+ */
+struct device_request_cache {
+	struct device_request *head;
+	size_t nr_requests;
+	int is_registered; /**< thread exit hook is registered */
+};
+
+static __thread struct device_request_cache request_cache;
+
+/**
+ * @brief free requests which are flushed from the threads' caches
  *
- * @param flags flags for allocate the device request
+ * @note
+ * Threads push to this list with CAS and take the whole list with the
+ * exchange, so it is lock-free and free from the ABA problem.
+ */
+static struct device_request *request_pool;
+static uint64_t request_pool_misses;
+
+static pthread_key_t request_cache_key;
+static pthread_once_t request_cache_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief push the chain of the requests to the shared pool
+ *
+ * @param head first request of the chain
+ * @param tail last request of the chain
+ */
+static void device_request_pool_push(struct device_request *head,
+				     struct device_request *tail)
+{
+	struct device_request *old;
+
+	old = __atomic_load_n(&request_pool, __ATOMIC_RELAXED);
+	do {
+		tail->pool_next = old;
+	} while (!__atomic_compare_exchange_n(&request_pool, &old, head, true,
+					      __ATOMIC_RELEASE,
+					      __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief return the exiting thread's cache to the shared pool
+ *
+ * @param data pointer of the thread's cache
+ */
+static void device_request_cache_exit(void *data)
+{
+	struct device_request_cache *cache =
+		(struct device_request_cache *)data;
+	struct device_request *tail = cache->head;
+
+	if (tail == NULL) {
+		return;
+	}
+	while (tail->pool_next) {
+		tail = tail->pool_next;
+	}
+	device_request_pool_push(cache->head, tail);
+	cache->head = NULL;
+	cache->nr_requests = 0;
+}
+
+static void device_request_cache_key_init(void)
+{
+	pthread_key_create(&request_cache_key, device_request_cache_exit);
+}
+
+/**
+ * @brief register the thread exit hook of the thread's cache
+ *
+ * @param cache pointer of the thread's cache
+ */
+static inline void
+device_request_cache_register(struct device_request_cache *cache)
+{
+	if (cache->is_registered) {
+		return;
+	}
+	pthread_once(&request_cache_once, device_request_cache_key_init);
+	pthread_setspecific(request_cache_key, (void *)cache);
+	cache->is_registered = 1;
+}
+
+/**
+ * @brief allocate the new request from the heap
  *
  * @return device_request pointer when it is allocated or NULL when it is not allocated
  */
-struct device_request *device_alloc_request(uint64_t flags)
+static struct device_request *device_new_request(void)
 {
 	struct device_request *request;
 	int ret = 0;
-	(void)flags;
 
 	request =
 		(struct device_request *)malloc(sizeof(struct device_request));
@@ -73,6 +156,7 @@ struct device_request *device_alloc_request(uint64_t flags)
 	ret = pthread_mutex_init(&request->mutex, NULL);
 	if (ret) {
 		pr_err("pthread mutex initialize failed\n");
+		free(request);
 		errno = ret;
 		return NULL;
 	}
@@ -80,12 +164,61 @@ struct device_request *device_alloc_request(uint64_t flags)
 	ret = pthread_cond_init(&request->cond, NULL);
 	if (ret) {
 		pr_err("pthread conditional variable initialize failed\n");
+		pthread_mutex_destroy(&request->mutex);
+		free(request);
 		errno = ret;
 		return NULL;
 	}
+	return request;
+}
 
-	g_atomic_int_set(&request->is_finish, 0);
+/**
+ * @brief allocate the device request
+ *
+ * @param flags flags for allocate the device request
+ *
+ * @return device_request pointer when it is allocated or NULL when it is not allocated
+ *
+ * @note
+ * The request comes from the thread's cache. When the cache is empty, the
+ * cache takes all requests in the shared pool. The heap is used only when
+ * both are empty (counted as the pool miss).
+ */
+struct device_request *device_alloc_request(uint64_t flags)
+{
+	struct device_request_cache *cache = &request_cache;
+	struct device_request *request;
+	(void)flags;
+
+	if (cache->head == NULL) {
+		struct device_request *list;
+		device_request_cache_register(cache);
+		list = __atomic_exchange_n(&request_pool, NULL,
+					   __ATOMIC_ACQUIRE);
+		for (request = list; request; request = request->pool_next) {
+			cache->nr_requests++;
+		}
+		cache->head = list;
+	}
 
+	request = cache->head;
+	if (request == NULL) {
+		__atomic_fetch_add(&request_pool_misses, 1, __ATOMIC_RELAXED);
+		return device_new_request();
+	}
+	cache->head = request->pool_next;
+	cache->nr_requests--;
+
+	/** the mutex and the cond are kept initialized in the pool */
+	request->flag = 0;
+	request->data_len = 0;
+	request->sector = 0;
+	request->paddr.lpn = 0;
+	request->data = NULL;
+	request->end_rq = NULL;
+	request->rq_private = NULL;
+	request->pool_next = NULL;
+	g_atomic_int_set(&request->is_finish, 0);
 	return request;
 }
 
@@ -93,12 +226,47 @@ struct device_request *device_alloc_request(uint64_t flags)
  * @brief free pre-allocated device_request resource
  *
  * @param request pointer of the device request
+ *
+ * @note
+ * The request is kept in the thread's cache. When the cache grows twice
+ * of its size, the older requests move to the shared pool for the other
+ * threads (e.g., the submitter of a request freed by the worker).
  */
 void device_free_request(struct device_request *request)
 {
-	pthread_cond_destroy(&request->cond);
-	pthread_mutex_destroy(&request->mutex);
-	free(request);
+	struct device_request_cache *cache = &request_cache;
+
+	device_request_cache_register(cache);
+	request->pool_next = cache->head;
+	cache->head = request;
+	cache->nr_requests++;
+	if (cache->nr_requests > 2 * DEVICE_REQUEST_CACHE_SIZE) {
+		struct device_request *last, *head, *tail;
+		size_t i;
+
+		/** newly freed requests are warm; keep them in this thread */
+		last = cache->head;
+		for (i = 1; i < DEVICE_REQUEST_CACHE_SIZE; i++) {
+			last = last->pool_next;
+		}
+		head = tail = last->pool_next;
+		while (tail->pool_next) {
+			tail = tail->pool_next;
+		}
+		last->pool_next = NULL;
+		cache->nr_requests = DEVICE_REQUEST_CACHE_SIZE;
+		device_request_pool_push(head, tail);
+	}
+}
+
+/**
+ * @brief get the number of the request allocations served by the heap
+ *
+ * @return number of the pool misses
+ */
+uint64_t device_get_request_pool_misses(void)
+{
+	return __atomic_load_n(&request_pool_misses, __ATOMIC_RELAXED);
 }
 
 /**
@@ -12,6 +12,7 @@
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/mman.h>
 
 #include "flash.h"
 #include "ramdisk.h"
@@ -58,13 +59,15 @@ int ramdisk_open(struct device *dev, const char *name, int flags)
 	ramdisk->o_flags = flags;
 
 	pr_info("ramdisk generated (size: %zu bytes)\n", ramdisk->size);
-	buffer = (char *)malloc(ramdisk->size);
-	if (buffer == NULL) {
-		pr_err("memory allocation failed\n");
+	/** the pages are faulted in by the first write of each page */
+	buffer = (char *)mmap(NULL, ramdisk->size, PROT_READ | PROT_WRITE,
+			      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1,
+			      0);
+	if (buffer == MAP_FAILED) {
+		pr_err("memory mapping failed (errno: %d)\n", errno);
 		ret = -ENOMEM;
 		goto exception;
 	}
-	memset(buffer, 0, ramdisk->size);
 	ramdisk->buffer = buffer;
 
 	bitmap_size = (size_t)BITS_TO_UINT64_ALIGN(ramdisk->size / page->size);
@@ -136,13 +139,13 @@ ssize_t ramdisk_write(struct device *dev, struct device_request *request)
 		goto exit;
 	}
 
-	is_used = get_bit(ramdisk->is_used, addr.lpn);
+	/** the neighbor pages of the word can be written concurrently */
+	is_used = test_and_set_bit_atomic(ramdisk->is_used, addr.lpn);
 	if (is_used == 1) {
 		pr_err("you overwrite the already written page\n");
 		ret = -EINVAL;
 		goto exit;
 	}
-	set_bit(ramdisk->is_used, addr.lpn);
 	memcpy(&ramdisk->buffer[addr.lpn * page_size], request->data,
 	       request->data_len);
 	ret = (ssize_t)request->data_len;
@@ -197,8 +200,13 @@ ssize_t ramdisk_read(struct device *dev, struct device_request *request)
 		goto exit;
 	}
 
-	memcpy(request->data, &ramdisk->buffer[addr.lpn * page_size],
-	       request->data_len);
+	if (get_bit_atomic(ramdisk->is_used, addr.lpn)) {
+		memcpy(request->data, &ramdisk->buffer[addr.lpn * page_size],
+		       request->data_len);
+	} else {
+		/** erased page never touches (or faults in) the buffer */
+		memset(request->data, 0, request->data_len);
+	}
 	ret = (ssize_t)request->data_len;
 	pr_debug("request->end_rq %p %p\n", request->end_rq,
 		 &((struct device_request *)request->rq_private)->mutex);
@@ -209,6 +217,38 @@ exit:
 	return ret;
 }
 
+/**
+ * @brief clear the used bits of the pages
+ *
+ * @param ramdisk pointer of the ramdisk structure
+ * @param start first page number
+ * @param nr_pages the number of the pages
+ *
+ * @note
+ * The bits are cleared word by word. The word can be shared with the other
+ * segment, so the atomic operation is used.
+ */
+static void ramdisk_clear_used(struct ramdisk *ramdisk, uint64_t start,
+			       uint64_t nr_pages)
+{
+	uint64_t end = start + nr_pages;
+
+	while (start < end) {
+		uint64_t word = BITS_TO_UINT64(start);
+		uint64_t offset = start % BITS_PER_UINT64;
+		uint64_t nr_bits = BITS_PER_UINT64 - offset;
+		uint64_t mask;
+
+		nr_bits = nr_bits < end - start ? nr_bits : end - start;
+		mask = nr_bits == BITS_PER_UINT64 ?
+			       (uint64_t)UINT64_MAX :
+			       (((uint64_t)0x1 << nr_bits) - 1) << offset;
+		__atomic_fetch_and(&ramdisk->is_used[word], ~mask,
+				   __ATOMIC_ACQ_REL);
+		start += nr_bits;
+	}
+}
+
 /**
  * @brief erase a segment
  *
@@ -216,6 +256,10 @@ exit:
  * @param request pointer of the device request structure
  *
  * @return 0 for success, negative value for fail
+ *
+ * @note
+ * The data is not cleared; the pages are read as zero until they are
+ * written again (see `ramdisk_read()`).
  */
 int ramdisk_erase(struct device *dev, struct device_request *request)
 {
@@ -223,7 +267,6 @@ int ramdisk_erase(struct device *dev, struct device_request *request)
 	struct device_address addr;
 	size_t page_size;
 	uint32_t nr_pages_per_segment;
-	uint32_t lpn;
 	uint16_t segnum;
 	int ret;
 
@@ -240,10 +283,16 @@ int ramdisk_erase(struct device *dev, struct device_request *request)
 	page_size = device_get_page_size(dev);
 	nr_pages_per_segment = (uint32_t)device_get_pages_per_segment(dev);
 	addr.format.block = segnum;
-	for (lpn = addr.lpn; lpn < addr.lpn + nr_pages_per_segment; lpn++) {
-		memset(&ramdisk->buffer[lpn * page_size], 0, page_size);
-		reset_bit(ramdisk->is_used, lpn);
+	ramdisk_clear_used(ramdisk, addr.lpn, nr_pages_per_segment);
+#if RAMDISK_DISCARD_ON_ERASE
+	if (madvise(&ramdisk->buffer[(size_t)addr.lpn * page_size],
+		    nr_pages_per_segment * page_size, MADV_DONTNEED)) {
+		pr_warn("discard the segment failed (segnum: %u, errno: %d)\n",
+			segnum, errno);
 	}
+#else
+	(void)page_size;
+#endif
 
 	if (request->end_rq) {
 		request->end_rq(request);
@@ -271,7 +320,7 @@ int ramdisk_close(struct device *dev)
 		return 0;
 	}
 	if (ramdisk->buffer != NULL) {
-		free(ramdisk->buffer);
+		munmap(ramdisk->buffer, ramdisk->size);
 		ramdisk->buffer = NULL;
 	}
 	if (ramdisk->is_used != NULL) {
@@ -316,6 +365,7 @@ int ramdisk_device_init(struct device *dev, uint64_t flags)
 	ramdisk->buffer = NULL;
 	ramdisk->size = 0;
 	dev->d_op = &__ramdisk_dops;
+	dev->d_flags = DEVICE_SYNC_COMPLETION | DEVICE_LOW_LATENCY;
 	dev->d_private = (void *)ramdisk;
 	dev->d_submodule_exit = ramdisk_device_exit;
 
@@ -319,6 +319,7 @@ int raspberry_device_init(struct device *dev, uint64_t flags)
 	}
 	raspberry->size = 0;
 	dev->d_op = &__raspberry_dops;
+	dev->d_flags = DEVICE_SYNC_COMPLETION;
 	dev->d_private = (void *)raspberry;
 	dev->d_submodule_exit = raspberry_device_exit;
 
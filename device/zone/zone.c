@@ -170,10 +170,10 @@ ssize_t zone_write(struct device *dev, struct device_request *request)
 	size_t page_size = device_get_page_size(dev);
 	ssize_t ret = 0;
 	uint64_t zone_num;
-	char *buffer;
+	char *buffer, *bounce;
 
 	meta = (struct zone_meta *)dev->d_private;
-	buffer = NULL;
+	buffer = bounce = NULL;
 
 	if (request->data == NULL) {
 		pr_err("you do not pass the data pointer to NULL\n");
@@ -197,14 +197,19 @@ ssize_t zone_write(struct device *dev, struct device_request *request)
 		ret = -EINVAL;
 		goto exit;
 	}
-	ret = posix_memalign((void **)&buffer, sysconf(_SC_PAGESIZE),
-			     device_get_page_size(dev));
-	if (ret) {
-		pr_err("buffer allocation failed\n");
-		buffer = NULL;
-		goto exit;
+	if (device_is_aligned_buffer(request->data)) {
+		buffer = (char *)request->data;
+	} else {
+		bounce = (char *)device_alloc_buffer(dev,
+						     DEVICE_BUFFER_DEFAULT);
+		if (bounce == NULL) {
+			pr_err("buffer allocation failed\n");
+			ret = -ENOMEM;
+			goto exit;
+		}
+		memcpy(bounce, request->data, request->data_len);
+		buffer = bounce;
 	}
-	memcpy(buffer, request->data, request->data_len);
 	zone_num = zone_get_zone_number(dev, request->paddr);
 	if (zone_num >= meta->nr_zones) {
 		pr_err("invalid address value detected (lpn: %u)\n",
@@ -244,9 +249,7 @@ ssize_t zone_write(struct device *dev, struct device_request *request)
 		request->end_rq(request);
 	}
 exit:
-	if (buffer) {
-		free(buffer);
-	}
+	device_free_buffer(dev, bounce);
 	return ret;
 }
 
@@ -264,10 +267,10 @@ ssize_t zone_read(struct device *dev, struct device_request *request)
 	size_t page_size;
 	ssize_t ret = 0;
 	uint64_t zone_num;
-	char *buffer;
+	char *buffer, *bounce;
 
 	meta = (struct zone_meta *)dev->d_private;
-	buffer = NULL;
+	buffer = bounce = NULL;
 
 	if (request->data == NULL) {
 		pr_err("NULL data pointer detected\n");
@@ -300,25 +303,29 @@ ssize_t zone_read(struct device *dev, struct device_request *request)
 		ret = -EINVAL;
 		goto exit;
 	}
-	ret = posix_memalign((void **)&buffer, sysconf(_SC_PAGESIZE),
-			     device_get_page_size(dev));
-	if (ret) {
-		pr_err("buffer allocation failed\n");
-		buffer = NULL;
-		goto exit;
+	if (device_is_aligned_buffer(request->data)) {
+		buffer = (char *)request->data;
+	} else {
+		bounce = (char *)device_alloc_buffer(dev,
+						     DEVICE_BUFFER_DEFAULT);
+		if (bounce == NULL) {
+			pr_err("buffer allocation failed\n");
+			ret = -ENOMEM;
+			goto exit;
+		}
+		buffer = bounce;
 	}
-	memset(buffer, 0, page_size);
 	ret = zone_do_rw(meta->read.fd, request->flag, buffer,
 			 request->data_len,
 			 (off_t)request->paddr.lpn * page_size);
-	memcpy(request->data, buffer, page_size);
+	if (bounce) {
+		memcpy(request->data, bounce, page_size);
+	}
 	if (request && request->end_rq) {
 		request->end_rq(request);
 	}
 exit:
-	if (buffer) {
-		free(buffer);
-	}
+	device_free_buffer(dev, bounce);
 	return ret;
 }
 
@@ -429,6 +436,7 @@ int zone_device_init(struct device *dev, uint64_t flags)
 	dev->d_private = (void *)meta;
 	dev->d_submodule_exit = zone_device_exit;
 	dev->d_op = &__zone_dops;
+	dev->d_flags = DEVICE_SYNC_COMPLETION;
 
 	return ret;
 exception:
@@ -0,0 +1,80 @@
+#include <assert.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+
+#include "module.h"
+#include "flash.h"
+#include "page.h"
+#include "log.h"
+#include "device.h"
+
+#define QUEUE_DEPTH (32)
+#define BLOCK_SIZE (8192)
+#define NR_BLOCKS (8192)
+
+static struct flash_io ios[QUEUE_DEPTH];
+static char buffers[QUEUE_DEPTH][BLOCK_SIZE];
+
+/* keep QUEUE_DEPTH I/Os in flight from this thread */
+static void run(struct flash_device *flash, unsigned int opcode)
+{
+	struct flash_io *done[QUEUE_DEPTH];
+	size_t submitted = 0, completed = 0;
+	size_t i;
+
+	for (i = 0; i < QUEUE_DEPTH && submitted < NR_BLOCKS; i++) {
+		struct flash_io *io = &ios[i];
+		memset(io, 0, sizeof(*io));
+		io->opcode = opcode;
+		io->buffer = buffers[i];
+		io->count = BLOCK_SIZE;
+		io->offset = (off_t)(submitted * BLOCK_SIZE);
+		if (opcode == FLASH_IO_WRITE) {
+			*(size_t *)io->buffer = submitted;
+		}
+		assert(0 == flash->f_op->submit(flash, io));
+		submitted++;
+	}
+
+	while (completed < NR_BLOCKS) {
+		int nr = flash->f_op->poll(flash, done, 1, QUEUE_DEPTH);
+		assert(nr > 0);
+		for (i = 0; i < (size_t)nr; i++) {
+			struct flash_io *io = done[i];
+			size_t block = (size_t)io->offset / BLOCK_SIZE;
+			assert(io->ret == BLOCK_SIZE);
+			if (opcode == FLASH_IO_READ) {
+				assert(*(size_t *)io->buffer == block);
+			}
+			completed++;
+			if (submitted == NR_BLOCKS) {
+				continue;
+			}
+			/* reuse the completed descriptor */
+			io->offset = (off_t)(submitted * BLOCK_SIZE);
+			if (opcode == FLASH_IO_WRITE) {
+				*(size_t *)io->buffer = submitted;
+			}
+			assert(0 == flash->f_op->submit(flash, io));
+			submitted++;
+		}
+	}
+}
+
+int main(void)
+{
+	struct flash_device *flash = NULL;
+	assert(0 == module_init(PAGE_FTL_MODULE, &flash, RAMDISK_MODULE));
+	pr_info("module initialize\n");
+	flash->f_op->open(flash, NULL, O_CREAT | O_RDWR);
+	run(flash, FLASH_IO_WRITE);
+	pr_info("%d blocks written\n", NR_BLOCKS);
+	run(flash, FLASH_IO_READ);
+	pr_info("%d blocks read and verified\n", NR_BLOCKS);
+	flash->f_op->close(flash);
+	assert(0 == module_exit(flash));
+	pr_info("module deallcation\n");
+
+	return 0;
+}
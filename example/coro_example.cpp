@@ -0,0 +1,68 @@
+#include <assert.h>
+#include <string.h>
+#include <fcntl.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "module.h"
+#include "flash.h"
+#include "flash-coro.h"
+#include "log.h"
+
+#define BLOCK_SIZE (4096)
+#define NR_TASKS (16384)
+#define NR_THREADS (2)
+
+static std::atomic<size_t> nr_verified(0);
+
+/* write a block and read it back; every task is in flight at once */
+static ftl::task<> write_and_verify(ftl::executor &ex, size_t block)
+{
+	std::vector<char> buffer(BLOCK_SIZE, 0);
+	off_t offset = (off_t)(block * BLOCK_SIZE);
+	ssize_t ret;
+
+	*(size_t *)buffer.data() = block;
+	ret = co_await ex.write(buffer.data(), BLOCK_SIZE, offset);
+	assert(ret == BLOCK_SIZE);
+
+	memset(buffer.data(), 0, BLOCK_SIZE);
+	ret = co_await ex.read(buffer.data(), BLOCK_SIZE, offset);
+	assert(ret == BLOCK_SIZE);
+	assert(*(size_t *)buffer.data() == block);
+	nr_verified++;
+}
+
+static ftl::task<> trim(ftl::executor &ex)
+{
+	int ret = co_await ex.trim();
+	assert(ret >= 0);
+}
+
+int main(void)
+{
+	struct flash_device *flash = NULL;
+	std::vector<std::thread> threads;
+
+	assert(0 == module_init(PAGE_FTL_MODULE, &flash, RAMDISK_MODULE));
+	flash->f_op->open(flash, NULL, O_CREAT | O_RDWR);
+
+	ftl::executor ex(flash);
+	for (size_t block = 0; block < NR_TASKS; block++) {
+		ex.spawn(write_and_verify(ex, block));
+	}
+	ex.spawn(trim(ex));
+	for (int i = 0; i < NR_THREADS; i++) {
+		threads.emplace_back([&ex]() { ex.run(); });
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	pr_info("%zu blocks verified\n", nr_verified.load());
+
+	flash->f_op->close(flash);
+	assert(0 == module_exit(flash));
+	return 0;
+}
@@ -0,0 +1,400 @@
+/**
+ * @file page-cache.c
+ * @brief read cache of the flash pages for page ftl
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "page.h"
+#include "log.h"
+#include "cache.h"
+#include "device.h"
+
+/**
+ * @brief cached copy of a flash page
+ *
+ * @note
+ * Like the read-ahead slot, the copy is valid only while the LPN is mapped
+ * to `ppn` and the segment's erase epoch is `epoch`.
+ */
+struct page_ftl_cache_entry {
+	uint32_t ppn; /**< physical page which the copy belongs to */
+	gint epoch; /**< erase epoch of the ppn's segment */
+	struct device *dev;
+	char *buffer;
+};
+
+/**
+ * @brief deallocate the evicted entry
+ *
+ * @param key LPN of the entry
+ * @param value pointer of the `page_ftl_cache_entry`
+ *
+ * @return 0 for success
+ */
+static int page_ftl_cache_dealloc(const uint64_t key, uintptr_t value)
+{
+	struct page_ftl_cache_entry *entry =
+		(struct page_ftl_cache_entry *)value;
+
+	(void)key;
+	device_free_buffer(entry->dev, entry->buffer);
+	free(entry);
+	return 0;
+}
+
+/**
+ * @brief allocate the entry which has the copy of the page
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param ppn physical page number of the page
+ * @param epoch erase epoch of the ppn's segment
+ * @param page page-sized data
+ *
+ * @return pointer of the entry, NULL for fail
+ */
+static struct page_ftl_cache_entry *
+page_ftl_cache_alloc(struct page_ftl *pgftl, uint32_t ppn, gint epoch,
+		     const void *page)
+{
+	struct page_ftl_cache_entry *entry;
+
+	entry = (struct page_ftl_cache_entry *)malloc(
+		sizeof(struct page_ftl_cache_entry));
+	if (entry == NULL) {
+		pr_err("memory allocation failed\n");
+		return NULL;
+	}
+	entry->buffer =
+		(char *)device_alloc_buffer(pgftl->dev, DEVICE_BUFFER_DEFAULT);
+	if (entry->buffer == NULL) {
+		pr_err("memory allocation failed\n");
+		free(entry);
+		return NULL;
+	}
+	memcpy(entry->buffer, page, device_get_page_size(pgftl->dev));
+	entry->ppn = ppn;
+	entry->epoch = epoch;
+	entry->dev = pgftl->dev;
+	return entry;
+}
+
+/**
+ * @brief insert the entry; the previous entry of the LPN is replaced
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param lpn logical page number of the entry
+ * @param entry entry to insert
+ */
+static void page_ftl_cache_insert(struct page_ftl *pgftl, size_t lpn,
+				  struct page_ftl_cache_entry *entry)
+{
+	if (sharded_cache_put(pgftl->cache->pages, lpn, (uintptr_t)entry)) {
+		pr_err("cache insertion failed (lpn: %zu)\n", lpn);
+		page_ftl_cache_dealloc(lpn, (uintptr_t)entry);
+	}
+}
+
+/**
+ * @brief argument of the accesses to the cached entry
+ */
+struct page_ftl_cache_access {
+	struct page_ftl *pgftl;
+	uint32_t ppn;
+	gint epoch;
+	void *buffer;
+	size_t offset;
+	size_t len;
+};
+
+/**
+ * @brief copy the entry if it is the page which the reader looked up
+ *
+ * @return 1 when the data is copied, 0 for otherwise
+ */
+static int page_ftl_cache_copy_entry(const uint64_t lpn, uintptr_t value,
+				     void *data)
+{
+	struct page_ftl_cache_entry *entry =
+		(struct page_ftl_cache_entry *)value;
+	struct page_ftl_cache_access *access =
+		(struct page_ftl_cache_access *)data;
+
+	(void)lpn;
+	if (entry->ppn != access->ppn || entry->epoch != access->epoch) {
+		return 0;
+	}
+	memcpy(access->buffer, &entry->buffer[access->offset], access->len);
+	return 1;
+}
+
+/**
+ * @brief check the entry is the current data of the LPN
+ *
+ * @return 1 for current, 0 for stale
+ */
+static int page_ftl_cache_is_current(const uint64_t lpn, uintptr_t value,
+				     void *data)
+{
+	struct page_ftl_cache_entry *entry =
+		(struct page_ftl_cache_entry *)value;
+	struct page_ftl_cache_access *access =
+		(struct page_ftl_cache_access *)data;
+	struct page_ftl *pgftl = access->pgftl;
+	struct device_address paddr;
+	struct page_ftl_segment *segment;
+
+	paddr.lpn = page_ftl_map_load(pgftl, (size_t)lpn);
+	if (paddr.lpn != entry->ppn) {
+		return 0;
+	}
+	segment = &pgftl->segments[paddr.format.block];
+	return g_atomic_int_get(&segment->erase_epoch) == entry->epoch;
+}
+
+/**
+ * @brief copy the cached page to the buffer
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param lpn logical page number to read
+ * @param ppn physical page number which the reader looked up
+ * @param epoch erase epoch of the ppn's segment when it is looked up
+ * @param buffer buffer which receives the data
+ * @param offset offset in the page
+ * @param len number of bytes to copy
+ *
+ * @return 1 when the data is copied, 0 for the miss
+ *
+ * @note
+ * The cached page is used only if it has the same physical page and epoch
+ * as the reader's lookup. So, a stale entry is never returned even without
+ * being invalidated. The copy shares the shard with the other readers.
+ */
+int page_ftl_cache_copy(struct page_ftl *pgftl, size_t lpn, uint32_t ppn,
+			gint epoch, void *buffer, size_t offset, size_t len)
+{
+	struct page_ftl_cache *cache = pgftl->cache;
+	struct page_ftl_cache_access access;
+	int is_hit;
+
+	if (cache == NULL) {
+		return 0;
+	}
+	access.pgftl = pgftl;
+	access.ppn = ppn;
+	access.epoch = epoch;
+	access.buffer = buffer;
+	access.offset = offset;
+	access.len = len;
+	is_hit = sharded_cache_access(cache->pages, lpn,
+				      page_ftl_cache_copy_entry, &access) == 1;
+
+	if (is_hit) {
+		g_atomic_int_inc(&cache->nr_hits);
+	} else {
+		g_atomic_int_inc(&cache->nr_misses);
+	}
+	return is_hit;
+}
+
+/**
+ * @brief insert the page which is read from the device
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param lpn logical page number of the page
+ * @param ppn physical page number which the page is read from
+ * @param epoch erase epoch of the ppn's segment during the read
+ * @param page page-sized data
+ *
+ * @note
+ * A reader can race with the writer which already updated the entry. So, an
+ * entry which is still current is not replaced. If the writer updates the
+ * entry after the check, the reader's entry is stale and only misses.
+ */
+void page_ftl_cache_fill(struct page_ftl *pgftl, size_t lpn, uint32_t ppn,
+			 gint epoch, const void *page)
+{
+	struct page_ftl_cache *cache = pgftl->cache;
+	struct page_ftl_cache_access access;
+	struct page_ftl_cache_entry *entry;
+
+	if (cache == NULL) {
+		return;
+	}
+	access.pgftl = pgftl;
+	if (sharded_cache_access(cache->pages, lpn, page_ftl_cache_is_current,
+			     &access) == 1) {
+		return;
+	}
+	entry = page_ftl_cache_alloc(pgftl, ppn, epoch, page);
+	if (entry) {
+		page_ftl_cache_insert(pgftl, lpn, entry);
+	}
+}
+
+/**
+ * @brief always true for the cached entry
+ */
+static int page_ftl_cache_is_cached(const uint64_t lpn, uintptr_t value,
+				    void *data)
+{
+	(void)lpn;
+	(void)value;
+	(void)data;
+	return 1;
+}
+
+/**
+ * @brief update the cached page with the data which is being written
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param lpn logical page number of the page
+ * @param ppn physical page number which the page is written to
+ * @param epoch erase epoch of the ppn's segment
+ * @param page page-sized data
+ *
+ * @note
+ * The caller must hold the LPN's stripe lock. Only the cached LPN is
+ * updated; the writes don't allocate the entries. The cached entries are
+ * never modified, so the new copy replaces the previous entry.
+ */
+void page_ftl_cache_update(struct page_ftl *pgftl, size_t lpn, uint32_t ppn,
+			   gint epoch, const void *page)
+{
+	struct page_ftl_cache *cache = pgftl->cache;
+	struct page_ftl_cache_entry *entry;
+
+	if (cache == NULL) {
+		return;
+	}
+	if (sharded_cache_access(cache->pages, lpn, page_ftl_cache_is_cached,
+			     NULL) != 1) {
+		return;
+	}
+	entry = page_ftl_cache_alloc(pgftl, ppn, epoch, page);
+	if (entry == NULL) {
+		sharded_cache_delete(cache->pages, lpn);
+		return;
+	}
+	page_ftl_cache_insert(pgftl, lpn, entry);
+}
+
+/**
+ * @brief remove the LPN from the cache
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param lpn logical page number to remove
+ */
+void page_ftl_cache_invalidate(struct page_ftl *pgftl, size_t lpn)
+{
+	struct page_ftl_cache *cache = pgftl->cache;
+
+	if (cache == NULL) {
+		return;
+	}
+	sharded_cache_delete(cache->pages, lpn);
+}
+
+/**
+ * @brief select the eviction policy of the read cache
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param policy policy number described in the `cache.h`
+ *
+ * @return 0 for success, -EINVAL for the unknown policy, -EBUSY when the
+ * cache is already initialized
+ *
+ * @note
+ * The policy is applied at the next open. The default is
+ * `PAGE_FTL_CACHE_POLICY`.
+ */
+int page_ftl_set_cache_policy(struct page_ftl *pgftl, int policy)
+{
+	if (cache_get_policy_name(policy) == NULL) {
+		pr_err("unknown cache policy (policy: %d)\n", policy);
+		return -EINVAL;
+	}
+	if (pgftl->cache) {
+		pr_err("read cache is already initialized\n");
+		return -EBUSY;
+	}
+	pgftl->cache_policy = policy;
+	return 0;
+}
+
+/**
+ * @brief initialize the read cache
+ *
+ * @param pgftl pointer of the page FTL structure
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * The capacity is `PAGE_FTL_CACHE_SIZE` pages, but never larger than the
+ * device. The cache is disabled for the low latency device (e.g., ramdisk);
+ * its read is as cheap as the copy from the cache.
+ */
+int page_ftl_cache_init(struct page_ftl *pgftl)
+{
+	struct page_ftl_cache *cache;
+	size_t nr_pages;
+
+	pgftl->cache = NULL;
+#ifndef PAGE_FTL_USE_CACHE
+	return 0;
+#endif
+	if (device_is_low_latency(pgftl->dev)) {
+		pr_info("read cache is disabled for the low latency device\n");
+		return 0;
+	}
+
+	nr_pages = MIN((size_t)PAGE_FTL_CACHE_SIZE,
+		       device_get_total_pages(pgftl->dev));
+
+	cache = (struct page_ftl_cache *)malloc(sizeof(struct page_ftl_cache));
+	if (cache == NULL) {
+		pr_err("memory allocation failed\n");
+		return -ENOMEM;
+	}
+	memset(cache, 0, sizeof(struct page_ftl_cache));
+	cache->pages = sharded_cache_init(
+		pgftl->cache_policy, nr_pages,
+		MIN(nr_pages, (size_t)PAGE_FTL_CACHE_NR_SHARDS),
+		page_ftl_cache_dealloc);
+	if (cache->pages == NULL) {
+		pr_err("sharded cache initialization failed\n");
+		free(cache);
+		return -ENOMEM;
+	}
+	cache->nr_pages = cache->pages->capacity;
+	pr_info("read cache initialized (pages: %zu, shards: %zu, policy: %s)\n",
+		cache->nr_pages, cache->pages->nr_shards,
+		cache_get_policy_name(pgftl->cache_policy));
+	pgftl->cache = cache;
+	return 0;
+}
+
+/**
+ * @brief deallocate the read cache
+ *
+ * @param pgftl pointer of the page FTL structure
+ */
+void page_ftl_cache_exit(struct page_ftl *pgftl)
+{
+	struct page_ftl_cache *cache = pgftl->cache;
+
+	if (cache == NULL) {
+		return;
+	}
+	pr_info("read cache exit (hits: %d, misses: %d)\n",
+		g_atomic_int_get(&cache->nr_hits),
+		g_atomic_int_get(&cache->nr_misses));
+	sharded_cache_free(cache->pages);
+	free(cache);
+	pgftl->cache = NULL;
+}
@@ -12,12 +12,14 @@
 #include <fcntl.h>
 #include <pthread.h>
 #include <string.h>
+#include <unistd.h>
 #include <glib.h>
 #include <inttypes.h>
 
 #include "page.h"
 #include "log.h"
 #include "bits.h"
+#include "hbitmap.h"
 #include "device.h"
 #include "lru.h"
 #include <time.h>
@@ -76,28 +78,44 @@ static void *page_ftl_gc_thread(void *data)
 }
 
 /**
- * @brief allocate the segment's bitmap
+ * @brief reset the segment's counters, use bitmap and range of the p2l table
  *
  * @param pgftl pointer of the page-ftl structure
- * @param bitmap double pointer of the bitmap
+ * @param segnum target segment number
  *
- * @return 0 for successfully allocated
+ * @note
+ * It touches the segment's own entries only, so the different segments can
+ * be reset concurrently.
  */
-static int page_ftl_alloc_bitmap(struct page_ftl *pgftl, uint64_t **bitmap)
+static void page_ftl_segment_reset(struct page_ftl *pgftl, size_t segnum)
 {
-	size_t nr_pages_per_segment;
-	uint64_t *bits;
-
-	nr_pages_per_segment = device_get_pages_per_segment(pgftl->dev);
-	bits = (uint64_t *)malloc(
-		(size_t)BITS_TO_UINT64_ALIGN(nr_pages_per_segment));
-	if (bits == NULL) {
-		pr_err("bitmap allocation failed\n");
-		return -ENOMEM;
+	struct page_ftl_segment *segment = &pgftl->segments[segnum];
+	gint nr_pages_per_segment;
+	size_t nr_data_pages, page;
+	struct device_address paddr;
+	uint64_t *use_bits;
+
+	nr_pages_per_segment = (gint)device_get_pages_per_segment(pgftl->dev);
+	nr_data_pages = page_ftl_get_data_pages(pgftl);
+	g_atomic_int_set(&pgftl->nr_free[segnum], (gint)nr_data_pages);
+	g_atomic_int_set(&pgftl->nr_valid[segnum], 0);
+	g_atomic_int_set(&segment->nr_written_pages, 0);
+	g_atomic_int_set(&segment->is_closed, 0);
+	g_atomic_int_set(&segment->has_summary, 0);
+
+	use_bits = page_ftl_get_use_bits(pgftl, segnum);
+	memset(use_bits, 0, pgftl->nr_use_words * sizeof(uint64_t));
+	/** summary pages never be allocated to the user data */
+	for (page = nr_data_pages; page < (size_t)nr_pages_per_segment;
+	     page++) {
+		set_bit(use_bits, page);
+	}
+
+	paddr.lpn = 0;
+	paddr.format.block = (uint16_t)segnum;
+	for (page = 0; page < (size_t)nr_pages_per_segment; page++) {
+		pgftl->p2l_map[paddr.lpn + page] = PADDR_EMPTY;
 	}
-	memset(bits, 0, (size_t)BITS_TO_UINT64_ALIGN(nr_pages_per_segment));
-	*bitmap = bits;
-	return 0;
 }
 
 /**
@@ -107,17 +125,20 @@ static int page_ftl_alloc_bitmap(struct page_ftl *pgftl, uint64_t **bitmap)
  * @param segment pointer of the target segment
  *
  * @return 0 for successfully initialized
+ *
+ * @note
+ * The caller must hold the `pgftl->alloc_mutex` and the segment's mutex
+ * if the segment can be accessed concurrently.
  */
 int page_ftl_segment_data_init(struct page_ftl *pgftl,
 			       struct page_ftl_segment *segment)
 {
-	gint nr_pages_per_segment;
-	nr_pages_per_segment = (gint)device_get_pages_per_segment(pgftl->dev);
-	g_atomic_int_set(&segment->nr_free_pages, nr_pages_per_segment);
-	g_atomic_int_set(&segment->nr_valid_pages, 0);
+	size_t segnum;
+
+	segnum = page_ftl_get_segment_number(pgftl, (uintptr_t)segment);
+	page_ftl_segment_reset(pgftl, segnum);
+	page_ftl_update_free_segment(pgftl, segnum);
 
-	memset(segment->use_bits, 0,
-	       (size_t)BITS_TO_UINT64_ALIGN(nr_pages_per_segment));
 	if (segment->lpn_list) {
 		g_list_free(segment->lpn_list);
 	}
@@ -125,20 +146,144 @@ int page_ftl_segment_data_init(struct page_ftl *pgftl,
 	return 0;
 }
 
+/**
+ * @brief range of the open's initialization which a thread runs
+ */
+struct page_ftl_init_work {
+	struct page_ftl *pgftl;
+	void (*init)(struct page_ftl *, size_t start, size_t end);
+	size_t start;
+	size_t end;
+};
+
+/**
+ * @brief thread which initializes its range
+ *
+ * @param data pointer of the `page_ftl_init_work`
+ *
+ * @return NULL
+ */
+static void *page_ftl_init_worker(void *data)
+{
+	struct page_ftl_init_work *work = (struct page_ftl_init_work *)data;
+	work->init(work->pgftl, work->start, work->end);
+	return NULL;
+}
+
+/**
+ * @brief split the initialization of the entries into the threads
+ *
+ * @param pgftl pointer of the page-ftl structure
+ * @param nr_entries the number of the entries
+ * @param min_chunk the least entries worth a thread
+ * @param init function which initializes the [start, end) entries
+ *
+ * @note
+ * The calling thread runs the first chunk and the chunks whose thread
+ * cannot be created, so the initialization never fails by the threads.
+ */
+static void page_ftl_init_parallel(struct page_ftl *pgftl, size_t nr_entries,
+				   size_t min_chunk,
+				   void (*init)(struct page_ftl *, size_t,
+						size_t))
+{
+	struct page_ftl_init_work works[PAGE_FTL_INIT_MAX_THREADS];
+	pthread_t threads[PAGE_FTL_INIT_MAX_THREADS];
+	int is_created[PAGE_FTL_INIT_MAX_THREADS];
+	size_t nr_threads, chunk, i;
+	long nr_cpus;
+
+	nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	nr_threads = MIN(nr_cpus > 0 ? (size_t)nr_cpus : 1,
+			 (size_t)PAGE_FTL_INIT_MAX_THREADS);
+	nr_threads = MIN(nr_threads, nr_entries / MAX(min_chunk, 1));
+	nr_threads = MAX(nr_threads, 1);
+	chunk = (nr_entries + nr_threads - 1) / nr_threads;
+
+	for (i = 0; i < nr_threads; i++) {
+		works[i].pgftl = pgftl;
+		works[i].init = init;
+		works[i].start = MIN(i * chunk, nr_entries);
+		works[i].end = MIN((i + 1) * chunk, nr_entries);
+		is_created[i] = i > 0 && !pthread_create(&threads[i], NULL,
+							 page_ftl_init_worker,
+							 &works[i]);
+	}
+	for (i = 0; i < nr_threads; i++) {
+		if (!is_created[i]) {
+			page_ftl_init_worker(&works[i]);
+		}
+	}
+	for (i = 0; i < nr_threads; i++) {
+		if (is_created[i]) {
+			pthread_join(threads[i], NULL);
+		}
+	}
+	pr_debug("initialize %zu entries with %zu threads\n", nr_entries,
+		 nr_threads);
+}
+
+/**
+ * @brief initialize the segments in the range
+ *
+ * @param pgftl pointer of the page-ftl structure
+ * @param start first segment number
+ * @param end segment number after the last one
+ */
+static void page_ftl_init_segment_range(struct page_ftl *pgftl, size_t start,
+					size_t end)
+{
+	for (size_t segnum = start; segnum < end; segnum++) {
+		struct page_ftl_segment *segment = &pgftl->segments[segnum];
+
+		segment->lpn_list = NULL;
+		segment->erase_epoch = 0;
+		pthread_mutex_init(&segment->mutex, NULL);
+		page_ftl_segment_reset(pgftl, segnum);
+	}
+}
+
 /**
  * @brief initialize each segment's metadata
  *
  * @param pgftl pointer of the page ftl structure
  *
  * @return 0 to success, negative value to fail
+ *
+ * @note
+ * The segments are initialized by the threads. Only the `free_segs`, which
+ * is not thread-safe, is filled afterwards.
  */
 static int page_ftl_init_segment(struct page_ftl *pgftl)
 {
-	size_t nr_segments;
+	size_t nr_segments, nr_words, pages_per_segment;
 
 	struct page_ftl_segment *segments;
 
 	nr_segments = device_get_nr_segments(pgftl->dev);
+	pages_per_segment = device_get_pages_per_segment(pgftl->dev);
+	nr_words = (pages_per_segment + BITS_PER_UINT64 - 1) / BITS_PER_UINT64;
+
+	pgftl->free_segs = hbitmap_init(nr_segments);
+	if (pgftl->free_segs == NULL) {
+		pr_err("free segment bitmap allocation failed\n");
+		return -ENOMEM;
+	}
+
+	/** the sweeps over every segment read the contiguous arrays */
+	pgftl->nr_free = (gint *)calloc(nr_segments, sizeof(gint));
+	pgftl->nr_valid = (gint *)calloc(nr_segments, sizeof(gint));
+	if (pgftl->nr_free == NULL || pgftl->nr_valid == NULL) {
+		pr_err("segment counter allocation failed\n");
+		return -ENOMEM;
+	}
+	pgftl->nr_use_words = nr_words;
+	if (posix_memalign((void **)&pgftl->use_bits, PAGE_FTL_USE_BITS_ALIGN,
+			   nr_segments * nr_words * sizeof(uint64_t))) {
+		pgftl->use_bits = NULL;
+		pr_err("use bitmap slab allocation failed\n");
+		return -ENOMEM;
+	}
 
 	segments = (struct page_ftl_segment *)malloc(
 		sizeof(struct page_ftl_segment) * nr_segments);
@@ -146,31 +291,13 @@ static int page_ftl_init_segment(struct page_ftl *pgftl)
 		pr_err("memory allocation failed\n");
 		return -ENOMEM;
 	}
-	for (size_t i = 0; i < nr_segments; i++) {
-		segments[i].use_bits = NULL;
-	}
-	for (size_t i = 0; i < nr_segments; i++) {
-		int ret;
-		ret = page_ftl_alloc_bitmap(pgftl, &segments[i].use_bits);
-		if (ret) {
-			pr_err("initialize the use bitmap failed (segnum: %zu)\n",
-			       i);
-			return ret;
-		}
-		segments[i].lpn_list = NULL;
-		ret = page_ftl_segment_data_init(pgftl, &segments[i]);
-		if (ret) {
-			pr_err("initialize the segment data failed (segnum: %zu)\n",
-			       i);
-			return ret;
-		}
-		pr_debug("initialize the segment %zu (bits: %zu, size: %lu)\n",
-			 i, device_get_pages_per_segment(pgftl->dev),
-			 (uint64_t)(device_get_pages_per_segment(pgftl->dev)) /
-				 8);
-	}
-
 	pgftl->segments = segments;
+	page_ftl_init_parallel(pgftl, nr_segments,
+			       PAGE_FTL_INIT_MIN_CHUNK / pages_per_segment,
+			       page_ftl_init_segment_range);
+	for (size_t segnum = 0; segnum < nr_segments; segnum++) {
+		page_ftl_update_free_segment(pgftl, segnum);
+	}
 	return 0;
 }
 
@@ -204,6 +331,49 @@ static int page_ftl_init_bus_lock(struct page_ftl *pgftl)
 	return 0;
 }
 
+/**
+ * @brief initialize the page-ftl's LPN stripe locks
+ *
+ * @param pgftl pointer of the page-ftl structure
+ *
+ * @return 0 to success, negative value to fail
+ */
+static int page_ftl_init_lpn_lock(struct page_ftl *pgftl)
+{
+	size_t i;
+	pgftl->lpn_locks = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t) *
+						      PAGE_FTL_NR_LPN_LOCKS);
+	if (pgftl->lpn_locks == NULL) {
+		pr_err("lpn lock allocation failed\n");
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < PAGE_FTL_NR_LPN_LOCKS; i++) {
+		int err;
+		err = pthread_mutex_init(&pgftl->lpn_locks[i], NULL);
+		if (err) {
+			pr_err("lpn lock initialize failed\n");
+			return -err;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief initialize the entries of the mapping table in the range
+ *
+ * @param pgftl pointer of the page-ftl structure
+ * @param start first LPN
+ * @param end LPN after the last one
+ */
+static void page_ftl_init_map_range(struct page_ftl *pgftl, size_t start,
+				    size_t end)
+{
+	/** every byte of the `PADDR_EMPTY` is 0xff, so the bulk fill works */
+	memset(&pgftl->trans_map[start], 0xff,
+	       (end - start) * sizeof(uint32_t));
+}
+
 /**
  * @brief initialize the page-ftl's mapping table
  *
@@ -220,13 +390,93 @@ static int page_ftl_init_map(struct page_ftl *pgftl)
 		pr_err("cannot allocate the memory for mapping table\n");
 		return -ENOMEM;
 	}
-	/** initialize the mapping table */
-	for (uint32_t lpn = 0; lpn < map_size / sizeof(uint32_t); lpn++) {
-		pgftl->trans_map[lpn] = PADDR_EMPTY;
+	page_ftl_init_parallel(pgftl, map_size / sizeof(uint32_t),
+			       PAGE_FTL_INIT_MIN_CHUNK,
+			       page_ftl_init_map_range);
+
+	/** entries are initialized by the segment initialization */
+	pgftl->p2l_map = (uint32_t *)malloc(
+		device_get_total_pages(pgftl->dev) * sizeof(uint32_t));
+	if (pgftl->p2l_map == NULL) {
+		pr_err("cannot allocate the memory for p2l table\n");
+		return -ENOMEM;
+	}
+	pgftl->seqnum = 1;
+	return 0;
+}
+
+/**
+ * @brief name of the open stages
+ */
+static const char *page_ftl_open_stage_names[NR_PAGE_FTL_OPEN_STAGE] = {
+	"device", "map", "segment", "recovery", "total",
+};
+
+/**
+ * @brief get the name of the open stage
+ *
+ * @param stage open stage (e.g., `PAGE_FTL_OPEN_MAP`)
+ *
+ * @return name of the stage, NULL for the unknown stage
+ */
+const char *page_ftl_get_open_stage_name(int stage)
+{
+	if (stage < 0 || stage >= NR_PAGE_FTL_OPEN_STAGE) {
+		return NULL;
 	}
+	return page_ftl_open_stage_names[stage];
+}
+
+/**
+ * @brief set the hook which receives the elapsed time of each open stage
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param hook hook function (NULL to remove)
+ * @param data data which is passed to the hook
+ *
+ * @return 0 for success
+ *
+ * @note
+ * The hook is called at the next open on the opening thread.
+ */
+int page_ftl_set_open_hook(struct page_ftl *pgftl, page_ftl_open_hook_fn hook,
+			   void *data)
+{
+	pgftl->open_hook = hook;
+	pgftl->open_hook_data = data;
 	return 0;
 }
 
+/**
+ * @brief get the monotonic time for the open stages
+ */
+static uint64_t page_ftl_open_get_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief report the elapsed time of the open stage
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param stage finished open stage
+ * @param start time when the stage started
+ */
+static void page_ftl_open_report(struct page_ftl *pgftl, int stage,
+				 uint64_t start)
+{
+	uint64_t elapsed_ns = page_ftl_open_get_ns() - start;
+
+	pr_debug("open %s: %" PRIu64 " ns\n",
+		 page_ftl_get_open_stage_name(stage), elapsed_ns);
+	if (pgftl->open_hook) {
+		pgftl->open_hook(pgftl, stage, elapsed_ns,
+				 pgftl->open_hook_data);
+	}
+}
+
 /**
  * @brief allocate the page ftl structure's members
  *
@@ -236,21 +486,21 @@ static int page_ftl_init_map(struct page_ftl *pgftl)
  *
  * @return zero to success, negative number to fail
  *
- * @todo you must make a recovery process
+ * @note
+ * Without O_CREAT, the mapping table is rebuilt from the summary blocks and
+ * the journal.
  */
 int page_ftl_open(struct page_ftl *pgftl, const char *name, int flags)
 {
 	int err;
 	int gc_thread_status;
 	size_t nr_segments;
+	uint64_t open_start, stage_start;
 
 	struct device *dev;
 
-	if (!(flags & O_CREAT)) {
-		pr_warn("current version needs to O_CREAT flag\n");
-	}
-
 	assert(NULL != pgftl->dev);
+	open_start = page_ftl_open_get_ns();
 
 	err = pthread_mutex_init(&pgftl->mutex, NULL);
 	if (err) {
@@ -264,29 +514,45 @@ int page_ftl_open(struct page_ftl *pgftl, const char *name, int flags)
 		goto exception;
 	}
 
+	err = pthread_mutex_init(&pgftl->alloc_mutex, NULL);
+	if (err) {
+		pr_err("alloc_mutex initialize failed\n");
+		goto exception;
+	}
+
 	dev = pgftl->dev;
+	stage_start = page_ftl_open_get_ns();
 	err = dev->d_op->open(dev, name, flags);
 	if (err) {
 		pr_err("device open failed\n");
 		err = -EINVAL;
 		goto exception;
 	}
+	page_ftl_open_report(pgftl, PAGE_FTL_OPEN_DEVICE, stage_start);
 
 	err = page_ftl_init_bus_lock(pgftl);
 	if (err) {
 		goto exception;
 	}
 
+	err = page_ftl_init_lpn_lock(pgftl);
+	if (err) {
+		goto exception;
+	}
+
+	stage_start = page_ftl_open_get_ns();
 	err = page_ftl_init_map(pgftl);
 	if (err) {
 		goto exception;
 	}
+	page_ftl_open_report(pgftl, PAGE_FTL_OPEN_MAP, stage_start);
 
+	stage_start = page_ftl_open_get_ns();
 	err = page_ftl_init_segment(pgftl);
 	if (err) {
 		goto exception;
 	}
-	pgftl->gc_list = NULL;
+	page_ftl_open_report(pgftl, PAGE_FTL_OPEN_SEGMENT, stage_start);
 
 	nr_segments = device_get_nr_segments(dev);
 	pgftl->gc_seg_bits =
@@ -298,6 +564,41 @@ int page_ftl_open(struct page_ftl *pgftl, const char *name, int flags)
 	memset(pgftl->gc_seg_bits, 0,
 	       (size_t)BITS_TO_UINT64_ALIGN(nr_segments));
 
+	stage_start = page_ftl_open_get_ns();
+	err = page_ftl_journal_init(pgftl);
+	if (err) {
+		goto exception;
+	}
+
+	if (!(flags & O_CREAT)) {
+		err = page_ftl_summary_recovery(pgftl);
+		if (err) {
+			pr_err("recovery from the summary failed\n");
+			goto exception;
+		}
+	}
+
+	err = page_ftl_journal_start(pgftl);
+	if (err) {
+		goto exception;
+	}
+	page_ftl_open_report(pgftl, PAGE_FTL_OPEN_RECOVERY, stage_start);
+
+	err = page_ftl_readahead_init(pgftl);
+	if (err) {
+		goto exception;
+	}
+
+	err = page_ftl_cache_init(pgftl);
+	if (err) {
+		goto exception;
+	}
+
+	err = page_ftl_mq_init(pgftl);
+	if (err) {
+		goto exception;
+	}
+
 	pgftl->o_flags = flags;
 
 	g_atomic_int_set(&is_gc_thread_exit, 0);
@@ -305,9 +606,11 @@ int page_ftl_open(struct page_ftl *pgftl, const char *name, int flags)
 					  page_ftl_gc_thread, (void *)pgftl);
 	if (gc_thread_status < 0) {
 		pr_err("garbage collection thread creation failed\n");
+		pgftl->gc_thread = 0;
 		goto exception;
 	}
 
+	page_ftl_open_report(pgftl, PAGE_FTL_OPEN_TOTAL, open_start);
 	return 0;
 
 exception:
@@ -316,7 +619,7 @@ exception:
 }
 
 /**
- * @brief submit the request to the valid function
+ * @brief process the request on the current thread
  *
  * @param pgftl pointer of the page ftl structure
  * @param request pointer of the request
@@ -326,9 +629,11 @@ exception:
  *
  * @note
  * garbage collection doesn't free the request.
+ * Reads and writes run concurrently with the garbage collection. The gc only
+ * locks the victim segment and the LPNs which it relocates.
  */
-ssize_t page_ftl_submit_request(struct page_ftl *pgftl,
-				struct device_request *request)
+ssize_t page_ftl_process_request(struct page_ftl *pgftl,
+				 struct device_request *request)
 {
 	ssize_t ret = 0;
 	if (pgftl == NULL || request == NULL) {
@@ -336,37 +641,17 @@ ssize_t page_ftl_submit_request(struct page_ftl *pgftl,
 		       request);
 		return -EINVAL;
 	}
-	pthread_mutex_lock(&pgftl->gc_mutex);
 	switch (request->flag) {
 	case DEVICE_WRITE:
-#ifdef PAGE_FTL_USE_GLOBAL_RWLOCK
-		pthread_rwlock_wrlock(&pgftl->rwlock);
-#endif
-		pthread_mutex_unlock(&pgftl->gc_mutex);
 		ret = page_ftl_write(pgftl, request);
-#ifdef PAGE_FTL_USE_GLOBAL_RWLOCK
-		pthread_rwlock_unlock(&pgftl->rwlock);
-#endif
 		break;
 	case DEVICE_READ:
-#ifdef PAGE_FTL_USE_GLOBAL_RWLOCK
-		pthread_rwlock_rdlock(&pgftl->rwlock);
-#endif
-		pthread_mutex_unlock(&pgftl->gc_mutex);
 		ret = page_ftl_read(pgftl, request);
-#ifdef PAGE_FTL_USE_GLOBAL_RWLOCK
-		pthread_rwlock_unlock(&pgftl->rwlock);
-#endif
 		break;
 	case DEVICE_ERASE:
-#ifdef PAGE_FTL_USE_GLOBAL_RWLOCK
-		pthread_rwlock_wrlock(&pgftl->rwlock);
-#endif
+		pthread_mutex_lock(&pgftl->gc_mutex);
 		ret = (ssize_t)page_ftl_do_gc(pgftl);
 		pthread_mutex_unlock(&pgftl->gc_mutex);
-#ifdef PAGE_FTL_USE_GLOBAL_RWLOCK
-		pthread_rwlock_unlock(&pgftl->rwlock);
-#endif
 		break;
 	default:
 		pr_err("invalid flag detected: %u\n", request->flag);
@@ -388,15 +673,7 @@ static void page_ftl_free_segments(struct page_ftl *pgftl)
 	assert(NULL != segments);
 	nr_segments = device_get_nr_segments(pgftl->dev);
 	for (i = 0; i < nr_segments; i++) {
-		uint64_t *use_bits;
-
-		use_bits = segments[i].use_bits;
-
-		if (use_bits != NULL) {
-			free(use_bits);
-		}
-
-		segments[i].use_bits = NULL;
+		pthread_mutex_destroy(&segments[i].mutex);
 
 		if (segments[i].lpn_list) {
 			g_list_free(segments[i].lpn_list);
@@ -420,14 +697,29 @@ int page_ftl_close(struct page_ftl *pgftl)
 		pr_err("null page ftl structure submitted\n");
 		return ret;
 	}
-	g_atomic_int_set(&is_gc_thread_exit, 1);
-	pthread_join(pgftl->gc_thread, (void **)&status);
+	if (pgftl->gc_thread) {
+		/** close can be called again by the module exit */
+		g_atomic_int_set(&is_gc_thread_exit, 1);
+		pthread_join(pgftl->gc_thread, (void **)&status);
+		pgftl->gc_thread = 0;
+	}
+	page_ftl_mq_exit(pgftl);
+	page_ftl_readahead_exit(pgftl);
+	page_ftl_cache_exit(pgftl);
+	page_ftl_journal_exit(pgftl);
 
 	pthread_mutex_destroy(&pgftl->mutex);
 	pthread_mutex_destroy(&pgftl->gc_mutex);
-#ifdef PAGE_FTL_USE_GLOBAL_RWLOCK
-	pthread_rwlock_destroy(&pgftl->rwlock);
-#endif
+	pthread_mutex_destroy(&pgftl->alloc_mutex);
+
+	if (pgftl->lpn_locks) {
+		size_t i;
+		for (i = 0; i < PAGE_FTL_NR_LPN_LOCKS; i++) {
+			pthread_mutex_destroy(&pgftl->lpn_locks[i]);
+		}
+		free(pgftl->lpn_locks);
+		pgftl->lpn_locks = NULL;
+	}
 
 	if (pgftl->segments) {
 		page_ftl_free_segments(pgftl);
@@ -435,14 +727,29 @@ int page_ftl_close(struct page_ftl *pgftl)
 		pgftl->segments = NULL;
 	}
 
+	if (pgftl->nr_free) {
+		free(pgftl->nr_free);
+		pgftl->nr_free = NULL;
+	}
+
+	if (pgftl->nr_valid) {
+		free(pgftl->nr_valid);
+		pgftl->nr_valid = NULL;
+	}
+
+	if (pgftl->use_bits) {
+		free(pgftl->use_bits);
+		pgftl->use_bits = NULL;
+	}
+
 	if (pgftl->trans_map) {
 		free(pgftl->trans_map);
 		pgftl->trans_map = NULL;
 	}
 
-	if (pgftl->gc_list) {
-		g_list_free(pgftl->gc_list);
-		pgftl->gc_list = NULL;
+	if (pgftl->p2l_map) {
+		free(pgftl->p2l_map);
+		pgftl->p2l_map = NULL;
 	}
 
 	if (pgftl->gc_seg_bits) {
@@ -450,6 +757,11 @@ int page_ftl_close(struct page_ftl *pgftl)
 		pgftl->gc_seg_bits = NULL;
 	}
 
+	if (pgftl->free_segs) {
+		hbitmap_free(pgftl->free_segs);
+		pgftl->free_segs = NULL;
+	}
+
 	if (pgftl->dev && pgftl->bus_rwlock) {
 		size_t i = 0;
 		size_t nr_bus = pgftl->dev->info.nr_bus;
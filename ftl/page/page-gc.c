@@ -14,27 +14,7 @@
 #include "page.h"
 #include "log.h"
 #include "bits.h"
-
-/**
- * @brief page ftl gc list compare function
- *
- * @param a compare target 1
- * @param b compare target 2
- *
- * @return to make precede a segment that contains the less valid pages
- */
-gint page_ftl_gc_list_cmp(gconstpointer a, gconstpointer b)
-{
-	struct page_ftl_segment *segment[2];
-	uint64_t nr_valid_pages[2];
-	segment[0] = (struct page_ftl_segment *)a;
-	segment[1] = (struct page_ftl_segment *)b;
-	nr_valid_pages[0] =
-		(uint64_t)g_atomic_int_get(&segment[0]->nr_valid_pages);
-	nr_valid_pages[1] =
-		(uint64_t)g_atomic_int_get(&segment[1]->nr_valid_pages);
-	return (gint)(nr_valid_pages[0] - nr_valid_pages[1]);
-}
+#include "argmin.h"
 
 /**
  * @brief erase's end request function
@@ -52,20 +32,28 @@ static void page_ftl_erase_end_rq(struct device_request *request)
  * @param pgftl pointer of the page FTL structure
  *
  * @return garbage collection target segment's pointer
+ *
+ * @note
+ * The caller must hold the `pgftl->mutex` and the `pgftl->gc_mutex`.
+ * The segment which has the least valid pages is found by the vector scan
+ * over the `nr_valid` array of the segments in the `gc_seg_bits`. The
+ * segment whose collection failed before keeps its bit, so it is retried.
  */
 static struct page_ftl_segment *page_ftl_pick_gc_target(struct page_ftl *pgftl)
 {
 	struct page_ftl_segment *segment;
-	if (pgftl->gc_list == NULL) {
+	struct device *dev = pgftl->dev;
+	size_t segnum;
+
+	segnum = argmin_masked(pgftl->nr_valid, device_get_nr_segments(dev),
+			       pgftl->gc_seg_bits, dev->badseg_bitmap);
+	if (segnum == ARGMIN_NOT_FOUND) {
 		return NULL;
 	}
-	pgftl->gc_list = g_list_sort(pgftl->gc_list, page_ftl_gc_list_cmp);
-	segment = (struct page_ftl_segment *)pgftl->gc_list->data;
-	pr_debug("gc target: %zu (valid: %d) => %p\n",
-		 page_ftl_get_segment_number(pgftl, (uintptr_t)segment),
-		 g_atomic_int_get(&segment->nr_valid_pages), segment);
-	pgftl->gc_list = g_list_remove(pgftl->gc_list, segment);
-	g_atomic_int_set(&segment->nr_free_pages, 0);
+	segment = &pgftl->segments[segnum];
+	pr_debug("gc target: %zu (valid: %d) => %p\n", segnum,
+		 g_atomic_int_get(&pgftl->nr_valid[segnum]), segment);
+	g_atomic_int_set(&pgftl->nr_free[segnum], 0);
 	return segment;
 }
 
@@ -77,8 +65,7 @@ static struct page_ftl_segment *page_ftl_pick_gc_target(struct page_ftl *pgftl)
  *
  * @return 0 for success, negative number for fail
  */
-static int page_ftl_segment_erase(struct page_ftl *pgftl,
-				  struct device_address paddr)
+int page_ftl_segment_erase(struct page_ftl *pgftl, struct device_address paddr)
 {
 	struct device *dev;
 	struct device_request *request;
@@ -125,13 +112,12 @@ static ssize_t page_ftl_read_valid_page(struct page_ftl *pgftl, size_t lpn,
 	page_size = device_get_page_size(dev);
 	request = NULL;
 
-	buffer = (char *)malloc(page_size);
+	buffer = (char *)device_alloc_buffer(dev, DEVICE_BUFFER_DEFAULT);
 	if (buffer == NULL) {
 		pr_err("memory allocation failed\n");
 		ret = -ENOMEM;
 		goto exception;
 	}
-	memset(buffer, 0, page_size);
 
 	request = device_alloc_request(DEVICE_DEFAULT_REQUEST);
 	if (request == NULL) {
@@ -145,7 +131,7 @@ static ssize_t page_ftl_read_valid_page(struct page_ftl *pgftl, size_t lpn,
 	request->sector = lpn * page_size;
 	request->data = buffer;
 
-	ret = page_ftl_read(pgftl, request);
+	ret = page_ftl_read_no_fill(pgftl, request);
 	if (ret != (ssize_t)page_size) {
 		pr_err("invalid read size detected (expected: %zd, acutal: %zd)\n",
 		       page_size, ret);
@@ -156,7 +142,7 @@ static ssize_t page_ftl_read_valid_page(struct page_ftl *pgftl, size_t lpn,
 	return ret;
 exception:
 	if (buffer) {
-		free(buffer);
+		device_free_buffer(dev, buffer);
 	}
 	if (request) {
 		device_free_request(request);
@@ -195,13 +181,13 @@ static ssize_t page_ftl_write_valid_page(struct page_ftl *pgftl, size_t lpn,
 	request->sector = lpn * page_size;
 	request->data = buffer;
 
-	ret = page_ftl_write(pgftl, request);
+	ret = page_ftl_write_locked(pgftl, request);
+	device_free_buffer(dev, buffer);
 	if (ret != (ssize_t)page_size) {
 		pr_err("invalid write size detected (expected: %zd, acutal: %zd)\n",
 		       page_size, ret);
 		return -EFAULT;
 	}
-	free(buffer);
 	return ret;
 }
 
@@ -212,34 +198,63 @@ static ssize_t page_ftl_write_valid_page(struct page_ftl *pgftl, size_t lpn,
  * @param segment segment which wants to copy the valid pages
  *
  * @return 0 for success, negative number for fail
+ *
+ * @note
+ * The valid LPNs are taken under the segment's lock. Then, each LPN is
+ * relocated with its stripe lock only, and skipped if a user write already
+ * moved it to the other segment.
  */
 static ssize_t page_ftl_valid_page_copy(struct page_ftl *pgftl,
 					struct page_ftl_segment *segment)
 {
+	struct device_address paddr;
 	ssize_t ret = 0;
+	size_t *lpns;
+	size_t nr_lpns, idx, segnum;
 	GList *list;
 
-	(void)pgftl;
-	list = segment->lpn_list;
+	segnum = page_ftl_get_segment_number(pgftl, (uintptr_t)segment);
 
-	while (list) {
-		size_t lpn;
+	pthread_mutex_lock(&segment->mutex);
+	nr_lpns = g_list_length(segment->lpn_list);
+	lpns = (size_t *)malloc((nr_lpns + 1) * sizeof(size_t));
+	if (lpns == NULL) {
+		pthread_mutex_unlock(&segment->mutex);
+		pr_err("memory allocation failed\n");
+		return -ENOMEM;
+	}
+	idx = 0;
+	for (list = segment->lpn_list; list; list = list->next) {
+		lpns[idx++] = GPOINTER_TO_SIZE(list->data);
+	}
+	pthread_mutex_unlock(&segment->mutex);
+
+	for (idx = 0; idx < nr_lpns; idx++) {
+		pthread_mutex_t *lock;
+		size_t lpn = lpns[idx];
 		char *buffer;
 
-		GList *next = list->next;
-		lpn = GPOINTER_TO_SIZE(list->data);
+		lock = page_ftl_get_lpn_lock(pgftl, lpn);
+		pthread_mutex_lock(lock);
+		paddr.lpn = page_ftl_map_load(pgftl, lpn);
+		if (paddr.lpn == PADDR_EMPTY || paddr.format.block != segnum) {
+			pthread_mutex_unlock(lock);
+			continue;
+		}
 		ret = page_ftl_read_valid_page(pgftl, lpn, &buffer);
 		if (ret < 0) {
+			pthread_mutex_unlock(lock);
 			pr_err("read valid page failed\n");
-			return ret;
+			break;
 		}
 		ret = page_ftl_write_valid_page(pgftl, lpn, buffer);
+		pthread_mutex_unlock(lock);
 		if (ret < 0) {
 			pr_err("write valid page failed\n");
-			return ret;
+			break;
 		}
-		list = next;
 	}
+	free(lpns);
 	return ret;
 }
 
@@ -273,28 +288,39 @@ ssize_t page_ftl_do_gc(struct page_ftl *pgftl)
 		return ret;
 	}
 
+	/** copied pages' mapping must be durable before erasing the summary */
+	ret = page_ftl_journal_flush(pgftl);
+	if (ret) {
+		pr_err("journal flush failed\n");
+		return ret;
+	}
+
 	paddr.lpn = 0;
 	paddr.format.block = (uint16_t)segnum;
+	g_atomic_int_inc(&segment->erase_epoch); /**< readers retry from now */
 	ret = page_ftl_segment_erase(pgftl, paddr);
 	if (ret) {
 		pr_err("do erase failed\n");
 		return ret;
 	}
 
-	pthread_mutex_lock(&pgftl->mutex);
+	pthread_mutex_lock(&pgftl->alloc_mutex);
+	pthread_mutex_lock(&segment->mutex);
 	ret = page_ftl_segment_data_init(pgftl, segment);
+	pthread_mutex_unlock(&segment->mutex);
+	pthread_mutex_unlock(&pgftl->alloc_mutex);
 	if (ret) {
 		pr_err("initialize the segment data failed\n");
 		return ret;
 	}
-	reset_bit(pgftl->gc_seg_bits, segnum);
-	pthread_mutex_unlock(&pgftl->mutex);
+	test_and_clear_bit_atomic(pgftl->gc_seg_bits, segnum);
+	g_atomic_int_inc(&segment->erase_epoch);
 
 	return 0;
 }
 
 /**
- * @brief do garbage collection from the gc list
+ * @brief do garbage collection of the gc targets
  *
  * @param pgftl pointer of the page ftl
  * @param request pointer of the request
@@ -307,6 +333,7 @@ ssize_t page_ftl_gc_from_list(struct page_ftl *pgftl,
 {
 	ssize_t ret = 0;
 	size_t nr_segments, nr_gc_segments, idx;
+	uint64_t *gc_seg_bits = pgftl->gc_seg_bits;
 	nr_segments = device_get_nr_segments(pgftl->dev);
 	nr_gc_segments = (size_t)((double)nr_segments * gc_ratio);
 	for (idx = 0; (ssize_t)idx >= 0 && idx < nr_gc_segments; idx++) {
@@ -315,7 +342,8 @@ ssize_t page_ftl_gc_from_list(struct page_ftl *pgftl,
 			pr_err("garbage collection from list failed\n");
 			return ret;
 		}
-		if (pgftl->gc_list == NULL) {
+		if (find_first_one_bit(gc_seg_bits, nr_segments, 0) ==
+		    BITS_NOT_FOUND) {
 			break;
 		}
 	}
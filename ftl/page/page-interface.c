@@ -153,23 +153,25 @@ exception:
  * @param offset size of the offset (bytes)
  *
  * @return positive or zero read size to success, negative number to fail
+ *
+ * @note
+ * Each request points the caller's buffer. So the page-aligned full pages
+ * are read without a copy in the FTL. All requests are made before the
+ * submission and the caller waits once for the whole batch. The pages in
+ * the read-ahead cache are copied without a request, and the read triggers
+ * the prefetch of its stream after it finishes.
  */
 static ssize_t page_ftl_read_interface(struct flash_device *flash, void *buffer,
 				       size_t count, off_t offset)
 {
 	struct page_ftl *pgftl = NULL;
-	struct device_request *request = NULL;
-
-	char *temp = NULL;
+	struct device_request **requests = NULL;
 
 	ssize_t size = -1;
-	ssize_t remain;
-	size_t page_size;
-
-	char *ptr;
+	ssize_t nr_hit_bytes = 0;
+	size_t page_size, nr_requests, nr_issued, pos, done, i;
 
-	ptr = (char *)buffer;
-	if (ptr == NULL) {
+	if (buffer == NULL) {
 		pr_err("buffer pointer doesn't exist\n");
 		size = -EINVAL;
 		goto exception;
@@ -197,25 +199,37 @@ static ssize_t page_ftl_read_interface(struct flash_device *flash, void *buffer,
 	}
 
 	page_size = device_get_page_size(pgftl->dev);
-	temp = (char *)malloc(page_size);
-	if (temp == NULL) {
+	pos = page_ftl_get_page_offset(pgftl, (size_t)offset);
+	nr_requests = (pos + count + page_size - 1) / page_size;
+	if (nr_requests == 0) {
+		return 0;
+	}
+
+	requests = (struct device_request **)malloc(
+		nr_requests * sizeof(struct device_request *));
+	if (requests == NULL) {
 		pr_err("memory allocation failed\n");
 		size = -ENOMEM;
 		goto exception;
 	}
-
-	size = 0;
-	remain = (ssize_t)count;
-	while (remain != 0) {
-		size_t pos;
-		ssize_t read_size;
-		ssize_t submit_size;
-
-		pos = page_ftl_get_page_offset(pgftl, (size_t)offset);
-		if (pos + (size_t)remain < page_size) {
-			submit_size = remain;
-		} else {
-			submit_size = (ssize_t)(page_size - pos);
+	memset(requests, 0, nr_requests * sizeof(struct device_request *));
+
+	done = 0;
+	nr_issued = 0;
+	for (i = 0; i < nr_requests; i++) {
+		struct device_request *request;
+		size_t len;
+
+		len = page_size - page_ftl_get_page_offset(
+					  pgftl, (size_t)offset + done);
+		if (len > count - done) {
+			len = count - done;
+		}
+		if (page_ftl_readahead_copy(pgftl, (size_t)offset + done,
+					    (char *)buffer + done, len)) {
+			nr_hit_bytes += (ssize_t)len;
+			done += len;
+			continue;
 		}
 
 		/** allocate the request */
@@ -225,36 +239,237 @@ static ssize_t page_ftl_read_interface(struct flash_device *flash, void *buffer,
 			size = -ENOMEM;
 			goto exception;
 		}
-
 		request->flag = DEVICE_READ;
-		request->data_len = (size_t)submit_size;
-		request->sector = (size_t)offset;
-		request->data = temp;
+		request->data_len = len;
+		request->sector = (size_t)offset + done;
+		request->data = (char *)buffer + done;
+		requests[nr_issued++] = request;
+		done += len;
+	}
 
-		/** submit the request */
-		read_size = page_ftl_submit_request(pgftl, request);
-		if (read_size < (ssize_t)0) {
-			pr_err("page FTL submit request failed\n");
-			size = -EINVAL;
-			goto exception;
+	/** submit the requests; they are released by the submission */
+	size = 0;
+	if (nr_issued > 0) {
+		size = page_ftl_submit_requests(pgftl, requests, nr_issued);
+	}
+	free(requests);
+	if (size < 0) {
+		pr_err("page FTL submit request failed\n");
+		return -EINVAL;
+	}
+	page_ftl_readahead(pgftl, (size_t)offset, count);
+	return size + nr_hit_bytes;
+
+exception:
+	if (requests) {
+		for (i = 0; i < nr_requests; i++) {
+			if (requests[i]) {
+				device_free_request(requests[i]);
+			}
 		}
-		memcpy(ptr, temp, (size_t)read_size);
-		offset += read_size;
-		remain -= read_size;
-		ptr += read_size;
-		size += read_size;
+		free(requests);
 	}
-	free(temp);
 	return size;
+}
+
+/**
+ * @brief asynchronous I/O which is split into the page-sized commands
+ */
+struct page_ftl_async_io {
+	struct page_ftl *pgftl;
+	struct flash_io *io;
+	struct page_ftl_mq_cmd *cmds;
+	gint nr_remains; /**< commands which are not completed */
+	gint error; /**< first error of the commands */
+	ssize_t size; /**< total processed size of the commands */
+};
+
+/**
+ * @brief end command function of the asynchronous I/O's command
+ *
+ * @param cmd pointer of the completed command
+ *
+ * @note
+ * The last completed command completes the I/O.
+ */
+static void page_ftl_async_end_cmd(struct page_ftl_mq_cmd *cmd)
+{
+	struct page_ftl_async_io *aio;
+	struct flash_io *io;
+	struct page_ftl *pgftl;
+
+	aio = (struct page_ftl_async_io *)cmd->cmd_private;
+	if (cmd->ret <= 0) {
+		/** the FTL releases the request only when it succeeds */
+		device_free_request(cmd->request);
+		g_atomic_int_compare_and_exchange(
+			&aio->error, 0, cmd->ret < 0 ? (gint)cmd->ret : -EIO);
+	} else {
+		__atomic_fetch_add(&aio->size, cmd->ret, __ATOMIC_RELAXED);
+	}
+	if (!g_atomic_int_dec_and_test(&aio->nr_remains)) {
+		return;
+	}
+
+	io = aio->io;
+	pgftl = aio->pgftl;
+	io->ret = aio->error ? (ssize_t)aio->error :
+			       __atomic_load_n(&aio->size, __ATOMIC_RELAXED);
+	free(aio->cmds);
+	free(aio);
+	page_ftl_mq_end_io(pgftl, io);
+}
+
+/**
+ * @brief submit the asynchronous I/O to the page FTL
+ *
+ * @param flash pointer of the flash device information
+ * @param io pointer of the I/O descriptor
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * The I/O is split into the page-sized commands and each of them goes to
+ * the multi-queue workers. When this fails, the I/O is not submitted and
+ * it is never completed.
+ */
+static int page_ftl_submit_interface(struct flash_device *flash,
+				     struct flash_io *io)
+{
+	struct page_ftl *pgftl = NULL;
+	struct page_ftl_async_io *aio = NULL;
+	struct page_ftl_mq_cmd *cmds = NULL;
+	size_t page_size, nr_cmds, pos, i;
+	size_t done;
+	int accmode;
+	int ret = 0;
+
+	if (flash == NULL || io == NULL || io->buffer == NULL) {
+		pr_err("null detected (flash:%p, io:%p)\n", flash, io);
+		return -EINVAL;
+	}
+	pgftl = (struct page_ftl *)flash->f_private;
+	if (pgftl == NULL || pgftl->mq == NULL) {
+		pr_err("page FTL is not opened\n");
+		return -EINVAL;
+	}
+
+	accmode = pgftl->o_flags & O_ACCMODE;
+	if (!((io->opcode == FLASH_IO_READ && accmode != O_WRONLY) ||
+	      (io->opcode == FLASH_IO_WRITE && accmode != O_RDONLY))) {
+		pr_err("invalid I/O (opcode: %u, flags: 0x%x)\n", io->opcode,
+		       pgftl->o_flags);
+		return -EINVAL;
+	}
+
+	page_size = device_get_page_size(pgftl->dev);
+	pos = page_ftl_get_page_offset(pgftl, (size_t)io->offset);
+	nr_cmds = (pos + io->count + page_size - 1) / page_size;
+	if (nr_cmds == 0) {
+		page_ftl_mq_start_io(pgftl, io);
+		io->ret = 0;
+		page_ftl_mq_end_io(pgftl, io);
+		return 0;
+	}
+
+	aio = (struct page_ftl_async_io *)malloc(
+		sizeof(struct page_ftl_async_io));
+	cmds = (struct page_ftl_mq_cmd *)malloc(
+		nr_cmds * sizeof(struct page_ftl_mq_cmd));
+	if (aio == NULL || cmds == NULL) {
+		pr_err("memory allocation failed\n");
+		ret = -ENOMEM;
+		goto exception;
+	}
+	memset(cmds, 0, nr_cmds * sizeof(struct page_ftl_mq_cmd));
+
+	done = 0;
+	for (i = 0; i < nr_cmds; i++) {
+		struct device_request *request;
+		size_t len;
+
+		len = page_size - page_ftl_get_page_offset(
+					  pgftl, (size_t)io->offset + done);
+		if (len > io->count - done) {
+			len = io->count - done;
+		}
+
+		request = device_alloc_request(DEVICE_DEFAULT_REQUEST);
+		if (request == NULL) {
+			pr_err("fail to allocate request structure\n");
+			ret = -ENOMEM;
+			goto exception;
+		}
+		request->flag = io->opcode == FLASH_IO_WRITE ? DEVICE_WRITE :
+							      DEVICE_READ;
+		request->data_len = len;
+		request->sector = (size_t)io->offset + done;
+		request->data = (char *)io->buffer + done;
+
+		cmds[i].request = request;
+		cmds[i].end_cmd = page_ftl_async_end_cmd;
+		cmds[i].cmd_private = (void *)aio;
+		done += len;
+	}
+
+	aio->pgftl = pgftl;
+	aio->io = io;
+	aio->cmds = cmds;
+	aio->error = 0;
+	aio->size = 0;
+	g_atomic_int_set(&aio->nr_remains, (gint)nr_cmds);
+	page_ftl_mq_start_io(pgftl, io);
+
+	/** `aio` can be released by the workers after the last submission */
+	for (i = 0; i < nr_cmds; i++) {
+		struct page_ftl_mq_cmd *cmd = &cmds[i];
+		int err = page_ftl_mq_submit(pgftl, cmd);
+		if (err) {
+			cmd->ret = err;
+			page_ftl_async_end_cmd(cmd);
+		}
+	}
+	return 0;
 
 exception:
-	if (temp) {
-		free(temp);
+	if (cmds) {
+		for (i = 0; i < nr_cmds; i++) {
+			if (cmds[i].request) {
+				device_free_request(cmds[i].request);
+			}
+		}
+		free(cmds);
 	}
-	if (request) {
-		device_free_request(request);
+	free(aio);
+	return ret;
+}
+
+/**
+ * @brief reap the completed asynchronous I/Os
+ *
+ * @param flash pointer of the flash device information
+ * @param ios array which receives the completed I/Os
+ * @param min_nr minimum number of I/Os to wait for
+ * @param max_nr size of the `ios` array
+ *
+ * @return number of the reaped I/Os, negative number for fail
+ */
+static int page_ftl_poll_interface(struct flash_device *flash,
+				   struct flash_io **ios, size_t min_nr,
+				   size_t max_nr)
+{
+	struct page_ftl *pgftl = NULL;
+
+	if (flash == NULL) {
+		pr_err("flash pointer doesn't exist\n");
+		return -EINVAL;
 	}
-	return size;
+	pgftl = (struct page_ftl *)flash->f_private;
+	if (pgftl == NULL || pgftl->mq == NULL) {
+		pr_err("page FTL is not opened\n");
+		return -EINVAL;
+	}
+	return page_ftl_mq_poll(pgftl, ios, min_nr, max_nr);
 }
 
 /**
@@ -317,6 +532,9 @@ static int page_ftl_ioctl_interface(struct flash_device *flash,
 		ret = (int)page_ftl_gc_from_list(pgftl, device_rq,
 						 PAGE_FTL_GC_ALL);
 		break;
+	case PAGE_FTL_IOCTL_FLUSH:
+		ret = page_ftl_journal_flush(pgftl);
+		break;
 	default:
 		pr_err("invalid command requested(commands: %u)\n", request);
 		return -EINVAL;
@@ -334,6 +552,8 @@ const struct flash_operations __page_fops = {
 	.read = page_ftl_read_interface,
 	.ioctl = page_ftl_ioctl_interface,
 	.close = page_ftl_close_interface,
+	.submit = page_ftl_submit_interface,
+	.poll = page_ftl_poll_interface,
 };
 
 /**
@@ -361,6 +581,7 @@ int page_ftl_module_init(struct flash_device *flash, uint64_t flags)
 		goto exception;
 	}
 	memset(pgftl, 0, sizeof(*pgftl));
+	pgftl->cache_policy = PAGE_FTL_CACHE_POLICY;
 
 	err = device_module_init(modnum, &pgftl->dev, 0);
 	if (err) {
@@ -0,0 +1,790 @@
+/**
+ * @file page-journal.c
+ * @brief mapping-delta journal with group commit for page ftl
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <time.h>
+#include <glib.h>
+
+#include "page.h"
+#include "log.h"
+#include "bits.h"
+#include "device.h"
+
+/**
+ * @brief get the number of deltas in a journal page
+ *
+ * @param pgftl pointer of the page FTL structure
+ *
+ * @return the number of entries per journal page
+ */
+static size_t page_ftl_journal_get_entries_per_page(struct page_ftl *pgftl)
+{
+	return (device_get_page_size(pgftl->dev) -
+		sizeof(struct page_ftl_journal_header)) /
+	       sizeof(struct page_ftl_journal_entry);
+}
+
+/**
+ * @brief get the first physical page number of the segment
+ *
+ * @param segnum segment number
+ *
+ * @return physical page number of the segment's first page
+ */
+static uint32_t page_ftl_journal_get_base(size_t segnum)
+{
+	struct device_address paddr;
+	paddr.lpn = 0;
+	paddr.format.block = (uint16_t)segnum;
+	return paddr.lpn;
+}
+
+/**
+ * @brief journal write's end request function
+ *
+ * @param request the request which is submitted before
+ */
+static void page_ftl_journal_write_end_rq(struct device_request *request)
+{
+	struct page_ftl *pgftl = (struct page_ftl *)request->rq_private;
+	device_free_buffer(pgftl->dev, request->data);
+	device_free_request(request);
+}
+
+/**
+ * @brief write a page to the tail of the current journal segment
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param flags header flags of the page
+ * @param seqnum sequence number of the page
+ * @param entries deltas which are written to the page
+ * @param nr_entries number of deltas (must fit to a page)
+ *
+ * @return 0 for success, negative number for fail
+ */
+static int page_ftl_journal_write_page(struct page_ftl *pgftl, uint32_t flags,
+				       uint64_t seqnum,
+				       struct page_ftl_journal_entry *entries,
+				       size_t nr_entries)
+{
+	struct page_ftl_journal *journal = pgftl->journal;
+	struct page_ftl_journal_header *header;
+	struct device *dev = pgftl->dev;
+	struct device_request *request;
+
+	size_t page_size;
+	ssize_t ret;
+	char *buffer;
+
+	page_size = device_get_page_size(dev);
+	buffer = (char *)device_alloc_buffer(dev, DEVICE_BUFFER_ZERO);
+	if (buffer == NULL) {
+		pr_err("memory allocation failed\n");
+		return -ENOMEM;
+	}
+	header = (struct page_ftl_journal_header *)buffer;
+	header->magic = PAGE_FTL_JOURNAL_MAGIC;
+	header->flags = flags;
+	header->generation = journal->generation;
+	header->seqnum = seqnum;
+	header->index = (uint32_t)journal->page;
+	header->nr_entries = (uint32_t)nr_entries;
+	memcpy(&buffer[sizeof(*header)], entries,
+	       nr_entries * sizeof(struct page_ftl_journal_entry));
+
+	request = device_alloc_request(DEVICE_DEFAULT_REQUEST);
+	if (request == NULL) {
+		pr_err("request allocation failed\n");
+		device_free_buffer(dev, buffer);
+		return -ENOMEM;
+	}
+	request->flag = DEVICE_WRITE;
+	request->data = buffer;
+	request->rq_private = (void *)pgftl;
+	request->data_len = page_size;
+	request->paddr.lpn = page_ftl_journal_get_base(journal->segnum) +
+			     (uint32_t)journal->page;
+	request->end_rq = page_ftl_journal_write_end_rq;
+
+	ret = dev->d_op->write(dev, request);
+	if (ret != (ssize_t)page_size) {
+		pr_err("journal write failed (segnum: %zu, page: %zu)\n",
+		       journal->segnum, journal->page);
+		return ret < 0 ? (int)ret : -EIO;
+	}
+	journal->page++;
+	return 0;
+}
+
+/**
+ * @brief start the new generation on the other journal segment
+ *
+ * @param pgftl pointer of the page FTL structure
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * The new generation starts with the snapshot of the mappings which are not
+ * covered by a summary block. Summaries and this snapshot contain every
+ * pending delta, so the pending deltas are dropped here.
+ *
+ * The pending deltas are dropped before the segments are scanned. A writer
+ * updates the p2l table before appending its delta, so every dropped delta
+ * is visible to the scan, and a delta appended after the drop is kept.
+ */
+static int page_ftl_journal_switch(struct page_ftl *pgftl)
+{
+	struct page_ftl_journal *journal = pgftl->journal;
+	struct page_ftl_journal_entry *snapshot = NULL;
+	struct device_address paddr;
+
+	size_t nr_segments, nr_data_pages, entries_per_page;
+	size_t nr_snapshot, nr_snapshot_pages, snapshot_size;
+	size_t next_segnum, segnum, page, idx;
+	uint64_t seqnum;
+
+	int ret = 0;
+
+	nr_segments = device_get_nr_segments(pgftl->dev);
+	nr_data_pages = page_ftl_get_data_pages(pgftl);
+	entries_per_page = page_ftl_journal_get_entries_per_page(pgftl);
+
+	next_segnum = (journal->segnum + 1) % PAGE_FTL_JOURNAL_NR_SEGMENTS;
+	paddr.lpn = page_ftl_journal_get_base(next_segnum);
+	ret = page_ftl_segment_erase(pgftl, paddr);
+	if (ret) {
+		pr_err("erase the journal segment failed (segnum: %zu)\n",
+		       next_segnum);
+		return ret;
+	}
+
+	pthread_mutex_lock(&journal->mutex);
+	journal->nr_pending = 0;
+	seqnum = page_ftl_get_next_seqnum(pgftl);
+	pthread_mutex_unlock(&journal->mutex);
+
+	snapshot_size = entries_per_page;
+	snapshot = (struct page_ftl_journal_entry *)malloc(
+		snapshot_size * sizeof(struct page_ftl_journal_entry));
+	if (snapshot == NULL) {
+		pr_err("memory allocation failed\n");
+		return -ENOMEM;
+	}
+	nr_snapshot = 0;
+	for (segnum = PAGE_FTL_JOURNAL_NR_SEGMENTS; segnum < nr_segments;
+	     segnum++) {
+		struct page_ftl_segment *segment = &pgftl->segments[segnum];
+		uint32_t base = page_ftl_journal_get_base(segnum);
+		if (g_atomic_int_get(&segment->has_summary)) {
+			continue;
+		}
+		pthread_mutex_lock(&segment->mutex);
+		for (page = 0; page < nr_data_pages; page++) {
+			uint32_t lpn = pgftl->p2l_map[base + page];
+			if (lpn == PADDR_EMPTY) {
+				continue;
+			}
+			if (nr_snapshot == snapshot_size) {
+				struct page_ftl_journal_entry *entries;
+				size_t size = snapshot_size * 2 *
+					      sizeof(*snapshot);
+				entries = (struct page_ftl_journal_entry *)
+					realloc(snapshot, size);
+				if (entries == NULL) {
+					pthread_mutex_unlock(&segment->mutex);
+					pr_err("memory allocation failed\n");
+					ret = -ENOMEM;
+					goto exit;
+				}
+				snapshot = entries;
+				snapshot_size *= 2;
+			}
+			snapshot[nr_snapshot].lpn = lpn;
+			snapshot[nr_snapshot].ppn = base + (uint32_t)page;
+			nr_snapshot++;
+		}
+		pthread_mutex_unlock(&segment->mutex);
+	}
+
+	nr_snapshot_pages =
+		(nr_snapshot + entries_per_page - 1) / entries_per_page;
+	if (nr_snapshot_pages == 0) {
+		nr_snapshot_pages = 1;
+	}
+	if (nr_snapshot_pages >= device_get_pages_per_segment(pgftl->dev)) {
+		pr_err("snapshot exceeds the journal segment (entries: %zu)\n",
+		       nr_snapshot);
+		ret = -ENOSPC;
+		goto exit;
+	}
+
+	journal->segnum = next_segnum;
+	journal->page = 0;
+	journal->generation++;
+	for (idx = 0; idx < nr_snapshot_pages; idx++) {
+		size_t start = idx * entries_per_page;
+		size_t nr_entries = nr_snapshot - start < entries_per_page ?
+					    nr_snapshot - start :
+					    entries_per_page;
+		uint32_t flags = PAGE_FTL_JOURNAL_SNAPSHOT;
+		if (idx + 1 == nr_snapshot_pages) {
+			flags |= PAGE_FTL_JOURNAL_SNAPSHOT_END;
+		}
+		ret = page_ftl_journal_write_page(pgftl, flags, seqnum,
+						  &snapshot[start], nr_entries);
+		if (ret) {
+			goto exit;
+		}
+	}
+	pr_debug("journal generation %" PRIu64 " starts (segnum: %zu, "
+		 "snapshot: %zu)\n",
+		 journal->generation, journal->segnum, nr_snapshot);
+exit:
+	free(snapshot);
+	return ret;
+}
+
+/**
+ * @brief write the deltas to the journal
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param entries deltas to commit
+ * @param nr_entries number of deltas
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * Only the commit thread calls this function after the journal starts.
+ */
+static int page_ftl_journal_commit(struct page_ftl *pgftl,
+				   struct page_ftl_journal_entry *entries,
+				   size_t nr_entries)
+{
+	struct page_ftl_journal *journal = pgftl->journal;
+	size_t entries_per_page, pages_per_segment;
+	size_t pos = 0;
+	int ret;
+
+	entries_per_page = page_ftl_journal_get_entries_per_page(pgftl);
+	pages_per_segment = device_get_pages_per_segment(pgftl->dev);
+	while (pos < nr_entries) {
+		size_t nr_commit;
+		if (journal->page >= pages_per_segment) {
+			/** the snapshot contains the remaining deltas */
+			return page_ftl_journal_switch(pgftl);
+		}
+		nr_commit = nr_entries - pos < entries_per_page ?
+				    nr_entries - pos :
+				    entries_per_page;
+		ret = page_ftl_journal_write_page(
+			pgftl, 0, page_ftl_get_next_seqnum(pgftl),
+			&entries[pos], nr_commit);
+		if (ret) {
+			return ret;
+		}
+		pos += nr_commit;
+	}
+	return 0;
+}
+
+/**
+ * @brief group commit thread
+ *
+ * @param data pointer of the page FTL structure
+ *
+ * @return NULL
+ *
+ * @note
+ * Deltas gathered during the commit interval are written together. The
+ * commit starts early when the pending deltas reach the commit size or
+ * somebody requests the flush.
+ *
+ * A failed commit leaves a hole in the journal, so the later deltas are
+ * never made durable either. The error is kept in `journal->error` and
+ * `nr_committed` stops at the last durable batch.
+ */
+static void *page_ftl_journal_thread(void *data)
+{
+	struct page_ftl *pgftl = (struct page_ftl *)data;
+	struct page_ftl_journal *journal = pgftl->journal;
+
+	while (1) {
+		struct page_ftl_journal_entry *entries;
+		struct timespec deadline;
+		size_t nr_entries, size;
+		uint64_t ticket;
+		int is_exit, ret;
+
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += PAGE_FTL_JOURNAL_COMMIT_INTERVAL * 1000000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+
+		pthread_mutex_lock(&journal->mutex);
+		while (!journal->is_exit && !journal->is_flush &&
+		       journal->nr_pending < PAGE_FTL_JOURNAL_COMMIT_SIZE) {
+			if (pthread_cond_timedwait(&journal->cond,
+						   &journal->mutex,
+						   &deadline) == ETIMEDOUT) {
+				break;
+			}
+		}
+		entries = journal->pending;
+		size = journal->pending_size;
+		nr_entries = journal->nr_pending;
+		journal->pending = journal->spare;
+		journal->pending_size = journal->spare_size;
+		journal->spare = entries;
+		journal->spare_size = size;
+		journal->nr_pending = 0;
+		journal->is_flush = 0;
+		ticket = journal->nr_appended;
+		is_exit = journal->is_exit;
+		ret = journal->error;
+		pthread_mutex_unlock(&journal->mutex);
+
+		if (ret == 0) {
+			ret = page_ftl_journal_commit(pgftl, entries,
+						      nr_entries);
+			if (ret) {
+				pr_err("journal commit failed (errno: %d)\n",
+				       ret);
+			}
+		}
+
+		pthread_mutex_lock(&journal->mutex);
+		if (ret) {
+			journal->error = ret;
+		} else {
+			journal->nr_committed = ticket;
+		}
+		pthread_cond_broadcast(&journal->commit_cond);
+		pthread_mutex_unlock(&journal->mutex);
+
+		if (is_exit) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief allocate the journal and reserve the journal segments
+ *
+ * @param pgftl pointer of the page FTL structure
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * This must be called after the segment initialization.
+ */
+int page_ftl_journal_init(struct page_ftl *pgftl)
+{
+	struct page_ftl_journal *journal;
+	size_t pages_per_segment, segnum, page;
+
+	if (device_get_nr_segments(pgftl->dev) <=
+	    PAGE_FTL_JOURNAL_NR_SEGMENTS) {
+		pr_err("not enough segments for the journal\n");
+		return -ENOSPC;
+	}
+
+	journal = (struct page_ftl_journal *)malloc(
+		sizeof(struct page_ftl_journal));
+	if (journal == NULL) {
+		pr_err("memory allocation failed\n");
+		return -ENOMEM;
+	}
+	memset(journal, 0, sizeof(struct page_ftl_journal));
+	pthread_mutex_init(&journal->mutex, NULL);
+	pthread_cond_init(&journal->cond, NULL);
+	pthread_cond_init(&journal->commit_cond, NULL);
+	pgftl->journal = journal;
+
+	journal->pending_size = page_ftl_journal_get_entries_per_page(pgftl);
+	journal->spare_size = journal->pending_size;
+	journal->pending = (struct page_ftl_journal_entry *)malloc(
+		journal->pending_size * sizeof(struct page_ftl_journal_entry));
+	journal->spare = (struct page_ftl_journal_entry *)malloc(
+		journal->spare_size * sizeof(struct page_ftl_journal_entry));
+	if (journal->pending == NULL || journal->spare == NULL) {
+		pr_err("memory allocation failed\n");
+		return -ENOMEM;
+	}
+
+	pages_per_segment = device_get_pages_per_segment(pgftl->dev);
+	journal->segnum = PAGE_FTL_JOURNAL_NR_SEGMENTS - 1;
+	journal->page = pages_per_segment;
+	journal->generation = 0;
+
+	/** the journal segments never be allocated to the user data */
+	for (segnum = 0; segnum < PAGE_FTL_JOURNAL_NR_SEGMENTS; segnum++) {
+		uint64_t *use_bits = page_ftl_get_use_bits(pgftl, segnum);
+		for (page = 0; page < pages_per_segment; page++) {
+			set_bit(use_bits, page);
+		}
+		g_atomic_int_set(&pgftl->nr_free[segnum], 0);
+		page_ftl_update_free_segment(pgftl, segnum);
+	}
+	return 0;
+}
+
+/**
+ * @brief start the new journal generation and the commit thread
+ *
+ * @param pgftl pointer of the page FTL structure
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * This must be called after the recovery. The previous generation is kept
+ * until the new generation's snapshot is written.
+ */
+int page_ftl_journal_start(struct page_ftl *pgftl)
+{
+	struct page_ftl_journal *journal = pgftl->journal;
+	int ret;
+
+	ret = page_ftl_journal_switch(pgftl);
+	if (ret) {
+		pr_err("journal generation start failed\n");
+		return ret;
+	}
+
+	ret = pthread_create(&journal->thread, NULL, page_ftl_journal_thread,
+			     (void *)pgftl);
+	if (ret) {
+		pr_err("journal thread creation failed\n");
+		return -ret;
+	}
+	journal->is_running = 1;
+	return 0;
+}
+
+/**
+ * @brief append the mapping delta to the pending buffer
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param lpn logical page number
+ * @param ppn newly mapped physical page number
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * The caller holds the LPN's stripe lock, so the deltas of an LPN are
+ * appended in the mapping update order. This never waits for the commit.
+ * The dropped delta makes the journal's error sticky like the failed commit.
+ */
+int page_ftl_journal_append(struct page_ftl *pgftl, size_t lpn, uint32_t ppn)
+{
+	struct page_ftl_journal *journal = pgftl->journal;
+	struct page_ftl_journal_entry *entry;
+
+	if (journal == NULL) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&journal->mutex);
+	if (journal->nr_pending == journal->pending_size) {
+		struct page_ftl_journal_entry *pending;
+		size_t size = journal->pending_size * 2;
+		pending = (struct page_ftl_journal_entry *)realloc(
+			journal->pending,
+			size * sizeof(struct page_ftl_journal_entry));
+		if (pending == NULL) {
+			if (journal->error == 0) {
+				journal->error = -ENOMEM;
+			}
+			pthread_cond_broadcast(&journal->commit_cond);
+			pthread_mutex_unlock(&journal->mutex);
+			pr_err("memory allocation failed\n");
+			return -ENOMEM;
+		}
+		journal->pending = pending;
+		journal->pending_size = size;
+	}
+	entry = &journal->pending[journal->nr_pending++];
+	entry->lpn = (uint32_t)lpn;
+	entry->ppn = ppn;
+	journal->nr_appended++;
+	if (journal->nr_pending >= PAGE_FTL_JOURNAL_COMMIT_SIZE) {
+		pthread_cond_signal(&journal->cond);
+	}
+	pthread_mutex_unlock(&journal->mutex);
+	return 0;
+}
+
+/**
+ * @brief force the commit and wait until the previous deltas are durable
+ *
+ * @param pgftl pointer of the page FTL structure
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * The concurrent flushes are merged into a single commit. Once a commit
+ * fails, every flush returns its error because the deltas are not durable.
+ */
+int page_ftl_journal_flush(struct page_ftl *pgftl)
+{
+	struct page_ftl_journal *journal = pgftl->journal;
+	uint64_t ticket;
+	int ret;
+
+	if (journal == NULL || !journal->is_running) {
+		pr_err("journal is not running\n");
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&journal->mutex);
+	ticket = journal->nr_appended;
+	journal->is_flush = 1;
+	pthread_cond_signal(&journal->cond);
+	while (journal->nr_committed < ticket && !journal->error) {
+		pthread_cond_wait(&journal->commit_cond, &journal->mutex);
+	}
+	ret = journal->error;
+	pthread_mutex_unlock(&journal->mutex);
+	if (ret) {
+		pr_err("journal is not durable (errno: %d)\n", ret);
+	}
+	return ret;
+}
+
+/**
+ * @brief read a journal segment's pages which belong to the generation
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param segnum journal segment number
+ * @param generation expected generation number
+ * @param pages array which receives the pages (pages per segment entries)
+ * @param buffer page-sized temporary buffer
+ *
+ * @return number of loaded pages, 0 means the snapshot is not complete,
+ * negative number for fail
+ *
+ * @note
+ * The journal ends at the first page which doesn't belong to the
+ * generation. The read failure is returned instead, because the deltas
+ * after it would be dropped silently.
+ */
+static ssize_t
+page_ftl_journal_load_segment(struct page_ftl *pgftl, size_t segnum,
+			      uint64_t generation,
+			      struct page_ftl_journal_page *pages, char *buffer)
+{
+	struct page_ftl_journal_header *header;
+	size_t entries_per_page, pages_per_segment;
+	size_t page, idx;
+	ssize_t ret = 0;
+	int is_snapshot_end = 0;
+
+	entries_per_page = page_ftl_journal_get_entries_per_page(pgftl);
+	pages_per_segment = device_get_pages_per_segment(pgftl->dev);
+	header = (struct page_ftl_journal_header *)buffer;
+	for (page = 0; page < pages_per_segment; page++) {
+		struct page_ftl_journal_entry *entries;
+		uint32_t ppn = page_ftl_journal_get_base(segnum) +
+			       (uint32_t)page;
+		ret = page_ftl_read_ppn(pgftl, ppn, buffer);
+		if (ret < 0) {
+			pr_err("journal read failed (segnum: %zu, page: %zu)\n",
+			       segnum, page);
+			goto exception;
+		}
+		ret = 0;
+		if (header->magic != PAGE_FTL_JOURNAL_MAGIC ||
+		    header->generation != generation ||
+		    header->index != (uint32_t)page ||
+		    header->nr_entries > entries_per_page) {
+			break;
+		}
+		if (!is_snapshot_end &&
+		    !(header->flags & PAGE_FTL_JOURNAL_SNAPSHOT)) {
+			break;
+		}
+		entries = (struct page_ftl_journal_entry *)malloc(
+			header->nr_entries *
+				sizeof(struct page_ftl_journal_entry) +
+			1);
+		if (entries == NULL) {
+			pr_err("memory allocation failed\n");
+			ret = -ENOMEM;
+			goto exception;
+		}
+		memcpy(entries, &buffer[sizeof(*header)],
+		       header->nr_entries *
+			       sizeof(struct page_ftl_journal_entry));
+		pages[page].seqnum = header->seqnum;
+		pages[page].nr_entries = header->nr_entries;
+		pages[page].entries = entries;
+		if (header->flags & PAGE_FTL_JOURNAL_SNAPSHOT_END) {
+			is_snapshot_end = 1;
+		}
+	}
+	if (is_snapshot_end) {
+		return (ssize_t)page;
+	}
+exception:
+	for (idx = 0; idx < page; idx++) {
+		free(pages[idx].entries);
+	}
+	return ret;
+}
+
+/**
+ * @brief load the newest complete journal generation
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param __pages pointer which receives the loaded page array
+ * @param nr_pages pointer which receives the number of loaded pages
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * The generation whose snapshot is torn is ignored and the older generation
+ * is used instead. But, the read failure aborts the loading because the
+ * newer generation can't be told from the missing one. The loaded pages
+ * must be freed by `page_ftl_journal_free_pages()`.
+ */
+int page_ftl_journal_load(struct page_ftl *pgftl,
+			  struct page_ftl_journal_page **__pages,
+			  size_t *nr_pages)
+{
+	struct page_ftl_journal *journal = pgftl->journal;
+	struct page_ftl_journal_header *header;
+	struct page_ftl_journal_page *pages;
+	uint64_t generations[PAGE_FTL_JOURNAL_NR_SEGMENTS];
+	size_t pages_per_segment, segnum, idx;
+	ssize_t ret = 0;
+	char *buffer;
+
+	*__pages = NULL;
+	*nr_pages = 0;
+
+	pages_per_segment = device_get_pages_per_segment(pgftl->dev);
+	buffer = (char *)malloc(device_get_page_size(pgftl->dev));
+	pages = (struct page_ftl_journal_page *)malloc(
+		pages_per_segment * sizeof(struct page_ftl_journal_page));
+	if (buffer == NULL || pages == NULL) {
+		pr_err("memory allocation failed\n");
+		free(buffer);
+		free(pages);
+		return -ENOMEM;
+	}
+
+	header = (struct page_ftl_journal_header *)buffer;
+	for (segnum = 0; segnum < PAGE_FTL_JOURNAL_NR_SEGMENTS; segnum++) {
+		generations[segnum] = 0;
+		ret = page_ftl_read_ppn(
+			pgftl, page_ftl_journal_get_base(segnum), buffer);
+		if (ret < 0) {
+			pr_err("journal header read failed (segnum: %zu)\n",
+			       segnum);
+			goto exit;
+		}
+		ret = 0;
+		if (header->magic == PAGE_FTL_JOURNAL_MAGIC &&
+		    header->index == 0) {
+			generations[segnum] = header->generation;
+		}
+	}
+
+	/** try from the newest generation */
+	for (idx = 0; idx < PAGE_FTL_JOURNAL_NR_SEGMENTS; idx++) {
+		size_t newest = PAGE_FTL_JOURNAL_NR_SEGMENTS;
+		for (segnum = 0; segnum < PAGE_FTL_JOURNAL_NR_SEGMENTS;
+		     segnum++) {
+			if (generations[segnum] == 0) {
+				continue;
+			}
+			if (newest == PAGE_FTL_JOURNAL_NR_SEGMENTS ||
+			    generations[segnum] > generations[newest]) {
+				newest = segnum;
+			}
+		}
+		if (newest == PAGE_FTL_JOURNAL_NR_SEGMENTS) {
+			break;
+		}
+		ret = page_ftl_journal_load_segment(
+			pgftl, newest, generations[newest], pages, buffer);
+		if (ret < 0) {
+			goto exit;
+		}
+		*nr_pages = (size_t)ret;
+		ret = 0;
+		if (*nr_pages) {
+			journal->segnum = newest;
+			journal->page = *nr_pages;
+			journal->generation = generations[newest];
+			break;
+		}
+		pr_warn("torn journal generation detected (generation: %" PRIu64
+			")\n",
+			generations[newest]);
+		generations[newest] = 0;
+	}
+exit:
+	free(buffer);
+	if (*nr_pages == 0) {
+		free(pages);
+		return (int)ret;
+	}
+	*__pages = pages;
+	return 0;
+}
+
+/**
+ * @brief free the pages loaded by the `page_ftl_journal_load()`
+ *
+ * @param pages page array to free
+ * @param nr_pages number of loaded pages
+ */
+void page_ftl_journal_free_pages(struct page_ftl_journal_page *pages,
+				 size_t nr_pages)
+{
+	size_t idx;
+	if (pages == NULL) {
+		return;
+	}
+	for (idx = 0; idx < nr_pages; idx++) {
+		free(pages[idx].entries);
+	}
+	free(pages);
+}
+
+/**
+ * @brief commit the remaining deltas and deallocate the journal
+ *
+ * @param pgftl pointer of the page FTL structure
+ */
+void page_ftl_journal_exit(struct page_ftl *pgftl)
+{
+	struct page_ftl_journal *journal = pgftl->journal;
+	if (journal == NULL) {
+		return;
+	}
+	if (journal->is_running) {
+		pthread_mutex_lock(&journal->mutex);
+		journal->is_exit = 1;
+		pthread_cond_signal(&journal->cond);
+		pthread_mutex_unlock(&journal->mutex);
+		pthread_join(journal->thread, NULL);
+		journal->is_running = 0;
+	}
+	pthread_mutex_destroy(&journal->mutex);
+	pthread_cond_destroy(&journal->cond);
+	pthread_cond_destroy(&journal->commit_cond);
+	free(journal->pending);
+	free(journal->spare);
+	free(journal);
+	pgftl->journal = NULL;
+}
@@ -6,6 +6,7 @@
  * @date 2021-10-05
  */
 #include "bits.h"
+#include "hbitmap.h"
 #include "page.h"
 #include "device.h"
 #include "log.h"
@@ -13,79 +14,102 @@
 #include <errno.h>
 #include <inttypes.h>
 
+/**
+ * @brief reflect the segment's free pages to the free segment bitmap
+ *
+ * @param pgftl pointer of the page-ftl structure
+ * @param segnum segment number
+ *
+ * @note
+ * The caller must hold the `pgftl->alloc_mutex` after the page ftl opens.
+ * The bad segment never has the bit.
+ */
+void page_ftl_update_free_segment(struct page_ftl *pgftl, size_t segnum)
+{
+	struct device *dev = pgftl->dev;
+
+	if (g_atomic_int_get(&pgftl->nr_free[segnum]) > 0 &&
+	    !(dev->badseg_bitmap && get_bit(dev->badseg_bitmap, segnum))) {
+		hbitmap_set_bit(pgftl->free_segs, segnum);
+	} else {
+		hbitmap_reset_bit(pgftl->free_segs, segnum);
+	}
+}
+
 /**
  * @brief get page from the segment
  *
  * @param pgftl pointer of the page-ftl structure
  *
  * @return free space's device address
+ *
+ * @note
+ * The caller must hold the `pgftl->alloc_mutex` which protects the segment
+ * choice (`free_segs` and `alloc_segnum`). The page itself is claimed by
+ * the atomic operation on the `use_bits`.
+ * The segments are used in order from the last allocated segment.
  */
 struct device_address page_ftl_get_free_page(struct page_ftl *pgftl)
 {
 	struct device_address paddr;
 	struct device *dev;
 
-	struct page_ftl_segment *segment;
-
-	size_t nr_segments;
 	size_t pages_per_segment;
 	size_t segnum;
-	size_t idx;
 
 	uint64_t nr_free_pages;
-	uint64_t nr_valid_pages;
 	uint32_t page;
 
 	dev = pgftl->dev;
-	nr_segments = device_get_nr_segments(dev);
 	pages_per_segment = device_get_pages_per_segment(dev);
 
 	paddr.lpn = PADDR_EMPTY;
-	idx = 0;
 
 retry:
-	if (idx == nr_segments) {
+	segnum = (size_t)hbitmap_find_first_one_bit(pgftl->free_segs,
+						    pgftl->alloc_segnum);
+	if (segnum == (size_t)BITS_NOT_FOUND) {
+		segnum = (size_t)hbitmap_find_first_one_bit(pgftl->free_segs,
+							    0);
+	}
+	if (segnum == (size_t)BITS_NOT_FOUND) {
 		pr_err("cannot find the free page in the device\n");
 		paddr.lpn = PADDR_EMPTY;
 		return paddr;
 	}
-	segnum = ((size_t)pgftl->alloc_segnum + idx) % nr_segments;
-	idx += 1;
 
+	/** the device can mark the segment as bad after it is erased */
 	if (dev->badseg_bitmap && get_bit(dev->badseg_bitmap, segnum)) {
+		hbitmap_reset_bit(pgftl->free_segs, segnum);
 		goto retry;
 	}
 
-	segment = &pgftl->segments[segnum];
-	if (segment == NULL) {
-		pr_err("fatal error detected: cannot find the segnum %zu\n",
-		       segnum);
-		paddr.lpn = PADDR_EMPTY;
-		return paddr;
-	}
-	nr_free_pages = (uint64_t)g_atomic_int_get(&segment->nr_free_pages);
+	nr_free_pages = (uint64_t)g_atomic_int_get(&pgftl->nr_free[segnum]);
 	if (nr_free_pages == 0) {
+		hbitmap_reset_bit(pgftl->free_segs, segnum);
 		goto retry;
 	}
 	pgftl->alloc_segnum = segnum;
 
-	page = (uint32_t)find_first_zero_bit(segment->use_bits,
-					     pages_per_segment, 0);
+	page = (uint32_t)claim_first_zero_bit_atomic(
+		page_ftl_get_use_bits(pgftl, segnum), pages_per_segment, 0);
 	if (page == (uint32_t)BITS_NOT_FOUND) {
 		pr_warn("nr_free_pages and use_bits bitmap are not synchronized(nr_free_pages: %" PRIu64
 			", page: %u)\n",
 			nr_free_pages, page);
+		hbitmap_reset_bit(pgftl->free_segs, segnum);
 		goto retry;
 	}
 	paddr.lpn = 0;
 	paddr.format.block = (uint16_t)segnum;
 	paddr.lpn |= page;
 
-	set_bit(segment->use_bits, page);
-	g_atomic_int_set(&segment->nr_free_pages, (gint)nr_free_pages - 1);
+	g_atomic_int_set(&pgftl->nr_free[segnum], (gint)nr_free_pages - 1);
+	if (nr_free_pages == 1) {
+		hbitmap_reset_bit(pgftl->free_segs, segnum);
+	}
 
-	nr_valid_pages = (uint64_t)g_atomic_int_get(&segment->nr_valid_pages);
-	g_atomic_int_set(&segment->nr_valid_pages, (gint)nr_valid_pages + 1);
+	g_atomic_int_inc(&pgftl->nr_valid[segnum]);
 
 	return paddr;
 }
@@ -95,13 +119,19 @@ retry:
  *
  * @param pgftl pointer of the page FTL structure
  * @param sector logical address for mapping table
+ * @param old_ppn physical address which the caller observed before
  * @param ppn physical address for mapping table
  *
  * @return 0 to success, negative number to fail
+ *
+ * @note
+ * The entry is updated by the compare-and-swap, so the readers never see
+ * the intermediate state. -EAGAIN means the entry is changed after the
+ * caller observed `old_ppn`.
  */
-int page_ftl_update_map(struct page_ftl *pgftl, size_t sector, uint32_t ppn)
+int page_ftl_update_map(struct page_ftl *pgftl, size_t sector, uint32_t old_ppn,
+			uint32_t ppn)
 {
-	uint32_t *trans_map;
 	uint64_t lpn;
 	size_t map_size;
 
@@ -115,8 +145,8 @@ int page_ftl_update_map(struct page_ftl *pgftl, size_t sector, uint32_t ppn)
 		return -EINVAL;
 	}
 
-	trans_map = pgftl->trans_map;
-	trans_map[lpn] = ppn;
-
+	if (!page_ftl_map_cas(pgftl, (size_t)lpn, old_ppn, ppn)) {
+		return -EAGAIN;
+	}
 	return 0;
 }
@@ -0,0 +1,637 @@
+/**
+ * @file page-mq.c
+ * @brief multi-queue request submission for page ftl
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include "page.h"
+#include "log.h"
+#include "device.h"
+
+/**
+ * @brief worker thread's argument
+ */
+struct page_ftl_mq_worker_arg {
+	struct page_ftl *pgftl;
+	size_t id;
+};
+
+/**
+ * @brief completion information of the synchronous submission
+ */
+struct page_ftl_mq_wait {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int is_finish;
+};
+
+/**
+ * @brief completion information of the batched submission
+ */
+struct page_ftl_mq_batch {
+	struct page_ftl_mq_wait wait;
+	gint nr_remains; /**< commands which are not completed */
+	gint error; /**< first error of the commands */
+	ssize_t size; /**< total processed size of the commands */
+};
+
+/**
+ * @brief pop the oldest command from the queue
+ *
+ * @param queue pointer of the submission queue
+ *
+ * @return pointer of the command, NULL when the queue is empty
+ */
+static struct page_ftl_mq_cmd *
+page_ftl_mq_queue_pop(struct page_ftl_mq_queue *queue)
+{
+	struct page_ftl_mq_cmd *cmd = NULL;
+
+	pthread_mutex_lock(&queue->mutex);
+	if (queue->nr_cmds > 0) {
+		cmd = queue->ring[queue->head];
+		queue->head = (queue->head + 1) % PAGE_FTL_MQ_QUEUE_DEPTH;
+		queue->nr_cmds--;
+		pthread_cond_signal(&queue->cond);
+	}
+	pthread_mutex_unlock(&queue->mutex);
+	return cmd;
+}
+
+/**
+ * @brief get a command for the worker
+ *
+ * @param mq pointer of the multi-queue information
+ * @param id worker's identifier
+ *
+ * @return pointer of the command, NULL when all queues are empty
+ *
+ * @note
+ * The worker serves its home queue first. When it is empty, the worker
+ * steals the command from the other queues.
+ */
+static struct page_ftl_mq_cmd *page_ftl_mq_get_cmd(struct page_ftl_mq *mq,
+						   size_t id)
+{
+	struct page_ftl_mq_cmd *cmd;
+	size_t home, i;
+
+	home = id % mq->nr_queues;
+	for (i = 0; i < mq->nr_queues; i++) {
+		struct page_ftl_mq_queue *queue;
+		queue = &mq->queues[(home + i) % mq->nr_queues];
+		cmd = page_ftl_mq_queue_pop(queue);
+		if (cmd == NULL) {
+			continue;
+		}
+		g_atomic_int_add(&mq->nr_pending, -1);
+		if (i > 0) {
+			g_atomic_int_inc(&mq->nr_steals);
+		}
+		return cmd;
+	}
+	return NULL;
+}
+
+/**
+ * @brief worker thread which processes the submitted commands
+ *
+ * @param data pointer of the worker's argument
+ *
+ * @return NULL
+ */
+static void *page_ftl_mq_worker(void *data)
+{
+	struct page_ftl_mq_worker_arg *arg =
+		(struct page_ftl_mq_worker_arg *)data;
+	struct page_ftl *pgftl = arg->pgftl;
+	struct page_ftl_mq *mq = pgftl->mq;
+	size_t id = arg->id;
+
+	free(arg);
+	while (1) {
+		struct page_ftl_mq_cmd *cmd;
+
+		cmd = page_ftl_mq_get_cmd(mq, id);
+		if (cmd != NULL) {
+			cmd->ret = page_ftl_process_request(pgftl,
+							    cmd->request);
+			if (cmd->end_cmd) {
+				cmd->end_cmd(cmd);
+			}
+			continue;
+		}
+
+		pthread_mutex_lock(&mq->mutex);
+		while (!mq->is_exit &&
+		       g_atomic_int_get(&mq->nr_pending) == 0) {
+			pthread_cond_wait(&mq->cond, &mq->mutex);
+		}
+		if (mq->is_exit && g_atomic_int_get(&mq->nr_pending) == 0) {
+			pthread_mutex_unlock(&mq->mutex);
+			break;
+		}
+		pthread_mutex_unlock(&mq->mutex);
+	}
+	return NULL;
+}
+
+/**
+ * @brief get the submission queue of the current CPU
+ *
+ * @param mq pointer of the multi-queue information
+ *
+ * @return pointer of the submission queue
+ */
+static struct page_ftl_mq_queue *page_ftl_mq_get_queue(struct page_ftl_mq *mq)
+{
+	int cpu = sched_getcpu();
+	if (cpu < 0) {
+		cpu = 0;
+	}
+	return &mq->queues[(size_t)cpu % mq->nr_queues];
+}
+
+/**
+ * @brief submit the command to the current CPU's queue
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param cmd pointer of the command
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * This function returns right after the command is queued. The result is
+ * delivered by `cmd->end_cmd`. The submitter waits only when the queue is
+ * full.
+ */
+int page_ftl_mq_submit(struct page_ftl *pgftl, struct page_ftl_mq_cmd *cmd)
+{
+	struct page_ftl_mq *mq = pgftl->mq;
+	struct page_ftl_mq_queue *queue;
+
+	if (mq == NULL || cmd == NULL || cmd->request == NULL) {
+		pr_err("null detected (mq:%p, cmd:%p)\n", mq, cmd);
+		return -EINVAL;
+	}
+
+	queue = page_ftl_mq_get_queue(mq);
+	pthread_mutex_lock(&queue->mutex);
+	while (queue->nr_cmds == PAGE_FTL_MQ_QUEUE_DEPTH) {
+		pthread_cond_wait(&queue->cond, &queue->mutex);
+	}
+	queue->ring[(queue->head + queue->nr_cmds) % PAGE_FTL_MQ_QUEUE_DEPTH] =
+		cmd;
+	queue->nr_cmds++;
+	pthread_mutex_unlock(&queue->mutex);
+
+	pthread_mutex_lock(&mq->mutex);
+	g_atomic_int_inc(&mq->nr_pending);
+	pthread_cond_signal(&mq->cond);
+	pthread_mutex_unlock(&mq->mutex);
+	return 0;
+}
+
+/**
+ * @brief end command function of the synchronous submission
+ *
+ * @param cmd pointer of the completed command
+ */
+static void page_ftl_mq_wait_end_cmd(struct page_ftl_mq_cmd *cmd)
+{
+	struct page_ftl_mq_wait *wait;
+
+	wait = (struct page_ftl_mq_wait *)cmd->cmd_private;
+
+	pthread_mutex_lock(&wait->mutex);
+	wait->is_finish = 1;
+	pthread_cond_signal(&wait->cond);
+	pthread_mutex_unlock(&wait->mutex);
+}
+
+/**
+ * @brief submit the request to the workers and wait for the completion
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param request pointer of the request
+ *
+ * @return same as the `page_ftl_process_request()`
+ */
+static ssize_t page_ftl_mq_submit_wait(struct page_ftl *pgftl,
+				       struct device_request *request)
+{
+	struct page_ftl_mq_wait wait;
+	struct page_ftl_mq_cmd cmd;
+	int ret;
+
+	pthread_mutex_init(&wait.mutex, NULL);
+	pthread_cond_init(&wait.cond, NULL);
+	wait.is_finish = 0;
+
+	cmd.request = request;
+	cmd.ret = 0;
+	cmd.end_cmd = page_ftl_mq_wait_end_cmd;
+	cmd.cmd_private = (void *)&wait;
+
+	ret = page_ftl_mq_submit(pgftl, &cmd);
+	if (ret == 0) {
+		pthread_mutex_lock(&wait.mutex);
+		while (!wait.is_finish) {
+			pthread_cond_wait(&wait.cond, &wait.mutex);
+		}
+		pthread_mutex_unlock(&wait.mutex);
+	}
+
+	pthread_mutex_destroy(&wait.mutex);
+	pthread_cond_destroy(&wait.cond);
+	return ret ? (ssize_t)ret : cmd.ret;
+}
+
+/**
+ * @brief submit the request to the page FTL
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param request pointer of the request
+ *
+ * @return same as the `page_ftl_process_request()`
+ *
+ * @note
+ * The caller waits for the completion anyway, so the request is issued
+ * directly on the caller when its CPU's queue is empty; this saves two
+ * context switches. Otherwise the request is queued behind the others and
+ * the caller waits for the worker. Before the workers start (e.g., during
+ * the recovery), the request is always processed on the caller.
+ */
+ssize_t page_ftl_submit_request(struct page_ftl *pgftl,
+				struct device_request *request)
+{
+	struct page_ftl_mq_queue *queue;
+
+	if (pgftl == NULL || request == NULL) {
+		pr_err("null detected (pgftl:%p, request:%p)\n", pgftl,
+		       request);
+		return -EINVAL;
+	}
+	if (pgftl->mq == NULL) {
+		return page_ftl_process_request(pgftl, request);
+	}
+	queue = page_ftl_mq_get_queue(pgftl->mq);
+	if (__atomic_load_n(&queue->nr_cmds, __ATOMIC_RELAXED) == 0) {
+		/** direct issue; nothing to overtake in this CPU's queue */
+		return page_ftl_process_request(pgftl, request);
+	}
+	return page_ftl_mq_submit_wait(pgftl, request);
+}
+
+/**
+ * @brief end command function of the batched submission
+ *
+ * @param cmd pointer of the completed command
+ */
+static void page_ftl_mq_batch_end_cmd(struct page_ftl_mq_cmd *cmd)
+{
+	struct page_ftl_mq_batch *batch;
+
+	batch = (struct page_ftl_mq_batch *)cmd->cmd_private;
+	if (cmd->ret <= 0) {
+		device_free_request(cmd->request);
+		g_atomic_int_compare_and_exchange(
+			&batch->error, 0, cmd->ret < 0 ? (gint)cmd->ret : -EIO);
+	} else {
+		__atomic_fetch_add(&batch->size, cmd->ret, __ATOMIC_RELAXED);
+	}
+	if (!g_atomic_int_dec_and_test(&batch->nr_remains)) {
+		return;
+	}
+	pthread_mutex_lock(&batch->wait.mutex);
+	batch->wait.is_finish = 1;
+	pthread_cond_signal(&batch->wait.cond);
+	pthread_mutex_unlock(&batch->wait.mutex);
+}
+
+/**
+ * @brief submit the requests together and wait once for all of them
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param requests array of the requests
+ * @param nr_requests number of the requests
+ *
+ * @return total processed size, negative number when any request fails
+ *
+ * @note
+ * Every request is released by this function whether it succeeds or not.
+ * The requests are spread over the workers, so the pages on the different
+ * buses are read at the same time. On a synchronous device with a single
+ * CPU, nothing runs in parallel and the requests are processed on the
+ * caller one by one.
+ */
+ssize_t page_ftl_submit_requests(struct page_ftl *pgftl,
+				 struct device_request **requests,
+				 size_t nr_requests)
+{
+	struct page_ftl_mq *mq = pgftl->mq;
+	struct page_ftl_mq_batch batch;
+	struct page_ftl_mq_cmd *cmds;
+	ssize_t size = 0;
+	size_t i;
+
+	if (mq == NULL || nr_requests == 1 ||
+	    (mq->nr_queues == 1 && device_is_sync_completion(pgftl->dev))) {
+		for (i = 0; i < nr_requests; i++) {
+			ssize_t ret;
+			if (size < 0) { /**< skip the rest after the failure */
+				device_free_request(requests[i]);
+				continue;
+			}
+			ret = page_ftl_submit_request(pgftl, requests[i]);
+			if (ret <= 0) {
+				device_free_request(requests[i]);
+				size = ret < 0 ? ret : -EIO;
+				continue;
+			}
+			size += ret;
+		}
+		return size;
+	}
+
+	cmds = (struct page_ftl_mq_cmd *)malloc(
+		nr_requests * sizeof(struct page_ftl_mq_cmd));
+	if (cmds == NULL) {
+		pr_err("memory allocation failed\n");
+		for (i = 0; i < nr_requests; i++) {
+			device_free_request(requests[i]);
+		}
+		return -ENOMEM;
+	}
+
+	pthread_mutex_init(&batch.wait.mutex, NULL);
+	pthread_cond_init(&batch.wait.cond, NULL);
+	batch.wait.is_finish = 0;
+	batch.error = 0;
+	batch.size = 0;
+	g_atomic_int_set(&batch.nr_remains, (gint)nr_requests);
+
+	for (i = 0; i < nr_requests; i++) {
+		struct page_ftl_mq_cmd *cmd = &cmds[i];
+		int err;
+
+		cmd->request = requests[i];
+		cmd->ret = 0;
+		cmd->end_cmd = page_ftl_mq_batch_end_cmd;
+		cmd->cmd_private = (void *)&batch;
+		err = page_ftl_mq_submit(pgftl, cmd);
+		if (err) {
+			cmd->ret = err;
+			page_ftl_mq_batch_end_cmd(cmd);
+		}
+	}
+
+	pthread_mutex_lock(&batch.wait.mutex);
+	while (!batch.wait.is_finish) {
+		pthread_cond_wait(&batch.wait.cond, &batch.wait.mutex);
+	}
+	pthread_mutex_unlock(&batch.wait.mutex);
+
+	pthread_mutex_destroy(&batch.wait.mutex);
+	pthread_cond_destroy(&batch.wait.cond);
+	free(cmds);
+	return batch.error ? (ssize_t)batch.error : batch.size;
+}
+
+/**
+ * @brief account the asynchronous I/O before its submission
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param io pointer of the I/O descriptor
+ */
+void page_ftl_mq_start_io(struct page_ftl *pgftl, struct flash_io *io)
+{
+	struct page_ftl_mq *mq = pgftl->mq;
+
+	io->next = NULL;
+	if (io->end_io) {
+		return;
+	}
+	pthread_mutex_lock(&mq->cq_mutex);
+	mq->nr_cq_inflight++;
+	pthread_mutex_unlock(&mq->cq_mutex);
+}
+
+/**
+ * @brief deliver the completed I/O to the submitter
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param io pointer of the completed I/O descriptor (`ret` is set)
+ */
+void page_ftl_mq_end_io(struct page_ftl *pgftl, struct flash_io *io)
+{
+	struct page_ftl_mq *mq = pgftl->mq;
+
+	if (io->end_io) {
+		io->end_io(io);
+		return;
+	}
+	pthread_mutex_lock(&mq->cq_mutex);
+	if (mq->cq_tail) {
+		mq->cq_tail->next = io;
+	} else {
+		mq->cq_head = io;
+	}
+	mq->cq_tail = io;
+	mq->nr_cq_ready++;
+	mq->nr_cq_inflight--;
+	pthread_cond_broadcast(&mq->cq_cond);
+	pthread_mutex_unlock(&mq->cq_mutex);
+}
+
+/**
+ * @brief reap the completed I/Os from the completion queue
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param ios array which receives the completed I/Os
+ * @param min_nr minimum number of I/Os to wait for
+ * @param max_nr size of the `ios` array
+ *
+ * @return number of the reaped I/Os, negative number for fail
+ *
+ * @note
+ * This returns less than `min_nr` when no more I/O is in flight.
+ */
+int page_ftl_mq_poll(struct page_ftl *pgftl, struct flash_io **ios,
+		     size_t min_nr, size_t max_nr)
+{
+	struct page_ftl_mq *mq = pgftl->mq;
+	size_t nr_reaped = 0;
+
+	if (mq == NULL || ios == NULL || min_nr > max_nr) {
+		pr_err("invalid poll (mq:%p, ios:%p, min: %zu, max: %zu)\n",
+		       mq, ios, min_nr, max_nr);
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&mq->cq_mutex);
+	while (mq->nr_cq_ready < min_nr && mq->nr_cq_inflight > 0) {
+		pthread_cond_wait(&mq->cq_cond, &mq->cq_mutex);
+	}
+	while (nr_reaped < max_nr && mq->cq_head) {
+		struct flash_io *io = mq->cq_head;
+		mq->cq_head = io->next;
+		io->next = NULL;
+		ios[nr_reaped++] = io;
+	}
+	if (mq->cq_head == NULL) {
+		mq->cq_tail = NULL;
+	}
+	mq->nr_cq_ready -= nr_reaped;
+	pthread_mutex_unlock(&mq->cq_mutex);
+	return (int)nr_reaped;
+}
+
+/**
+ * @brief initialize the queues and run the workers
+ *
+ * @param pgftl pointer of the page FTL structure
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * One queue is made for each online CPU. The number of the workers is the
+ * larger one of the number of the queues and the number of the buses, so
+ * every bus can be busy even when only one CPU submits the requests.
+ */
+int page_ftl_mq_init(struct page_ftl *pgftl)
+{
+	struct page_ftl_mq *mq;
+	long nr_cpus;
+	size_t i;
+	int ret = 0;
+
+	mq = (struct page_ftl_mq *)malloc(sizeof(struct page_ftl_mq));
+	if (mq == NULL) {
+		pr_err("memory allocation failed\n");
+		return -ENOMEM;
+	}
+	memset(mq, 0, sizeof(struct page_ftl_mq));
+	pthread_mutex_init(&mq->mutex, NULL);
+	pthread_cond_init(&mq->cond, NULL);
+	pthread_mutex_init(&mq->cq_mutex, NULL);
+	pthread_cond_init(&mq->cq_cond, NULL);
+	pgftl->mq = mq;
+
+	nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	mq->nr_queues = nr_cpus > 0 ? (size_t)nr_cpus : 1;
+	mq->nr_workers = pgftl->dev->info.nr_bus;
+	if (mq->nr_workers < mq->nr_queues) {
+		mq->nr_workers = mq->nr_queues;
+	}
+
+	mq->queues = (struct page_ftl_mq_queue *)malloc(
+		mq->nr_queues * sizeof(struct page_ftl_mq_queue));
+	mq->workers = (pthread_t *)malloc(mq->nr_workers * sizeof(pthread_t));
+	if (mq->queues == NULL || mq->workers == NULL) {
+		pr_err("memory allocation failed\n");
+		free(mq->queues);
+		mq->queues = NULL;
+		mq->nr_workers = 0;
+		ret = -ENOMEM;
+		goto exception;
+	}
+	for (i = 0; i < mq->nr_queues; i++) {
+		struct page_ftl_mq_queue *queue = &mq->queues[i];
+		pthread_mutex_init(&queue->mutex, NULL);
+		pthread_cond_init(&queue->cond, NULL);
+		queue->head = 0;
+		queue->nr_cmds = 0;
+	}
+
+	for (i = 0; i < mq->nr_workers; i++) {
+		struct page_ftl_mq_worker_arg *arg;
+		arg = (struct page_ftl_mq_worker_arg *)malloc(
+			sizeof(struct page_ftl_mq_worker_arg));
+		if (arg == NULL) {
+			pr_err("memory allocation failed\n");
+			ret = -ENOMEM;
+			break;
+		}
+		arg->pgftl = pgftl;
+		arg->id = i;
+		ret = pthread_create(&mq->workers[i], NULL, page_ftl_mq_worker,
+				     (void *)arg);
+		if (ret) {
+			pr_err("worker thread creation failed\n");
+			free(arg);
+			ret = -ret;
+			break;
+		}
+	}
+	mq->nr_workers = i;
+	if (ret) {
+		goto exception;
+	}
+	pr_info("multi-queue initialized (queues: %zu, workers: %zu)\n",
+		mq->nr_queues, mq->nr_workers);
+	return 0;
+
+exception:
+	page_ftl_mq_exit(pgftl);
+	return ret;
+}
+
+/**
+ * @brief stop the workers and deallocate the queues
+ *
+ * @param pgftl pointer of the page FTL structure
+ *
+ * @note
+ * The commands already in the queues are processed before the workers exit.
+ * So every submitted I/O is completed when this returns.
+ */
+void page_ftl_mq_exit(struct page_ftl *pgftl)
+{
+	struct page_ftl_mq *mq = pgftl->mq;
+	size_t i;
+
+	if (mq == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&mq->mutex);
+	mq->is_exit = 1;
+	pthread_cond_broadcast(&mq->cond);
+	pthread_mutex_unlock(&mq->mutex);
+	for (i = 0; i < mq->nr_workers; i++) {
+		pthread_join(mq->workers[i], NULL);
+	}
+	pr_debug("multi-queue exit (steals: %d)\n",
+		 g_atomic_int_get(&mq->nr_steals));
+
+	if (mq->queues) {
+		for (i = 0; i < mq->nr_queues; i++) {
+			pthread_mutex_destroy(&mq->queues[i].mutex);
+			pthread_cond_destroy(&mq->queues[i].cond);
+		}
+		free(mq->queues);
+	}
+	free(mq->workers);
+	pthread_mutex_destroy(&mq->mutex);
+	pthread_cond_destroy(&mq->cond);
+	if (mq->nr_cq_ready) {
+		pr_warn("%zu completed I/Os are not reaped\n", mq->nr_cq_ready);
+	}
+	pthread_mutex_destroy(&mq->cq_mutex);
+	pthread_cond_destroy(&mq->cq_cond);
+	free(mq);
+	pgftl->mq = NULL;
+}
@@ -13,6 +13,54 @@
 #include <stdlib.h>
 #include <string.h>
 
+/**
+ * @brief mark the read request finished and wake up its waiter
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param request the request which is waited by `page_ftl_wait_request()`
+ *
+ * @note
+ * A synchronous device calls this before its read returns. So, nobody can
+ * be sleeping on the request and the handshake is skipped.
+ */
+static inline void page_ftl_complete_request(struct page_ftl *pgftl,
+					     struct device_request *request)
+{
+	if (device_is_sync_completion(pgftl->dev)) {
+		g_atomic_int_set(&request->is_finish, 1);
+		return;
+	}
+	pthread_mutex_lock(&request->mutex);
+	g_atomic_int_set(&request->is_finish, 1);
+	pthread_cond_signal(&request->cond);
+	pthread_mutex_unlock(&request->mutex);
+}
+
+/**
+ * @brief wait until the read request is finished
+ *
+ * @param request the request which is submitted to the device
+ *
+ * @note
+ * The flag is polled a few times before sleeping on the condition variable.
+ * A request of the synchronous device is already finished here.
+ */
+static inline void page_ftl_wait_request(struct device_request *request)
+{
+	int spin;
+
+	for (spin = 0; spin < PAGE_FTL_WAIT_SPIN_COUNT; spin++) {
+		if (g_atomic_int_get(&request->is_finish)) {
+			return;
+		}
+	}
+	pthread_mutex_lock(&request->mutex);
+	while (g_atomic_int_get(&request->is_finish) == 0) {
+		pthread_cond_wait(&request->cond, &request->mutex);
+	}
+	pthread_mutex_unlock(&request->mutex);
+}
+
 /**
  * @brief read's end request function
  *
@@ -28,17 +76,17 @@ static void page_ftl_read_end_rq(struct device_request *read_rq)
 	pgftl = (struct page_ftl *)request->rq_private;
 	offset = page_ftl_get_page_offset(pgftl, request->sector);
 
-	memcpy(request->data, &((char *)read_rq->data)[offset],
-	       request->data_len);
-	free(read_rq->data);
+	if (read_rq->data != request->data) { /**< bounced sub-page read */
+		memcpy(request->data, &((char *)read_rq->data)[offset],
+		       request->data_len);
+		/** with the cache, the reader keeps the page to fill it */
+		if (pgftl->cache == NULL) {
+			device_free_buffer(pgftl->dev, read_rq->data);
+		}
+	}
 	device_free_request(read_rq);
 
-	pthread_mutex_lock(&request->mutex);
-	if (g_atomic_int_get(&request->is_finish) == 0) {
-		pthread_cond_signal(&request->cond);
-	}
-	g_atomic_int_set(&request->is_finish, 1);
-	pthread_mutex_unlock(&request->mutex);
+	page_ftl_complete_request(pgftl, request);
 }
 
 /**
@@ -46,18 +94,29 @@ static void page_ftl_read_end_rq(struct device_request *read_rq)
  *
  * @param pgftl pointer of the page FTL structure
  * @param request user's request pointer
+ * @param is_fill insert the page to the read cache on the miss
  *
  * @return reading data size. a negative number means fail to read.
  * @note
  * if paddr.lpn doesn't exist, this function returns the buffer filled 0 value.
+ *
+ * The mapping is looked up without any lock. The segment's erase epoch is
+ * checked before and after the device read, and the read is retried when
+ * the gc erased the segment in the meantime.
+ *
+ * A full-page read is done by the device directly into `request->data`.
+ * Only a sub-page read goes through the bounce buffer.
  */
-ssize_t page_ftl_read(struct page_ftl *pgftl, struct device_request *request)
+static ssize_t __page_ftl_read(struct page_ftl *pgftl,
+			       struct device_request *request, int is_fill)
 {
 	struct device *dev;
 	struct device_request *read_rq;
 	struct device_address paddr;
+	struct page_ftl_segment *segment;
 
 	char *buffer;
+	gint epoch;
 
 	size_t page_size;
 	size_t lpn, offset;
@@ -67,15 +126,24 @@ ssize_t page_ftl_read(struct page_ftl *pgftl, struct device_request *request)
 
 	buffer = NULL;
 	read_rq = NULL;
+	segment = NULL;
+	epoch = 0;
 
 	dev = pgftl->dev;
 	page_size = device_get_page_size(dev);
 	lpn = page_ftl_get_lpn(pgftl, request->sector);
 	offset = page_ftl_get_page_offset(pgftl, request->sector);
 
-	pthread_mutex_lock(&pgftl->mutex);
-	paddr.lpn = pgftl->trans_map[lpn];
-	pthread_mutex_unlock(&pgftl->mutex);
+retry:
+	paddr.lpn = page_ftl_map_load(pgftl, lpn);
+	if (paddr.lpn != PADDR_EMPTY) {
+		segment = &pgftl->segments[paddr.format.block];
+		epoch = g_atomic_int_get(&segment->erase_epoch);
+		/** the mapping must still point this segment's incarnation */
+		if ((epoch & 1) || page_ftl_map_load(pgftl, lpn) != paddr.lpn) {
+			goto retry;
+		}
+	}
 
 	if (paddr.lpn == PADDR_EMPTY) { /**< YOU MUST TAKE CARE OF THIS LINE */
 		pr_warn("cannot find the mapping information (lpn: %zu)\n",
@@ -95,13 +163,24 @@ ssize_t page_ftl_read(struct page_ftl *pgftl, struct device_request *request)
 		goto exception;
 	}
 
-	buffer = (char *)malloc(page_size);
-	if (buffer == NULL) {
-		pr_err("memory allocation failed\n");
-		ret = -ENOMEM;
-		goto exception;
+	if (page_ftl_cache_copy(pgftl, lpn, paddr.lpn, epoch, request->data,
+				offset, request->data_len)) {
+		ret = (ssize_t)request->data_len;
+		device_free_request(request);
+		return ret;
+	}
+
+	if (offset == 0 && request->data_len == page_size) {
+		buffer = (char *)request->data;
+	} else {
+		buffer = (char *)device_alloc_buffer(dev,
+						     DEVICE_BUFFER_DEFAULT);
+		if (buffer == NULL) {
+			pr_err("memory allocation failed\n");
+			ret = -ENOMEM;
+			goto exception;
+		}
 	}
-	memset(buffer, 0, page_size);
 
 	read_rq = device_alloc_request(DEVICE_DEFAULT_REQUEST);
 	if (read_rq == NULL) {
@@ -122,26 +201,128 @@ ssize_t page_ftl_read(struct page_ftl *pgftl, struct device_request *request)
 	if (ret < 0) {
 		pr_err("device read failed (ppn: %u)\n", request->paddr.lpn);
 		read_rq = NULL;
-		buffer = NULL;
+		if (pgftl->cache == NULL) {
+			buffer = NULL;
+		}
 		goto exception;
 	}
 
-	pthread_mutex_lock(&request->mutex);
-	while (g_atomic_int_get(&request->is_finish) == 0) {
-		pthread_cond_wait(&request->cond, &request->mutex);
+	page_ftl_wait_request(request);
+
+	if (g_atomic_int_get(&segment->erase_epoch) != epoch) {
+		pr_debug("segment erased while reading (lpn: %zu, ppn: %u)\n",
+			 lpn, paddr.lpn);
+		g_atomic_int_set(&request->is_finish, 0);
+		if (pgftl->cache && buffer != request->data) {
+			device_free_buffer(dev, buffer);
+		}
+		buffer = NULL;
+		read_rq = NULL;
+		goto retry;
 	}
-	pthread_mutex_unlock(&request->mutex);
 
+	if (pgftl->cache) {
+		if (is_fill) {
+			page_ftl_cache_fill(pgftl, lpn, paddr.lpn, epoch, buffer);
+		}
+		if (buffer != request->data) {
+			device_free_buffer(dev, buffer);
+		}
+	}
 	device_free_request(request);
 
 	ret = data_len;
 	return ret;
 exception:
-	if (buffer) {
-		free(buffer);
+	if (buffer && buffer != request->data) {
+		device_free_buffer(dev, buffer);
 	}
 	if (read_rq) {
 		device_free_request(read_rq);
 	}
 	return ret;
 }
+
+/**
+ * @brief read the request and keep the page in the read cache
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param request user's request pointer
+ *
+ * @return reading data size. a negative number means fail to read.
+ */
+ssize_t page_ftl_read(struct page_ftl *pgftl, struct device_request *request)
+{
+	return __page_ftl_read(pgftl, request, 1);
+}
+
+/**
+ * @brief read the request without inserting the page to the read cache
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param request user's request pointer
+ *
+ * @return reading data size. a negative number means fail to read.
+ *
+ * @note
+ * The gc uses this; the pages which it relocates are mostly cold.
+ */
+ssize_t page_ftl_read_no_fill(struct page_ftl *pgftl,
+			      struct device_request *request)
+{
+	return __page_ftl_read(pgftl, request, 0);
+}
+
+/**
+ * @brief end request function for the physical page read
+ *
+ * @param request the request which is submitted before
+ */
+static void page_ftl_read_ppn_end_rq(struct device_request *request)
+{
+	page_ftl_complete_request((struct page_ftl *)request->rq_private,
+				  request);
+}
+
+/**
+ * @brief read a physical page from the device synchronously
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param ppn physical page number to read
+ * @param buffer page-sized buffer which receives the data
+ *
+ * @return reading data size. a negative number means fail to read.
+ *
+ * @note
+ * This bypasses the mapping table. So, this is used for reading the
+ * metadata pages (e.g., summary and journal).
+ */
+ssize_t page_ftl_read_ppn(struct page_ftl *pgftl, uint32_t ppn, void *buffer)
+{
+	struct device *dev = pgftl->dev;
+	struct device_request *request;
+	ssize_t ret;
+
+	request = device_alloc_request(DEVICE_DEFAULT_REQUEST);
+	if (request == NULL) {
+		pr_err("request allocation failed\n");
+		return -ENOMEM;
+	}
+	request->flag = DEVICE_READ;
+	request->data = buffer;
+	request->data_len = device_get_page_size(dev);
+	request->paddr.lpn = ppn;
+	request->end_rq = page_ftl_read_ppn_end_rq;
+	request->rq_private = (void *)pgftl;
+
+	ret = dev->d_op->read(dev, request);
+	if (ret < 0) {
+		pr_err("device read failed (ppn: %u)\n", ppn);
+		device_free_request(request);
+		return ret;
+	}
+
+	page_ftl_wait_request(request);
+	device_free_request(request);
+	return ret;
+}
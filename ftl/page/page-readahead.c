@@ -0,0 +1,426 @@
+/**
+ * @file page-readahead.c
+ * @brief sequential read-ahead for page ftl
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <glib.h>
+
+#include "page.h"
+#include "log.h"
+#include "device.h"
+
+/**
+ * @brief prefetch command of a read-ahead slot
+ */
+struct page_ftl_ra_cmd {
+	struct page_ftl_mq_cmd cmd;
+	struct page_ftl *pgftl;
+	size_t lpn;
+	uint32_t ppn; /**< mapping when the prefetch is issued */
+	gint epoch;
+	uint64_t ticket;
+	void *buffer;
+};
+
+/**
+ * @brief check the prefetched page still contains the LPN's data
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param lpn logical page number of the page
+ * @param ppn physical page number which the page is read from
+ * @param epoch erase epoch of the ppn's segment when it is read
+ *
+ * @return 1 for valid, 0 for stale
+ *
+ * @note
+ * A physical page is never rewritten before its segment is erased. So the
+ * page is valid while the mapping and the erase epoch are not changed.
+ */
+static int page_ftl_ra_is_valid(struct page_ftl *pgftl, size_t lpn,
+				uint32_t ppn, gint epoch)
+{
+	struct device_address paddr;
+	struct page_ftl_segment *segment;
+
+	if (page_ftl_map_load(pgftl, lpn) != ppn) {
+		return 0;
+	}
+	paddr.lpn = ppn;
+	segment = &pgftl->segments[paddr.format.block];
+	return g_atomic_int_get(&segment->erase_epoch) == epoch;
+}
+
+/**
+ * @brief empty the slot if it still waits for the prefetch
+ *
+ * @param ra pointer of the read-ahead information
+ * @param lpn logical page number of the prefetch
+ * @param ticket ticket of the prefetch
+ */
+static void page_ftl_ra_cancel(struct page_ftl_ra *ra, size_t lpn,
+			       uint64_t ticket)
+{
+	struct page_ftl_ra_slot *slot;
+
+	pthread_mutex_lock(&ra->mutex);
+	slot = &ra->slots[lpn % PAGE_FTL_RA_NR_SLOTS];
+	if (slot->state == PAGE_FTL_RA_INFLIGHT && slot->ticket == ticket) {
+		slot->state = PAGE_FTL_RA_EMPTY;
+		pthread_cond_broadcast(&ra->cond);
+	}
+	pthread_mutex_unlock(&ra->mutex);
+}
+
+/**
+ * @brief end command function of the prefetch
+ *
+ * @param cmd pointer of the completed command
+ */
+static void page_ftl_ra_end_cmd(struct page_ftl_mq_cmd *cmd)
+{
+	struct page_ftl_ra_cmd *ra_cmd = (struct page_ftl_ra_cmd *)cmd;
+	struct page_ftl *pgftl = ra_cmd->pgftl;
+	struct page_ftl_ra *ra = pgftl->ra;
+	struct page_ftl_ra_slot *slot;
+	int is_valid = 0;
+
+	if (cmd->ret <= 0) {
+		device_free_request(cmd->request);
+	} else {
+		/** the read may see a newer mapping; drop the page then */
+		is_valid = page_ftl_ra_is_valid(pgftl, ra_cmd->lpn, ra_cmd->ppn,
+						ra_cmd->epoch);
+	}
+
+	pthread_mutex_lock(&ra->mutex);
+	slot = &ra->slots[ra_cmd->lpn % PAGE_FTL_RA_NR_SLOTS];
+	if (slot->state == PAGE_FTL_RA_INFLIGHT &&
+	    slot->ticket == ra_cmd->ticket) {
+		if (is_valid) {
+			slot->ppn = ra_cmd->ppn;
+			slot->epoch = ra_cmd->epoch;
+			slot->buffer = ra_cmd->buffer;
+			slot->state = PAGE_FTL_RA_READY;
+			ra_cmd->buffer = NULL;
+		} else {
+			slot->state = PAGE_FTL_RA_EMPTY;
+		}
+		pthread_cond_broadcast(&ra->cond);
+	}
+	pthread_mutex_unlock(&ra->mutex);
+
+	if (ra_cmd->buffer) {
+		device_free_buffer(pgftl->dev, ra_cmd->buffer);
+	}
+	free(ra_cmd);
+}
+
+/**
+ * @brief submit the prefetch of the LPN to the workers
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param lpn logical page number to prefetch
+ * @param ticket ticket of the slot which waits for this prefetch
+ *
+ * @return 0 for success, negative number for fail
+ */
+static int page_ftl_ra_issue(struct page_ftl *pgftl, size_t lpn,
+			     uint64_t ticket)
+{
+	struct page_ftl_ra_cmd *ra_cmd = NULL;
+	struct device_request *request = NULL;
+	struct page_ftl_segment *segment;
+	struct device_address paddr;
+	size_t page_size = device_get_page_size(pgftl->dev);
+	int ret;
+
+	paddr.lpn = page_ftl_map_load(pgftl, lpn);
+	if (paddr.lpn == PADDR_EMPTY) {
+		return -ENODATA;
+	}
+	segment = &pgftl->segments[paddr.format.block];
+
+	ra_cmd = (struct page_ftl_ra_cmd *)malloc(
+		sizeof(struct page_ftl_ra_cmd));
+	if (ra_cmd == NULL) {
+		pr_err("memory allocation failed\n");
+		return -ENOMEM;
+	}
+	memset(ra_cmd, 0, sizeof(struct page_ftl_ra_cmd));
+	ra_cmd->pgftl = pgftl;
+	ra_cmd->lpn = lpn;
+	ra_cmd->ppn = paddr.lpn;
+	ra_cmd->epoch = g_atomic_int_get(&segment->erase_epoch);
+	ra_cmd->ticket = ticket;
+	if (ra_cmd->epoch & 1) { /**< being erased */
+		ret = -EAGAIN;
+		goto exception;
+	}
+
+	ra_cmd->buffer = device_alloc_buffer(pgftl->dev, DEVICE_BUFFER_DEFAULT);
+	request = device_alloc_request(DEVICE_DEFAULT_REQUEST);
+	if (ra_cmd->buffer == NULL || request == NULL) {
+		pr_err("prefetch allocation failed\n");
+		ret = -ENOMEM;
+		goto exception;
+	}
+	request->flag = DEVICE_READ;
+	request->data = ra_cmd->buffer;
+	request->data_len = page_size;
+	request->sector = lpn * page_size;
+
+	ra_cmd->cmd.request = request;
+	ra_cmd->cmd.end_cmd = page_ftl_ra_end_cmd;
+	ra_cmd->cmd.cmd_private = (void *)ra_cmd;
+	ret = page_ftl_mq_submit(pgftl, &ra_cmd->cmd);
+	if (ret) {
+		goto exception;
+	}
+	g_atomic_int_inc(&pgftl->ra->nr_issued);
+	return 0;
+
+exception:
+	if (request) {
+		device_free_request(request);
+	}
+	if (ra_cmd->buffer) {
+		device_free_buffer(pgftl->dev, ra_cmd->buffer);
+	}
+	free(ra_cmd);
+	return ret;
+}
+
+/**
+ * @brief copy the read data from the read-ahead cache
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param sector offset of the read (bytes)
+ * @param buffer buffer which receives the data
+ * @param len length of the read; it must not cross the page
+ *
+ * @return 1 for the cache hit, 0 for the miss
+ *
+ * @note
+ * When the page is being prefetched, this waits for the prefetch instead
+ * of reading the page again.
+ */
+int page_ftl_readahead_copy(struct page_ftl *pgftl, size_t sector,
+			    void *buffer, size_t len)
+{
+	struct page_ftl_ra *ra = pgftl->ra;
+	struct page_ftl_ra_slot *slot;
+	size_t lpn = page_ftl_get_lpn(pgftl, sector);
+	int is_hit = 0;
+
+	if (ra == NULL) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&ra->mutex);
+	slot = &ra->slots[lpn % PAGE_FTL_RA_NR_SLOTS];
+	if (slot->state == PAGE_FTL_RA_INFLIGHT && slot->lpn == lpn) {
+		uint64_t ticket = slot->ticket;
+		while (slot->state == PAGE_FTL_RA_INFLIGHT &&
+		       slot->ticket == ticket) {
+			pthread_cond_wait(&ra->cond, &ra->mutex);
+		}
+	}
+	if (slot->state == PAGE_FTL_RA_READY && slot->lpn == lpn) {
+		if (page_ftl_ra_is_valid(pgftl, lpn, slot->ppn, slot->epoch)) {
+			size_t offset = page_ftl_get_page_offset(pgftl, sector);
+			memcpy(buffer, &((char *)slot->buffer)[offset], len);
+			is_hit = 1;
+		} else {
+			device_free_buffer(pgftl->dev, slot->buffer);
+			slot->buffer = NULL;
+			slot->state = PAGE_FTL_RA_EMPTY;
+		}
+	}
+	pthread_mutex_unlock(&ra->mutex);
+
+	if (is_hit) {
+		g_atomic_int_inc(&ra->nr_hits);
+	}
+	return is_hit;
+}
+
+/**
+ * @brief update the stream of the read and prefetch its next pages
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param sector offset of the finished read (bytes)
+ * @param count length of the finished read (bytes)
+ *
+ * @note
+ * A read which starts where a stream's last read ended continues the
+ * stream and doubles its window (at least the pages of the read). Any
+ * other read takes over the least recently used stream with the collapsed
+ * window, so random reads never prefetch. The prefetch stops at a slot
+ * which is busy for another LPN and the rest is tried by the next read.
+ */
+void page_ftl_readahead(struct page_ftl *pgftl, size_t sector, size_t count)
+{
+	struct page_ftl_ra *ra = pgftl->ra;
+	struct page_ftl_ra_stream *stream = NULL;
+	size_t lpns[PAGE_FTL_RA_MAX_WINDOW];
+	uint64_t tickets[PAGE_FTL_RA_MAX_WINDOW];
+	size_t nr_lpns = 0;
+	size_t first_lpn, last_lpn, lpn, end, nr_total;
+	size_t i;
+
+	if (ra == NULL || pgftl->mq == NULL || count == 0) {
+		return;
+	}
+	nr_total = page_ftl_get_map_size(pgftl) / sizeof(uint32_t);
+	first_lpn = page_ftl_get_lpn(pgftl, sector);
+	last_lpn = page_ftl_get_lpn(pgftl, sector + count - 1);
+
+	pthread_mutex_lock(&ra->mutex);
+	for (i = 0; i < PAGE_FTL_RA_NR_STREAMS; i++) {
+		if (ra->streams[i].next_sector == sector &&
+		    ra->streams[i].last_used) {
+			stream = &ra->streams[i];
+			break;
+		}
+	}
+	if (stream) {
+		stream->window = stream->window ? stream->window * 2 :
+						  PAGE_FTL_RA_MIN_WINDOW;
+		if (stream->window < last_lpn - first_lpn + 1) {
+			stream->window = last_lpn - first_lpn + 1;
+		}
+		if (stream->window > PAGE_FTL_RA_MAX_WINDOW) {
+			stream->window = PAGE_FTL_RA_MAX_WINDOW;
+		}
+	} else {
+		stream = &ra->streams[0];
+		for (i = 1; i < PAGE_FTL_RA_NR_STREAMS; i++) {
+			if (ra->streams[i].last_used < stream->last_used) {
+				stream = &ra->streams[i];
+			}
+		}
+		stream->window = 0;
+		stream->ra_lpn = 0;
+	}
+	stream->next_sector = sector + count;
+	stream->last_used = ++ra->clock;
+
+	lpn = last_lpn + 1;
+	if (lpn < stream->ra_lpn) {
+		lpn = stream->ra_lpn;
+	}
+	end = last_lpn + stream->window;
+	if (end >= nr_total) {
+		end = nr_total - 1;
+	}
+	for (; stream->window && lpn <= end; lpn++) {
+		struct page_ftl_ra_slot *slot;
+
+		slot = &ra->slots[lpn % PAGE_FTL_RA_NR_SLOTS];
+		if (slot->state != PAGE_FTL_RA_EMPTY && slot->lpn == lpn) {
+			continue;
+		}
+		if (slot->state == PAGE_FTL_RA_INFLIGHT) {
+			break;
+		}
+		if (slot->state == PAGE_FTL_RA_READY) {
+			device_free_buffer(pgftl->dev, slot->buffer);
+			slot->buffer = NULL;
+		}
+		slot->lpn = lpn;
+		slot->state = PAGE_FTL_RA_INFLIGHT;
+		slot->ticket = ++ra->ticket;
+		lpns[nr_lpns] = lpn;
+		tickets[nr_lpns] = slot->ticket;
+		nr_lpns++;
+	}
+	if (stream->window && lpn > stream->ra_lpn) {
+		stream->ra_lpn = lpn;
+	}
+	pthread_mutex_unlock(&ra->mutex);
+
+	for (i = 0; i < nr_lpns; i++) {
+		if (page_ftl_ra_issue(pgftl, lpns[i], tickets[i])) {
+			page_ftl_ra_cancel(ra, lpns[i], tickets[i]);
+		}
+	}
+}
+
+/**
+ * @brief initialize the read-ahead
+ *
+ * @param pgftl pointer of the page FTL structure
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * The read-ahead is disabled for the low latency device (e.g., ramdisk);
+ * the prefetch costs more than the read itself.
+ */
+int page_ftl_readahead_init(struct page_ftl *pgftl)
+{
+	struct page_ftl_ra *ra;
+
+	pgftl->ra = NULL;
+	if (device_is_low_latency(pgftl->dev)) {
+		pr_info("read-ahead is disabled for the low latency device\n");
+		return 0;
+	}
+
+	ra = (struct page_ftl_ra *)malloc(sizeof(struct page_ftl_ra));
+	if (ra == NULL) {
+		pr_err("memory allocation failed\n");
+		return -ENOMEM;
+	}
+	memset(ra, 0, sizeof(struct page_ftl_ra));
+	ra->slots = (struct page_ftl_ra_slot *)malloc(
+		PAGE_FTL_RA_NR_SLOTS * sizeof(struct page_ftl_ra_slot));
+	if (ra->slots == NULL) {
+		pr_err("memory allocation failed\n");
+		free(ra);
+		return -ENOMEM;
+	}
+	memset(ra->slots, 0,
+	       PAGE_FTL_RA_NR_SLOTS * sizeof(struct page_ftl_ra_slot));
+	pthread_mutex_init(&ra->mutex, NULL);
+	pthread_cond_init(&ra->cond, NULL);
+	pgftl->ra = ra;
+	return 0;
+}
+
+/**
+ * @brief deallocate the read-ahead
+ *
+ * @param pgftl pointer of the page FTL structure
+ *
+ * @note
+ * This must be called after the workers exit; no prefetch is in flight.
+ */
+void page_ftl_readahead_exit(struct page_ftl *pgftl)
+{
+	struct page_ftl_ra *ra = pgftl->ra;
+	size_t i;
+
+	if (ra == NULL) {
+		return;
+	}
+	pr_info("read-ahead exit (issued: %d, hits: %d)\n",
+		g_atomic_int_get(&ra->nr_issued),
+		g_atomic_int_get(&ra->nr_hits));
+	for (i = 0; i < PAGE_FTL_RA_NR_SLOTS; i++) {
+		if (ra->slots[i].state == PAGE_FTL_RA_READY) {
+			device_free_buffer(pgftl->dev, ra->slots[i].buffer);
+		}
+	}
+	pthread_mutex_destroy(&ra->mutex);
+	pthread_cond_destroy(&ra->cond);
+	free(ra->slots);
+	free(ra);
+	pgftl->ra = NULL;
+}
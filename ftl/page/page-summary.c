@@ -0,0 +1,555 @@
+/**
+ * @file page-summary.c
+ * @brief segment summary block for page ftl
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <glib.h>
+
+#include "page.h"
+#include "log.h"
+#include "bits.h"
+#include "device.h"
+
+/**
+ * @brief replay slot used for sorting the summaries and journal pages
+ */
+struct page_ftl_summary_slot {
+	uint64_t seqnum;
+	size_t segnum; /**< summary's or journal page's segment */
+	size_t page; /**< page index in the journal segment */
+	struct page_ftl_journal_page *jpage; /**< NULL for the summary */
+};
+
+/**
+ * @brief shared data of the summary loading threads
+ */
+struct page_ftl_summary_context {
+	struct page_ftl *pgftl;
+	uint64_t *seqnums; /**< 0 means the segment has no valid summary */
+	gint next_segnum;
+	gint error; /**< first read or allocation error of the threads */
+};
+
+/**
+ * @brief get the number of LPNs in a summary page
+ *
+ * @param pgftl pointer of the page FTL structure
+ *
+ * @return the number of entries per summary page
+ */
+static size_t page_ftl_summary_get_entries_per_page(struct page_ftl *pgftl)
+{
+	return (device_get_page_size(pgftl->dev) -
+		sizeof(struct page_ftl_summary_header)) /
+	       sizeof(uint32_t);
+}
+
+/**
+ * @brief summary write's end request function
+ *
+ * @param request the request which is submitted before
+ */
+static void page_ftl_summary_write_end_rq(struct device_request *request)
+{
+	struct page_ftl *pgftl = (struct page_ftl *)request->rq_private;
+	device_free_buffer(pgftl->dev, request->data);
+	device_free_request(request);
+}
+
+/**
+ * @brief mark the segment as closed and make it the gc target if needed
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param segnum target segment number
+ *
+ * @note
+ * The caller must hold the `pgftl->mutex`.
+ */
+static void page_ftl_summary_close_segment(struct page_ftl *pgftl,
+					   size_t segnum)
+{
+	struct page_ftl_segment *segment = &pgftl->segments[segnum];
+	gint nr_data_pages = (gint)page_ftl_get_data_pages(pgftl);
+
+	g_atomic_int_set(&segment->is_closed, 1);
+	if (g_atomic_int_get(&pgftl->nr_valid[segnum]) < nr_data_pages) {
+		test_and_set_bit_atomic(pgftl->gc_seg_bits, segnum);
+	}
+}
+
+/**
+ * @brief write the summary block to the end of the full segment
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param segnum segment number which has no free data page
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * Even if this function fails, the segment is closed to be collected by the gc.
+ */
+int page_ftl_summary_write(struct page_ftl *pgftl, size_t segnum)
+{
+	struct device *dev;
+	struct device_address paddr;
+
+	uint32_t *p2l;
+	uint64_t seqnum;
+
+	size_t page_size, entries_per_page;
+	size_t nr_data_pages, nr_summary_pages;
+	size_t idx;
+
+	int ret = 0;
+
+	dev = pgftl->dev;
+	page_size = device_get_page_size(dev);
+	entries_per_page = page_ftl_summary_get_entries_per_page(pgftl);
+	nr_data_pages = page_ftl_get_data_pages(pgftl);
+	nr_summary_pages = page_ftl_get_summary_pages(pgftl);
+
+	paddr.lpn = 0;
+	paddr.format.block = (uint16_t)segnum;
+
+	p2l = (uint32_t *)malloc(nr_data_pages * sizeof(uint32_t));
+	if (p2l == NULL) {
+		pr_err("memory allocation failed\n");
+		ret = -ENOMEM;
+		goto exit;
+	}
+
+	pthread_mutex_lock(&pgftl->segments[segnum].mutex);
+	memcpy(p2l, &pgftl->p2l_map[paddr.lpn],
+	       nr_data_pages * sizeof(uint32_t));
+	seqnum = page_ftl_get_next_seqnum(pgftl);
+	pthread_mutex_unlock(&pgftl->segments[segnum].mutex);
+
+	for (idx = 0; idx < nr_summary_pages; idx++) {
+		struct page_ftl_summary_header *header;
+		struct device_request *request;
+		char *buffer;
+		size_t start, nr_entries;
+		ssize_t write_size;
+
+		start = idx * entries_per_page;
+		nr_entries = nr_data_pages - start < entries_per_page ?
+				     nr_data_pages - start :
+				     entries_per_page;
+
+		buffer = (char *)device_alloc_buffer(dev, DEVICE_BUFFER_ZERO);
+		if (buffer == NULL) {
+			pr_err("memory allocation failed\n");
+			ret = -ENOMEM;
+			goto exit;
+		}
+		header = (struct page_ftl_summary_header *)buffer;
+		header->magic = PAGE_FTL_SUMMARY_MAGIC;
+		header->segnum = (uint32_t)segnum;
+		header->seqnum = seqnum;
+		header->index = (uint32_t)idx;
+		header->nr_entries = (uint32_t)nr_entries;
+		memcpy(&buffer[sizeof(*header)], &p2l[start],
+		       nr_entries * sizeof(uint32_t));
+
+		request = device_alloc_request(DEVICE_DEFAULT_REQUEST);
+		if (request == NULL) {
+			pr_err("request allocation failed\n");
+			device_free_buffer(dev, buffer);
+			ret = -ENOMEM;
+			goto exit;
+		}
+		request->flag = DEVICE_WRITE;
+		request->data = buffer;
+		request->rq_private = (void *)pgftl;
+		request->data_len = page_size;
+		request->paddr.lpn = paddr.lpn + (uint32_t)(nr_data_pages + idx);
+		request->end_rq = page_ftl_summary_write_end_rq;
+
+		write_size = dev->d_op->write(dev, request);
+		if (write_size != (ssize_t)page_size) {
+			pr_err("summary write failed (segnum: %zu, index: %zu)\n",
+			       segnum, idx);
+			ret = write_size < 0 ? (int)write_size : -EIO;
+			goto exit;
+		}
+	}
+	g_atomic_int_set(&pgftl->segments[segnum].has_summary, 1);
+	pr_debug("summary written (segnum: %zu, seqnum: %" PRIu64 ")\n", segnum,
+		 seqnum);
+exit:
+	if (p2l) {
+		free(p2l);
+	}
+	pthread_mutex_lock(&pgftl->mutex);
+	page_ftl_summary_close_segment(pgftl, segnum);
+	pthread_mutex_unlock(&pgftl->mutex);
+	return ret;
+}
+
+/**
+ * @brief load a segment's summary block to the p2l table
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param segnum segment number to load
+ * @param buffer page-sized temporary buffer
+ * @param __seqnum pointer which receives the sequence number of the summary
+ * (0 means there is no valid summary)
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * Only the missing or torn summary makes the segment an open segment. The
+ * read failure is returned because the open segment may be erased.
+ */
+static int page_ftl_summary_load(struct page_ftl *pgftl, size_t segnum,
+				 char *buffer, uint64_t *__seqnum)
+{
+	struct page_ftl_summary_header *header;
+	struct device_address paddr;
+
+	size_t entries_per_page;
+	size_t nr_data_pages, nr_summary_pages;
+	size_t idx;
+
+	uint64_t seqnum = 0;
+	ssize_t ret;
+
+	*__seqnum = 0;
+	entries_per_page = page_ftl_summary_get_entries_per_page(pgftl);
+	nr_data_pages = page_ftl_get_data_pages(pgftl);
+	nr_summary_pages = page_ftl_get_summary_pages(pgftl);
+
+	paddr.lpn = 0;
+	paddr.format.block = (uint16_t)segnum;
+
+	header = (struct page_ftl_summary_header *)buffer;
+	for (idx = 0; idx < nr_summary_pages; idx++) {
+		size_t start = idx * entries_per_page;
+		uint32_t ppn = paddr.lpn + (uint32_t)(nr_data_pages + idx);
+
+		ret = page_ftl_read_ppn(pgftl, ppn, buffer);
+		if (ret < 0) {
+			pr_err("summary read failed (segnum: %zu, index: %zu)\n",
+			       segnum, idx);
+			return (int)ret;
+		}
+		if (header->magic != PAGE_FTL_SUMMARY_MAGIC ||
+		    header->segnum != (uint32_t)segnum ||
+		    header->index != (uint32_t)idx ||
+		    header->nr_entries > entries_per_page ||
+		    start + header->nr_entries > nr_data_pages) {
+			return 0;
+		}
+		if (idx == 0) {
+			seqnum = header->seqnum;
+		} else if (header->seqnum != seqnum) {
+			pr_warn("torn summary detected (segnum: %zu)\n",
+				segnum);
+			return 0;
+		}
+		memcpy(&pgftl->p2l_map[paddr.lpn + start],
+		       &buffer[sizeof(*header)],
+		       header->nr_entries * sizeof(uint32_t));
+	}
+	*__seqnum = seqnum;
+	return 0;
+}
+
+/**
+ * @brief summary loading thread
+ *
+ * @param data pointer of the summary context
+ *
+ * @return NULL
+ *
+ * @note
+ * Each thread takes the next segment number so that the summary reads of
+ * the different segments are spread over the buses. The first failure is
+ * kept in the `context->error` and stops every thread.
+ */
+static void *page_ftl_summary_load_thread(void *data)
+{
+	struct page_ftl_summary_context *context;
+	struct page_ftl *pgftl;
+	struct device *dev;
+	size_t nr_segments;
+	char *buffer;
+
+	context = (struct page_ftl_summary_context *)data;
+	pgftl = context->pgftl;
+	dev = pgftl->dev;
+	nr_segments = device_get_nr_segments(dev);
+
+	buffer = (char *)malloc(device_get_page_size(dev));
+	if (buffer == NULL) {
+		pr_err("memory allocation failed\n");
+		g_atomic_int_compare_and_exchange(&context->error, 0, -ENOMEM);
+		return NULL;
+	}
+
+	while (g_atomic_int_get(&context->error) == 0) {
+		size_t segnum;
+		int ret;
+
+		segnum = (size_t)g_atomic_int_add(&context->next_segnum, 1);
+		if (segnum >= nr_segments) {
+			break;
+		}
+		if (page_ftl_journal_is_reserved(segnum) ||
+		    (dev->badseg_bitmap &&
+		     get_bit(dev->badseg_bitmap, segnum))) {
+			continue;
+		}
+		ret = page_ftl_summary_load(pgftl, segnum, buffer,
+					    &context->seqnums[segnum]);
+		if (ret) {
+			g_atomic_int_compare_and_exchange(&context->error, 0,
+							  ret);
+		}
+	}
+	free(buffer);
+	return NULL;
+}
+
+/**
+ * @brief compare function for sorting the summary slots
+ *
+ * @note
+ * The snapshot pages of a journal generation share a sequence number. So,
+ * the tie is broken by the segment and page index to make the replay order
+ * independent of the `qsort()`.
+ */
+static int page_ftl_summary_slot_cmp(const void *a, const void *b)
+{
+	const struct page_ftl_summary_slot *slot[2];
+	slot[0] = (const struct page_ftl_summary_slot *)a;
+	slot[1] = (const struct page_ftl_summary_slot *)b;
+	if (slot[0]->seqnum != slot[1]->seqnum) {
+		return slot[0]->seqnum < slot[1]->seqnum ? -1 : 1;
+	}
+	if (slot[0]->segnum != slot[1]->segnum) {
+		return slot[0]->segnum < slot[1]->segnum ? -1 : 1;
+	}
+	if (slot[0]->page != slot[1]->page) {
+		return slot[0]->page < slot[1]->page ? -1 : 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief rebuild the in-memory metadata from the summary blocks and journal
+ *
+ * @param pgftl pointer of the page FTL structure
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * Summaries and journal pages share the sequence number and are applied in
+ * that order, so the newer one overrides the older mapping of the same LPN.
+ * A segment without a valid summary is an open segment at the crash time.
+ * If the journal refers to its pages, it is sealed and left to the gc.
+ * Otherwise, it is erased and reused.
+ */
+int page_ftl_summary_recovery(struct page_ftl *pgftl)
+{
+	struct page_ftl_summary_context context;
+	struct page_ftl_summary_slot *slots = NULL;
+	struct page_ftl_journal_page *jpages = NULL;
+	struct device *dev;
+	pthread_t *threads = NULL;
+
+	size_t nr_segments, nr_threads, nr_slots, nr_jpages = 0;
+	size_t nr_data_pages, nr_entries, nr_total_pages;
+	size_t segnum, idx, lpn;
+
+	int ret = 0;
+
+	memset(&context, 0, sizeof(struct page_ftl_summary_context));
+	dev = pgftl->dev;
+	nr_segments = device_get_nr_segments(dev);
+	nr_data_pages = page_ftl_get_data_pages(pgftl);
+	nr_entries = page_ftl_get_map_size(pgftl) / sizeof(uint32_t);
+	nr_total_pages = device_get_total_pages(dev);
+	nr_threads = dev->info.nr_bus;
+
+	ret = page_ftl_journal_load(pgftl, &jpages, &nr_jpages);
+	if (ret) {
+		pr_err("journal loading failed\n");
+		goto exit;
+	}
+
+	context.pgftl = pgftl;
+	context.seqnums = (uint64_t *)malloc(nr_segments * sizeof(uint64_t));
+	threads = (pthread_t *)malloc(nr_threads * sizeof(pthread_t));
+	slots = (struct page_ftl_summary_slot *)malloc(
+		(nr_segments + nr_jpages) *
+		sizeof(struct page_ftl_summary_slot));
+	if (context.seqnums == NULL || threads == NULL || slots == NULL) {
+		pr_err("memory allocation failed\n");
+		ret = -ENOMEM;
+		goto exit;
+	}
+	memset(context.seqnums, 0, nr_segments * sizeof(uint64_t));
+
+	for (idx = 0; idx < nr_threads; idx++) {
+		ret = pthread_create(&threads[idx], NULL,
+				     page_ftl_summary_load_thread, &context);
+		if (ret) {
+			pr_err("summary loading thread creation failed\n");
+			nr_threads = idx;
+			ret = -ret;
+			break;
+		}
+	}
+	for (idx = 0; idx < nr_threads; idx++) {
+		pthread_join(threads[idx], NULL);
+	}
+	if (ret) {
+		goto exit;
+	}
+	ret = g_atomic_int_get(&context.error);
+	if (ret) {
+		pr_err("summary loading failed (errno: %d)\n", ret);
+		goto exit;
+	}
+
+	/** replay the summaries and journal pages from the oldest one */
+	nr_slots = 0;
+	for (segnum = 0; segnum < nr_segments; segnum++) {
+		if (context.seqnums[segnum] == 0) {
+			continue;
+		}
+		slots[nr_slots].seqnum = context.seqnums[segnum];
+		slots[nr_slots].segnum = segnum;
+		slots[nr_slots].page = 0;
+		slots[nr_slots].jpage = NULL;
+		nr_slots++;
+	}
+	for (idx = 0; idx < nr_jpages; idx++) {
+		slots[nr_slots].seqnum = jpages[idx].seqnum;
+		slots[nr_slots].segnum = pgftl->journal->segnum;
+		slots[nr_slots].page = idx;
+		slots[nr_slots].jpage = &jpages[idx];
+		nr_slots++;
+	}
+	qsort(slots, nr_slots, sizeof(struct page_ftl_summary_slot),
+	      page_ftl_summary_slot_cmp);
+
+	for (idx = 0; idx < nr_slots; idx++) {
+		struct page_ftl_journal_page *jpage = slots[idx].jpage;
+		struct device_address paddr;
+		size_t page;
+
+		if (slots[idx].seqnum >= pgftl->seqnum) {
+			pgftl->seqnum = slots[idx].seqnum + 1;
+		}
+		if (jpage) {
+			for (page = 0; page < jpage->nr_entries; page++) {
+				struct page_ftl_journal_entry *entry;
+				entry = &jpage->entries[page];
+				paddr.lpn = entry->ppn;
+				if (entry->lpn >= nr_entries ||
+				    entry->ppn >= nr_total_pages ||
+				    page_ftl_journal_is_reserved(
+					    paddr.format.block)) {
+					continue;
+				}
+				pgftl->trans_map[entry->lpn] = entry->ppn;
+			}
+			continue;
+		}
+
+		paddr.lpn = 0;
+		paddr.format.block = (uint16_t)slots[idx].segnum;
+		for (page = 0; page < nr_data_pages; page++) {
+			uint32_t ppn = paddr.lpn + (uint32_t)page;
+			lpn = pgftl->p2l_map[ppn];
+			if (lpn == PADDR_EMPTY || lpn >= nr_entries) {
+				continue;
+			}
+			pgftl->trans_map[lpn] = ppn;
+		}
+	}
+
+	/** rebuild the p2l table and the valid page information */
+	for (idx = 0; idx < nr_total_pages; idx++) {
+		pgftl->p2l_map[idx] = PADDR_EMPTY;
+	}
+	for (lpn = 0; lpn < nr_entries; lpn++) {
+		struct page_ftl_segment *segment;
+		struct device_address paddr;
+
+		paddr.lpn = pgftl->trans_map[lpn];
+		if (paddr.lpn == PADDR_EMPTY) {
+			continue;
+		}
+		pgftl->p2l_map[paddr.lpn] = (uint32_t)lpn;
+		segment = &pgftl->segments[paddr.format.block];
+		segment->lpn_list = g_list_prepend(segment->lpn_list,
+						   GSIZE_TO_POINTER(lpn));
+		g_atomic_int_inc(&pgftl->nr_valid[paddr.format.block]);
+	}
+
+	for (segnum = 0; segnum < nr_segments; segnum++) {
+		struct page_ftl_segment *segment = &pgftl->segments[segnum];
+		struct device_address paddr;
+		uint64_t *use_bits;
+		size_t page;
+
+		if (page_ftl_journal_is_reserved(segnum) ||
+		    (dev->badseg_bitmap &&
+		     get_bit(dev->badseg_bitmap, segnum))) {
+			continue;
+		}
+		if (context.seqnums[segnum] == 0 &&
+		    g_atomic_int_get(&pgftl->nr_valid[segnum]) == 0) {
+			paddr.lpn = 0;
+			paddr.format.block = (uint16_t)segnum;
+			ret = page_ftl_segment_erase(pgftl, paddr);
+			if (ret) {
+				pr_err("erase the open segment failed (segnum: %zu)\n",
+				       segnum);
+				goto exit;
+			}
+			continue;
+		}
+		use_bits = page_ftl_get_use_bits(pgftl, segnum);
+		for (page = 0; page < nr_data_pages; page++) {
+			set_bit(use_bits, page);
+		}
+		g_atomic_int_set(&pgftl->nr_free[segnum], 0);
+		page_ftl_update_free_segment(pgftl, segnum);
+		g_atomic_int_set(&segment->nr_written_pages,
+				 (gint)nr_data_pages);
+		if (context.seqnums[segnum]) {
+			g_atomic_int_set(&segment->has_summary, 1);
+		} else {
+			/** covered by the next journal generation's snapshot */
+			pr_debug("seal the open segment (segnum: %zu)\n",
+				 segnum);
+		}
+		page_ftl_summary_close_segment(pgftl, segnum);
+	}
+	pr_info("recovered from %zu summaries and %zu journal pages "
+		"(next seqnum: %" PRIu64 ")\n",
+		nr_slots - nr_jpages, nr_jpages, pgftl->seqnum);
+exit:
+	page_ftl_journal_free_pages(jpages, nr_jpages);
+	if (context.seqnums) {
+		free(context.seqnums);
+	}
+	if (threads) {
+		free(threads);
+	}
+	if (slots) {
+		free(slots);
+	}
+	return ret;
+}
@@ -25,33 +25,36 @@
  *
  * @param pgftl pointer of the page FTL structure
  * @param lpn logical page address to invalidate
+ * @param paddr previous physical address of the LPN
+ *
+ * @note
+ * The mapping table is already updated by the caller.
  */
-static void page_ftl_invalidate(struct page_ftl *pgftl, size_t lpn)
+static void page_ftl_invalidate(struct page_ftl *pgftl, size_t lpn,
+				struct device_address paddr)
 {
 	struct page_ftl_segment *segment;
-	struct device_address paddr;
 
 	uint32_t segnum;
-	size_t nr_valid_pages, nr_free_pages;
 
 	/**< segment information update */
-	paddr.lpn = pgftl->trans_map[lpn];
 	segnum = paddr.format.block;
 	segment = &pgftl->segments[segnum];
 
+	pthread_mutex_lock(&segment->mutex);
 	segment->lpn_list =
 		g_list_remove(segment->lpn_list, GSIZE_TO_POINTER(lpn));
+	pgftl->p2l_map[paddr.lpn] = PADDR_EMPTY;
+	pthread_mutex_unlock(&segment->mutex);
 
-	nr_valid_pages = g_atomic_int_get(&segment->nr_valid_pages);
-	nr_free_pages = g_atomic_int_get(&segment->nr_free_pages);
-	g_atomic_int_set(&segment->nr_valid_pages,
-			 (unsigned int)(nr_valid_pages - 1));
+	g_atomic_int_add(&pgftl->nr_valid[segnum], -1);
 
-	/**< global information update */
-	pgftl->trans_map[lpn] = PADDR_EMPTY;
-	if (nr_free_pages == 0 && get_bit(pgftl->gc_seg_bits, segnum) != 1) {
-		pgftl->gc_list = g_list_prepend(pgftl->gc_list, segment);
-		set_bit(pgftl->gc_seg_bits, segnum);
+	/**< global information update (only the first one takes the lock) */
+	if (g_atomic_int_get(&segment->is_closed) &&
+	    !get_bit_atomic(pgftl->gc_seg_bits, segnum)) {
+		pthread_mutex_lock(&pgftl->mutex);
+		test_and_set_bit_atomic(pgftl->gc_seg_bits, segnum);
+		pthread_mutex_unlock(&pgftl->mutex);
 	}
 }
 
@@ -62,7 +65,8 @@ static void page_ftl_invalidate(struct page_ftl *pgftl, size_t lpn)
  */
 static void page_ftl_write_end_rq(struct device_request *request)
 {
-	free(request->data);
+	struct page_ftl *pgftl = (struct page_ftl *)request->rq_private;
+	device_free_buffer(pgftl->dev, request->data);
 	device_free_request(request);
 }
 
@@ -78,6 +82,7 @@ static void page_ftl_write_end_rq(struct device_request *request)
  * @note
  * NAND-based storage doesn't allow to do overwrite.
  * Therefore, you must use the out-of-place update. So this logic is necessary.
+ * The read goes through the read cache; a hot page is not read again.
  */
 static ssize_t page_ftl_read_for_overwrite(struct page_ftl *pgftl, size_t lpn,
 					   void *buffer)
@@ -114,33 +119,87 @@ static ssize_t page_ftl_read_for_overwrite(struct page_ftl *pgftl, size_t lpn,
  * @param pgftl pointer of the page FTL
  * @param paddr written device address
  * @param sector logical sector number
+ *
+ * @return 0 for success, negative number when the journal drops the delta
+ *
+ * @note
+ * The caller must hold the LPN's stripe lock. The new page is recorded before
+ * the old one is invalidated, and the journal delta is appended last. So a
+ * journal snapshot taken in the middle never misses the LPN.
  */
-static void page_ftl_write_update_metadata(struct page_ftl *pgftl,
-					   struct device_address paddr,
-					   size_t sector)
+static int page_ftl_write_update_metadata(struct page_ftl *pgftl,
+					  struct device_address paddr,
+					  size_t sector)
 {
 	struct page_ftl_segment *segment;
+	struct device_address old_paddr;
 
 	size_t lpn;
+	int ret;
 	lpn = page_ftl_get_lpn(pgftl, sector);
-	if (pgftl->trans_map[lpn] != PADDR_EMPTY) {
-		page_ftl_invalidate(pgftl, lpn);
-		pr_debug("invalidate address: %zu => %u\n", lpn,
-			 pgftl->trans_map[lpn]);
+
+	/**< global information update */
+	old_paddr.lpn = page_ftl_map_load(pgftl, lpn);
+	if (page_ftl_update_map(pgftl, sector, old_paddr.lpn, paddr.lpn)) {
+		pr_err("mapping is changed without the lock (lpn: %zu)\n",
+		       lpn);
 	}
+
 	/**< segment information update */
 	segment = &pgftl->segments[paddr.format.block];
+	pthread_mutex_lock(&segment->mutex);
+	pgftl->p2l_map[paddr.lpn] = (uint32_t)lpn;
 	segment->lpn_list =
 		g_list_prepend(segment->lpn_list, GSIZE_TO_POINTER(lpn));
+	pthread_mutex_unlock(&segment->mutex);
 
-	/**< global information update */
-	page_ftl_update_map(pgftl, sector, paddr.lpn);
+	if (old_paddr.lpn != PADDR_EMPTY) {
+		page_ftl_invalidate(pgftl, lpn, old_paddr);
+		pr_debug("invalidate address: %zu => %u\n", lpn,
+			 old_paddr.lpn);
+	}
+
+	ret = page_ftl_journal_append(pgftl, lpn, paddr.lpn);
+	if (ret) {
+		pr_err("journal append failed (lpn: %zu)\n", lpn);
+	}
 
-	pr_debug("new address: %zu => %u (seg: %u)\n", lpn,
-		 pgftl->trans_map[lpn], pgftl->trans_map[lpn] >> 13);
+	pr_debug("new address: %zu => %u (seg: %u)\n", lpn, paddr.lpn,
+		 paddr.format.block);
 	pr_debug("%u/%u(free/valid)\n",
-		 g_atomic_int_get(&segment->nr_free_pages),
-		 g_atomic_int_get(&segment->nr_valid_pages));
+		 g_atomic_int_get(&pgftl->nr_free[paddr.format.block]),
+		 g_atomic_int_get(&pgftl->nr_valid[paddr.format.block]));
+
+	return ret;
+}
+
+/**
+ * @brief count the written page and close the full segment
+ *
+ * @param pgftl pointer of the page FTL
+ * @param segnum segment number of the written page
+ *
+ * @return 0 for success, negative number for fail
+ *
+ * @note
+ * The page whose device write failed is counted too. It is already taken
+ * from the segment, so the segment never becomes full without it.
+ */
+static int page_ftl_write_count_page(struct page_ftl *pgftl, size_t segnum)
+{
+	struct page_ftl_segment *segment = &pgftl->segments[segnum];
+	gint nr_written_pages;
+	int ret;
+
+	nr_written_pages = g_atomic_int_add(&segment->nr_written_pages, 1) + 1;
+	if (nr_written_pages != (gint)page_ftl_get_data_pages(pgftl)) {
+		return 0;
+	}
+	ret = page_ftl_summary_write(pgftl, segnum);
+	if (ret) {
+		pr_err("summary write failed (segnum: %zu)\n", segnum);
+	}
+	return ret;
 }
 
 /**
@@ -150,11 +209,19 @@ static void page_ftl_write_update_metadata(struct page_ftl *pgftl,
  * @param request user's request pointer
  *
  * @return writing data size. a negative number means fail to write.
+ *
+ * @note
+ * The caller must hold the LPN's stripe lock (see `page_ftl_get_lpn_lock()`).
+ * With `PAGE_FTL_USE_ORDERED_WRITE`, the allocator lock is held until the
+ * device write is issued. So, pages are written in the allocation order,
+ * which the zoned device requires.
  */
-ssize_t page_ftl_write(struct page_ftl *pgftl, struct device_request *request)
+ssize_t page_ftl_write_locked(struct page_ftl *pgftl,
+			      struct device_request *request)
 {
 	struct device *dev;
 	struct device_address paddr;
+	struct page_ftl_segment *segment;
 	char *buffer;
 	ssize_t ret;
 	size_t page_size;
@@ -165,7 +232,7 @@ ssize_t page_ftl_write(struct page_ftl *pgftl, struct device_request *request)
 	size_t write_size;
 	size_t sector;
 
-	int is_exist;
+	int err;
 
 	dev = pgftl->dev;
 	page_size = device_get_page_size(dev);
@@ -188,32 +255,40 @@ ssize_t page_ftl_write(struct page_ftl *pgftl, struct device_request *request)
 		return -EINVAL;
 	}
 
-	pthread_mutex_lock(&pgftl->mutex);
-	paddr = page_ftl_get_free_page(pgftl); /**< global data retrieve */
-	pthread_mutex_unlock(&pgftl->mutex);
-	if (paddr.lpn == PADDR_EMPTY) {
-		pr_err("cannot allocate the valid page from device\n");
-		return -EFAULT;
-	}
-
-	buffer = (char *)malloc(page_size);
+	buffer = (char *)device_alloc_buffer(dev, DEVICE_BUFFER_DEFAULT);
 	if (buffer == NULL) {
 		pr_err("memory allocation failed\n");
 		return -ENOMEM;
 	}
-	memset(buffer, 0, page_size);
-	pthread_mutex_lock(&pgftl->mutex);
-	is_exist = pgftl->trans_map[lpn] != PADDR_EMPTY;
-	pthread_mutex_unlock(&pgftl->mutex);
-	if (is_exist) {
+	/** a full-page write doesn't need the previous data */
+	if (write_size != page_size &&
+	    page_ftl_map_load(pgftl, lpn) != PADDR_EMPTY) {
+		/** the whole page is filled by the read */
 		ret = page_ftl_read_for_overwrite(pgftl, lpn, buffer);
 		if (ret < 0) {
 			pr_err("read failed (lpn:%zu)\n", lpn);
+			device_free_buffer(dev, buffer);
 			return ret;
 		}
+	} else if (write_size != page_size) {
+		memset(buffer, 0, page_size);
 	}
 	memcpy(&buffer[offset], request->data, write_size);
 
+	pthread_mutex_lock(&pgftl->alloc_mutex);
+	paddr = page_ftl_get_free_page(pgftl); /**< global data retrieve */
+#ifndef PAGE_FTL_USE_ORDERED_WRITE
+	pthread_mutex_unlock(&pgftl->alloc_mutex);
+#endif
+	if (paddr.lpn == PADDR_EMPTY) {
+#ifdef PAGE_FTL_USE_ORDERED_WRITE
+		pthread_mutex_unlock(&pgftl->alloc_mutex);
+#endif
+		pr_err("cannot allocate the valid page from device\n");
+		device_free_buffer(dev, buffer);
+		return -EFAULT;
+	}
+
 	request->flag = DEVICE_WRITE;
 	request->data = buffer;
 	request->paddr = paddr;
@@ -221,15 +296,52 @@ ssize_t page_ftl_write(struct page_ftl *pgftl, struct device_request *request)
 	request->data_len = page_size;
 	request->end_rq = page_ftl_write_end_rq;
 
+	/** the buffer can be released by the device; copy it beforehand */
+	segment = &pgftl->segments[paddr.format.block];
+	page_ftl_cache_update(pgftl, lpn, paddr.lpn,
+			      g_atomic_int_get(&segment->erase_epoch), buffer);
+
 	ret = dev->d_op->write(dev, request);
+#ifdef PAGE_FTL_USE_ORDERED_WRITE
+	pthread_mutex_unlock(&pgftl->alloc_mutex);
+#endif
 	if (ret != (ssize_t)device_get_page_size(dev)) {
-		pr_err("device write failed (ppn: %u)\n", request->paddr.lpn);
+		pr_err("device write failed (ppn: %u)\n", paddr.lpn);
+		page_ftl_cache_invalidate(pgftl, lpn);
+		page_ftl_write_count_page(pgftl, paddr.format.block);
+		return ret < 0 ? ret : -EIO;
+	}
+
+	/** the segment is closed even if the mapping isn't durable */
+	err = page_ftl_write_update_metadata(pgftl, paddr, sector);
+	ret = page_ftl_write_count_page(pgftl, paddr.format.block);
+	if (ret) {
 		return ret;
 	}
+	if (err) {
+		return err;
+	}
+
+	return (ssize_t)write_size;
+}
 
-	pthread_mutex_lock(&pgftl->mutex);
-	page_ftl_write_update_metadata(pgftl, paddr, sector);
-	pthread_mutex_unlock(&pgftl->mutex);
+/**
+ * @brief write the request to the device with the LPN's stripe lock
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param request user's request pointer
+ *
+ * @return writing data size. a negative number means fail to write.
+ */
+ssize_t page_ftl_write(struct page_ftl *pgftl, struct device_request *request)
+{
+	pthread_mutex_t *lock;
+	ssize_t ret;
 
-	return write_size;
+	lock = page_ftl_get_lpn_lock(pgftl,
+				     page_ftl_get_lpn(pgftl, request->sector));
+	pthread_mutex_lock(lock);
+	ret = page_ftl_write_locked(pgftl, request);
+	pthread_mutex_unlock(lock);
+	return ret;
 }
@@ -0,0 +1,209 @@
+/**
+ * @file argmin.h
+ * @brief find the smallest value of the masked per-segment counters
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ *
+ * @note
+ * The values are visited in the blocks of 64 entries which match a word of
+ * the `include` and `exclude` bitmaps. The block without the candidate is
+ * skipped by a word test and the others are reduced with the vector
+ * minimum. The entry itself is searched only in the block whose minimum
+ * beats the current one.
+ */
+#ifndef ARGMIN_H
+#define ARGMIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bits.h"
+
+#define ARGMIN_NOT_FOUND ((size_t)-1)
+#define ARGMIN_BLOCK_SIZE (BITS_PER_UINT64) /**< entries of a mask word */
+
+/**
+ * @brief reduce the candidates of the block to the minimum value
+ *
+ * @param values the first entry of the block (`ARGMIN_BLOCK_SIZE` entries)
+ * @param candidates mask of the entries to be compared (never 0)
+ */
+typedef int32_t (*argmin_block_fn)(const int32_t *values, uint64_t candidates);
+
+/**
+ * @brief get the minimum of the block's candidates (generic version)
+ */
+static inline int32_t argmin_block_generic(const int32_t *values,
+					   uint64_t candidates)
+{
+	int32_t min = INT32_MAX;
+	for (; candidates; candidates &= candidates - 1) {
+		int32_t value = values[__builtin_ctzll(candidates)];
+		min = value < min ? value : min;
+	}
+	return min;
+}
+
+#if BITS_USE_SIMD
+/**
+ * @brief get the minimum of the block's candidates (AVX2)
+ *
+ * @note
+ * Each byte of the mask is spread to the 8 lanes and the entries which are
+ * not the candidate are replaced to the `INT32_MAX`.
+ */
+__attribute__((target("avx2"))) static inline int32_t
+argmin_block_avx2(const int32_t *values, uint64_t candidates)
+{
+	const __m256i lane_bits =
+		_mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	const __m256i max = _mm256_set1_epi32(INT32_MAX);
+	__m256i acc = max;
+	__m128i min;
+
+	for (int i = 0; i < (int)ARGMIN_BLOCK_SIZE / 8; i++) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)&values[i * 8]);
+		__m256i byte = _mm256_set1_epi32((int)((candidates >> (i * 8)) &
+						       0xff));
+		__m256i lanes = _mm256_cmpeq_epi32(
+			_mm256_and_si256(byte, lane_bits), lane_bits);
+		acc = _mm256_min_epi32(acc, _mm256_blendv_epi8(max, v, lanes));
+	}
+	min = _mm_min_epi32(_mm256_castsi256_si128(acc),
+			    _mm256_extracti128_si256(acc, 1));
+	min = _mm_min_epi32(min, _mm_shuffle_epi32(min, 0x4e));
+	min = _mm_min_epi32(min, _mm_shuffle_epi32(min, 0xb1));
+	return (int32_t)_mm_cvtsi128_si32(min);
+}
+
+/**
+ * @brief get the minimum of the block's candidates (AVX-512)
+ *
+ * @note
+ * The mask is used as the lane mask of the vector minimum directly.
+ */
+__attribute__((target("avx512f"))) static inline int32_t
+argmin_block_avx512(const int32_t *values, uint64_t candidates)
+{
+	const __mmask16 all = (__mmask16)0xffff;
+	__m512i acc = _mm512_set1_epi32(INT32_MAX);
+
+	for (int i = 0; i < (int)ARGMIN_BLOCK_SIZE / 16; i++) {
+		__m512i v = _mm512_loadu_si512((const void *)&values[i * 16]);
+		__mmask16 lanes = (__mmask16)(candidates >> (i * 16));
+		acc = _mm512_mask_min_epi32(acc, lanes, acc, v);
+	}
+	/**
+	 * The unmasked forms pass the undefined vector which trips the
+	 * -Wuninitialized of GCC 12, so every lane is selected explicitly.
+	 */
+	acc = _mm512_mask_min_epi32(
+		acc, all, acc,
+		_mm512_mask_shuffle_i32x4(acc, all, acc, acc, 0x4e));
+	acc = _mm512_mask_min_epi32(
+		acc, all, acc,
+		_mm512_mask_shuffle_i32x4(acc, all, acc, acc, 0xb1));
+	acc = _mm512_mask_min_epi32(
+		acc, all, acc,
+		_mm512_mask_shuffle_epi32(acc, all, acc, (_MM_PERM_ENUM)0x4e));
+	acc = _mm512_mask_min_epi32(
+		acc, all, acc,
+		_mm512_mask_shuffle_epi32(acc, all, acc, (_MM_PERM_ENUM)0xb1));
+	return (int32_t)_mm512_cvtsi512_si32(acc);
+}
+#endif
+
+/**
+ * @brief find the first entry which has the smallest value of the candidates
+ *
+ * @param values array of the values
+ * @param nr_values the number of the entries
+ * @param include bitmap of the candidates (NULL for every entry)
+ * @param exclude bitmap of the entries to be skipped (NULL for nothing)
+ * @param block block reduction function
+ *
+ * @return position of the entry, ARGMIN_NOT_FOUND when no candidate exists
+ *
+ * @note
+ * The entry is picked by the scalar loop over the block after the vector
+ * minimum, so the values which are updated concurrently lead to a stale
+ * choice but never to a wrong position.
+ */
+static inline size_t argmin_masked_with(const int32_t *values,
+					size_t nr_values,
+					const uint64_t *include,
+					const uint64_t *exclude,
+					argmin_block_fn block)
+{
+	size_t nr_words = (nr_values + ARGMIN_BLOCK_SIZE - 1) /
+			  ARGMIN_BLOCK_SIZE;
+	size_t idx = ARGMIN_NOT_FOUND;
+	int32_t min = INT32_MAX;
+
+	for (size_t word = 0; word < nr_words; word++) {
+		const int32_t *base = &values[word * ARGMIN_BLOCK_SIZE];
+		uint64_t candidates = include ? include[word] : UINT64_MAX;
+		argmin_block_fn reduce = block;
+		int32_t block_min;
+
+		if (exclude) {
+			candidates &= ~exclude[word];
+		}
+		/** the vector must not read after the last entry */
+		if (word == nr_words - 1 && nr_values % ARGMIN_BLOCK_SIZE) {
+			candidates &= ((uint64_t)0x1
+				       << (nr_values % ARGMIN_BLOCK_SIZE)) -
+				      1;
+			reduce = argmin_block_generic;
+		}
+		if (candidates == 0) {
+			continue;
+		}
+		block_min = reduce(base, candidates);
+		if (idx != ARGMIN_NOT_FOUND && block_min >= min) {
+			continue;
+		}
+		for (; candidates; candidates &= candidates - 1) {
+			size_t pos = (size_t)__builtin_ctzll(candidates);
+			if (idx == ARGMIN_NOT_FOUND || base[pos] < min) {
+				min = base[pos];
+				idx = word * ARGMIN_BLOCK_SIZE + pos;
+			}
+		}
+	}
+	return idx;
+}
+
+/**
+ * @brief find the first entry which has the smallest value of the candidates
+ *
+ * @param values array of the values
+ * @param nr_values the number of the entries
+ * @param include bitmap of the candidates (NULL for every entry)
+ * @param exclude bitmap of the entries to be skipped (NULL for nothing)
+ *
+ * @return position of the entry, ARGMIN_NOT_FOUND when no candidate exists
+ *
+ * @note
+ * The widest vector of the CPU is chosen at runtime.
+ */
+static inline size_t argmin_masked(const int32_t *values, size_t nr_values,
+				   const uint64_t *include,
+				   const uint64_t *exclude)
+{
+#if BITS_USE_SIMD
+	if (__builtin_cpu_supports("avx512f")) {
+		return argmin_masked_with(values, nr_values, include, exclude,
+					  argmin_block_avx512);
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		return argmin_masked_with(values, nr_values, include, exclude,
+					  argmin_block_avx2);
+	}
+#endif
+	return argmin_masked_with(values, nr_values, include, exclude,
+				  argmin_block_generic);
+}
+
+#endif
@@ -51,6 +51,215 @@ static inline void reset_bit(uint64_t *bits, uint64_t index)
 		~((uint64_t)0x1 << (index % BITS_PER_UINT64));
 }
 
+/**
+ * @brief get the value at the index position bit atomically
+ *
+ * @param bits array which contains the bitmap
+ * @param index get position (bit position NOT byte or uint64_t position)
+ *
+ * @return bit status at the index position
+ */
+static inline int get_bit_atomic(uint64_t *bits, uint64_t index)
+{
+	return (__atomic_load_n(&bits[BITS_TO_UINT64(index)],
+				__ATOMIC_ACQUIRE) &
+		((uint64_t)0x1 << (index % BITS_PER_UINT64))) > 0;
+}
+
+/**
+ * @brief set the index position bit atomically
+ *
+ * @param bits array which contains the bitmap
+ * @param index set position (bit position NOT byte or uint64_t position)
+ *
+ * @return previous bit status at the index position
+ */
+static inline int test_and_set_bit_atomic(uint64_t *bits, uint64_t index)
+{
+	uint64_t mask = (uint64_t)0x1 << (index % BITS_PER_UINT64);
+	return (__atomic_fetch_or(&bits[BITS_TO_UINT64(index)], mask,
+				  __ATOMIC_ACQ_REL) &
+		mask) > 0;
+}
+
+/**
+ * @brief reset the index position bit atomically
+ *
+ * @param bits array which contains the bitmap
+ * @param index reset position (bit position NOT byte or uint64_t position)
+ *
+ * @return previous bit status at the index position
+ */
+static inline int test_and_clear_bit_atomic(uint64_t *bits, uint64_t index)
+{
+	uint64_t mask = (uint64_t)0x1 << (index % BITS_PER_UINT64);
+	return (__atomic_fetch_and(&bits[BITS_TO_UINT64(index)], ~mask,
+				   __ATOMIC_ACQ_REL) &
+		mask) > 0;
+}
+
+/**
+ * @brief search the word which isn't `skip` (generic version)
+ *
+ * @param bits array which contains the bitmap
+ * @param word start position word
+ * @param nr_words the number of words in the bitmap
+ * @param skip word value to pass over (0: find one, UINT64_MAX: find zero)
+ *
+ * @return position of the word, `nr_words` when it doesn't exist
+ */
+static inline uint64_t bits_find_word_generic(const uint64_t *bits,
+					      uint64_t word, uint64_t nr_words,
+					      uint64_t skip)
+{
+	for (; word < nr_words; word++) {
+		if (bits[word] != skip) {
+			break;
+		}
+	}
+	return word;
+}
+
+/**
+ * @brief count the one bits in the words (generic version)
+ */
+static inline uint64_t bits_count_words_generic(const uint64_t *bits,
+						uint64_t nr_words)
+{
+	uint64_t word, count = 0;
+	for (word = 0; word < nr_words; word++) {
+		count += (uint64_t)__builtin_popcountll(bits[word]);
+	}
+	return count;
+}
+
+#ifndef BITS_USE_SIMD
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BITS_USE_SIMD (1)
+#else
+#define BITS_USE_SIMD (0)
+#endif
+#endif
+
+#if BITS_USE_SIMD
+#include <immintrin.h>
+
+/**
+ * @brief the number of words from which the vector search is used
+ *
+ * @note
+ * The bitmap of a segment is a few words long and the scalar loop finishes
+ * it before the vector loop pays off.
+ */
+#define BITS_SIMD_MIN_WORDS (8)
+
+/**
+ * @brief search the word which isn't `skip` (SSE2; every x86-64 has it)
+ */
+static inline uint64_t bits_find_word_sse2(const uint64_t *bits,
+					   uint64_t word, uint64_t nr_words,
+					   uint64_t skip)
+{
+	const __m128i pattern = _mm_set1_epi64x((long long)skip);
+	for (; word + 2 <= nr_words; word += 2) {
+		__m128i v = _mm_loadu_si128((const __m128i *)&bits[word]);
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(v, pattern));
+		if (mask != 0xffff) {
+			/** a word differs when any of its 8 bytes differs */
+			return word + (uint64_t)((~mask & 0xff) == 0);
+		}
+	}
+	return bits_find_word_generic(bits, word, nr_words, skip);
+}
+
+/**
+ * @brief search the word which isn't `skip` (AVX2)
+ */
+__attribute__((target("avx2"))) static inline uint64_t
+bits_find_word_avx2(const uint64_t *bits, uint64_t word, uint64_t nr_words,
+		    uint64_t skip)
+{
+	const __m256i pattern = _mm256_set1_epi64x((long long)skip);
+	for (; word + 4 <= nr_words; word += 4) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)&bits[word]);
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(
+			_mm256_cmpeq_epi64(v, pattern));
+		if (mask != 0xffffffffU) {
+			return word + (uint64_t)__builtin_ctz(~mask) / 8;
+		}
+	}
+	return bits_find_word_generic(bits, word, nr_words, skip);
+}
+
+/**
+ * @brief count the one bits in the words (POPCNT instruction)
+ */
+__attribute__((target("popcnt"))) static inline uint64_t
+bits_count_words_popcnt(const uint64_t *bits, uint64_t nr_words)
+{
+	uint64_t word, count = 0;
+	for (word = 0; word < nr_words; word++) {
+		count += (uint64_t)__builtin_popcountll(bits[word]);
+	}
+	return count;
+}
+#endif
+
+/**
+ * @brief search the word which isn't `skip` with the fastest way of the CPU
+ *
+ * @note
+ * The CPU features are checked at runtime, so the binary built without
+ * `-mavx2` uses the AVX2 on the machine which supports it.
+ */
+static inline uint64_t bits_find_word(const uint64_t *bits, uint64_t word,
+				      uint64_t nr_words, uint64_t skip)
+{
+#if BITS_USE_SIMD
+	if (nr_words - word >= BITS_SIMD_MIN_WORDS) {
+		if (__builtin_cpu_supports("avx2")) {
+			return bits_find_word_avx2(bits, word, nr_words, skip);
+		}
+		return bits_find_word_sse2(bits, word, nr_words, skip);
+	}
+#endif
+	return bits_find_word_generic(bits, word, nr_words, skip);
+}
+
+/**
+ * @brief find the first bit which differs from `skip` from the idx
+ *
+ * @param bits array which contains the bitmap
+ * @param size bitmap's size (the number of bits NOT bytes)
+ * @param idx start position bit
+ * @param skip 0 for finding the one bit, UINT64_MAX for the zero bit
+ *
+ * @return bit position, BITS_NOT_FOUND when it doesn't exist
+ */
+static inline uint64_t bits_find(const uint64_t *bits, uint64_t size,
+				 uint64_t idx, uint64_t skip)
+{
+	uint64_t nr_words = (size + BITS_PER_UINT64 - 1) / BITS_PER_UINT64;
+	uint64_t word = BITS_TO_UINT64(idx);
+	uint64_t bucket;
+
+	if (idx >= size) {
+		return BITS_NOT_FOUND;
+	}
+	/** the target bits become one and the bits before the idx are masked */
+	bucket = (bits[word] ^ skip) &
+		 ((uint64_t)UINT64_MAX << (idx % BITS_PER_UINT64));
+	if (bucket == 0) {
+		word = bits_find_word(bits, word + 1, nr_words, skip);
+		if (word == nr_words) {
+			return BITS_NOT_FOUND;
+		}
+		bucket = bits[word] ^ skip;
+	}
+	idx = word * BITS_PER_UINT64 + (uint64_t)__builtin_ctzll(bucket);
+	return idx < size ? idx : BITS_NOT_FOUND;
+}
+
 /**
  * @brief find first zero bit in the array(uint64_t)
  *
@@ -63,21 +272,7 @@ static inline void reset_bit(uint64_t *bits, uint64_t index)
 static inline uint64_t find_first_zero_bit(uint64_t *bits, uint64_t size,
 					   uint64_t idx)
 {
-	while (idx < size) {
-		uint64_t bucket = bits[BITS_TO_UINT64(idx)];
-		if (bucket < (uint64_t)UINT64_MAX) {
-			uint64_t diff = 0;
-			for (diff = 0; diff < BITS_PER_UINT64; diff++) {
-				if ((bucket & (uint64_t)((uint64_t)0x1
-							 << diff)) == 0x0) {
-					break;
-				}
-			}
-			return idx + diff;
-		}
-		idx += BITS_PER_UINT64;
-	}
-	return BITS_NOT_FOUND;
+	return bits_find(bits, size, idx, (uint64_t)UINT64_MAX);
 }
 
 /**
@@ -92,21 +287,148 @@ static inline uint64_t find_first_zero_bit(uint64_t *bits, uint64_t size,
 static inline uint64_t find_first_one_bit(uint64_t *bits, uint64_t size,
 					  uint64_t idx)
 {
-	while (idx < size) {
-		uint64_t bucket = bits[BITS_TO_UINT64(idx)];
-		if (bucket > (uint64_t)0x0) {
-			uint64_t diff = 0;
-			for (diff = 0; diff < BITS_PER_UINT64; diff++) {
-				if ((bucket &
-				     (uint64_t)((uint64_t)0x1 << diff)) > 0) {
-					break;
-				}
+	return bits_find(bits, size, idx, 0);
+}
+
+/**
+ * @brief find the zero bit after the previous position
+ *
+ * @param bits array which contains the bitmap
+ * @param size bitmap's size (the number of bits NOT bytes)
+ * @param prev previously found position
+ *
+ * @return next zero bit position
+ */
+static inline uint64_t find_next_zero_bit(uint64_t *bits, uint64_t size,
+					  uint64_t prev)
+{
+	if (prev >= size) {
+		return BITS_NOT_FOUND;
+	}
+	return bits_find(bits, size, prev + 1, (uint64_t)UINT64_MAX);
+}
+
+/**
+ * @brief find the one bit after the previous position
+ *
+ * @param bits array which contains the bitmap
+ * @param size bitmap's size (the number of bits NOT bytes)
+ * @param prev previously found position
+ *
+ * @return next one bit position
+ */
+static inline uint64_t find_next_one_bit(uint64_t *bits, uint64_t size,
+					 uint64_t prev)
+{
+	if (prev >= size) {
+		return BITS_NOT_FOUND;
+	}
+	return bits_find(bits, size, prev + 1, 0);
+}
+
+/**
+ * @brief set the first zero bit from the idx atomically
+ *
+ * @param bits array which contains the bitmap
+ * @param size bitmap's size (the number of bits NOT bytes)
+ * @param idx start position bit
+ *
+ * @return claimed bit position, BITS_NOT_FOUND when every bit is set
+ *
+ * @note
+ * The bit is set by the compare-and-swap of its word, so the concurrent
+ * claims never get the same bit. Every concurrent writer of the bitmap must
+ * use the atomic operations; the plain `set_bit()` can lose the claim.
+ */
+static inline uint64_t claim_first_zero_bit_atomic(uint64_t *bits,
+						   uint64_t size, uint64_t idx)
+{
+	uint64_t nr_words = (size + BITS_PER_UINT64 - 1) / BITS_PER_UINT64;
+	uint64_t word = BITS_TO_UINT64(idx);
+	uint64_t mask;
+
+	if (idx >= size) {
+		return BITS_NOT_FOUND;
+	}
+	mask = (uint64_t)UINT64_MAX << (idx % BITS_PER_UINT64);
+	for (; word < nr_words; word++, mask = (uint64_t)UINT64_MAX) {
+		uint64_t old = __atomic_load_n(&bits[word], __ATOMIC_RELAXED);
+		uint64_t candidates;
+
+		if (word == nr_words - 1 && size % BITS_PER_UINT64) {
+			mask &= ((uint64_t)0x1 << (size % BITS_PER_UINT64)) - 1;
+		}
+		/** the failed compare-and-swap reloads the word to `old` */
+		while ((candidates = ~old & mask) != 0) {
+			uint64_t bit = (uint64_t)__builtin_ctzll(candidates);
+			if (__atomic_compare_exchange_n(
+				    &bits[word], &old,
+				    old | ((uint64_t)0x1 << bit), 1,
+				    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+				return word * BITS_PER_UINT64 + bit;
 			}
-			return idx + diff;
 		}
-		idx += BITS_PER_UINT64;
 	}
 	return BITS_NOT_FOUND;
 }
 
+/**
+ * @brief iterate the one bits in the array(uint64_t)
+ */
+#define for_each_one_bit(bit, bits, size)                                      \
+	for ((bit) = find_first_one_bit((bits), (size), 0);                    \
+	     (bit) != BITS_NOT_FOUND;                                          \
+	     (bit) = find_next_one_bit((bits), (size), (bit)))
+
+/**
+ * @brief iterate the zero bits in the array(uint64_t)
+ */
+#define for_each_zero_bit(bit, bits, size)                                     \
+	for ((bit) = find_first_zero_bit((bits), (size), 0);                   \
+	     (bit) != BITS_NOT_FOUND;                                          \
+	     (bit) = find_next_zero_bit((bits), (size), (bit)))
+
+/**
+ * @brief count the one bits in the array(uint64_t)
+ *
+ * @param bits array which contains the bitmap
+ * @param size bitmap's size (the number of bits NOT bytes)
+ *
+ * @return the number of one bits
+ */
+static inline uint64_t count_one_bits(const uint64_t *bits, uint64_t size)
+{
+	uint64_t nr_words = BITS_TO_UINT64(size);
+	uint64_t tail = size % BITS_PER_UINT64;
+	uint64_t count;
+
+#if BITS_USE_SIMD
+	if (__builtin_cpu_supports("popcnt")) {
+		count = bits_count_words_popcnt(bits, nr_words);
+	} else {
+		count = bits_count_words_generic(bits, nr_words);
+	}
+#else
+	count = bits_count_words_generic(bits, nr_words);
+#endif
+	if (tail) {
+		count += (uint64_t)__builtin_popcountll(
+			bits[nr_words] & (((uint64_t)0x1 << tail) - 1));
+	}
+	return count;
+}
+
+/**
+ * @brief count the zero bits in the array(uint64_t)
+ *
+ * @param bits array which contains the bitmap
+ * @param size bitmap's size (the number of bits NOT bytes)
+ *
+ * @return the number of zero bits
+ */
+static inline uint64_t count_zero_bits(const uint64_t *bits, uint64_t size)
+{
+	return size - count_one_bits(bits, size);
+}
+
 #endif
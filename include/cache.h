@@ -0,0 +1,197 @@
+/**
+ * @file cache.h
+ * @brief generic cache interface with the replaceable eviction policies
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ *
+ * @note
+ * `cache` is not thread-safe. `sharded_cache` is the thread-safe variant
+ * which consists of the independently locked caches.
+ */
+#ifndef CACHE_H
+#define CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "lru.h"
+
+/**
+ * @brief eviction policies of the cache
+ */
+enum {
+	CACHE_POLICY_LRU = 0, /**< strict LRU (`lru_cache`) */
+	CACHE_POLICY_CLOCK, /**< second chance with the reference bitmap */
+	CACHE_POLICY_2Q, /**< FIFO probation queue and LRU main queue */
+	CACHE_POLICY_ARC, /**< adaptive replacement cache */
+	NR_CACHE_POLICY,
+};
+
+#define SHARDED_CACHE_NR_ACCESSES (64) /**< hits buffered before promotion */
+
+struct cache;
+
+/**
+ * @brief access function which runs while the entry cannot be evicted
+ */
+typedef int (*cache_access_fn)(const uint64_t, uintptr_t, void *);
+
+/**
+ * @brief operations of the eviction policy
+ *
+ * @note
+ * The value 0 means the miss; the cached values must not be 0.
+ */
+struct cache_operations {
+	int (*put)(struct cache *, const uint64_t key, uintptr_t value);
+	/** lookup which counts as a hit */
+	uintptr_t (*get)(struct cache *, const uint64_t key);
+	/** lookup without the state change */
+	uintptr_t (*peek)(struct cache *, const uint64_t key);
+	int (*del)(struct cache *, const uint64_t key);
+	int (*evict)(struct cache *, const size_t nr_entries);
+	void (*free)(struct cache *);
+};
+
+/**
+ * @brief cache which has the policy's operations
+ *
+ * @note
+ * Every evicted, replaced or deleted value is passed to `deallocate`.
+ * Only the LRU policy supports the deferred deallocation
+ * (`LRU_DEALLOC_DEFER`) by `lru_set_flusher()` on `c_private`.
+ */
+struct cache {
+	int policy;
+	size_t capacity;
+	size_t size; /**< number of the resident entries */
+	lru_dealloc_fn deallocate;
+	const struct cache_operations *c_op;
+	void *c_private; /**< policy's data */
+};
+
+/**
+ * @brief part of the sharded cache which has its own lock
+ *
+ * @note
+ * A hit takes the read lock and only records the key in `accesses`. The
+ * recorded hits are applied to the policy in a batch under the write lock.
+ */
+struct cache_shard {
+	pthread_rwlock_t rwlock;
+	struct cache *cache;
+	uint64_t accesses[SHARDED_CACHE_NR_ACCESSES]; /**< keys of the hits */
+	size_t nr_accesses; /**< can exceed the buffer; extra hits are lost */
+} __attribute__((aligned(64)));
+
+/**
+ * @brief thread-safe cache which consists of the independent shards
+ */
+struct sharded_cache {
+	struct cache_shard *shards;
+	size_t nr_shards;
+	size_t capacity; /**< sum of the shards' capacity */
+};
+
+/* cache.c */
+struct cache *cache_init(const int policy, const size_t capacity,
+			 lru_dealloc_fn deallocate);
+const char *cache_get_policy_name(const int policy);
+int cache_get_policy(const char *name);
+int cache_dealloc(struct cache *cache, const uint64_t key, uintptr_t value);
+
+/* cache-clock.c, cache-2q.c, cache-arc.c */
+int cache_clock_init(struct cache *cache);
+int cache_2q_init(struct cache *cache);
+int cache_arc_init(struct cache *cache);
+
+/* sharded-cache.c */
+struct sharded_cache *sharded_cache_init(const int policy,
+					 const size_t capacity,
+					 const size_t nr_shards,
+					 lru_dealloc_fn deallocate);
+int sharded_cache_put(struct sharded_cache *cache, const uint64_t key,
+		      uintptr_t value);
+uintptr_t sharded_cache_get(struct sharded_cache *cache, const uint64_t key);
+int sharded_cache_access(struct sharded_cache *cache, const uint64_t key,
+			 cache_access_fn access, void *data);
+int sharded_cache_delete(struct sharded_cache *cache, const uint64_t key);
+int sharded_cache_free(struct sharded_cache *cache);
+
+/**
+ * @brief insert the key, value; the previous value of the key is replaced
+ *
+ * @return 0 to success
+ */
+static inline int cache_put(struct cache *cache, const uint64_t key,
+			    uintptr_t value)
+{
+	return cache->c_op->put(cache, key, value);
+}
+
+/**
+ * @brief get the value and record the hit for the policy
+ *
+ * @return value of the key (0 when the key doesn't exist)
+ */
+static inline uintptr_t cache_get(struct cache *cache, const uint64_t key)
+{
+	return cache->c_op->get(cache, key);
+}
+
+/**
+ * @brief get the value without changing the policy's state
+ *
+ * @return value of the key (0 when the key doesn't exist)
+ *
+ * @note
+ * The concurrent peeks are safe if nothing modifies the cache.
+ */
+static inline uintptr_t cache_peek(struct cache *cache, const uint64_t key)
+{
+	return cache->c_op->peek(cache, key);
+}
+
+/**
+ * @brief delete the entry and deallocate its value
+ *
+ * @return 0 to success, -ENOENT when the key doesn't exist
+ */
+static inline int cache_delete(struct cache *cache, const uint64_t key)
+{
+	return cache->c_op->del(cache, key);
+}
+
+/**
+ * @brief evict the entries which the policy selects
+ *
+ * @return 0 to success
+ */
+static inline int cache_evict(struct cache *cache, const size_t nr_entries)
+{
+	return cache->c_op->evict(cache, nr_entries);
+}
+
+/**
+ * @brief deallocate the cache and the remaining values
+ */
+static inline void cache_free(struct cache *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+	cache->c_op->free(cache);
+	free(cache);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -24,6 +24,25 @@ struct device_operations;
 #define DEVICE_PAGE_SIZE (8192)
 #endif
 
+#ifndef DEVICE_BUFFER_ALIGN
+#define DEVICE_BUFFER_ALIGN                                                    \
+	(4096) /**< alignment of the page buffers (DMA and O_DIRECT) */
+#endif
+#ifndef DEVICE_BUFFER_SLAB_SIZE
+#define DEVICE_BUFFER_SLAB_SIZE                                                \
+	((size_t)2 << 20) /**< page buffers are carved from this size */
+#endif
+#ifndef DEVICE_BUFFER_CACHE_SIZE
+#define DEVICE_BUFFER_CACHE_SIZE                                               \
+	(32) /**< page buffers kept in each thread's buffer cache */
+#endif
+// #define DEVICE_USE_HUGEPAGE_BUFFER /**< back the slabs with the hugepages */
+
+#ifndef DEVICE_REQUEST_CACHE_SIZE
+#define DEVICE_REQUEST_CACHE_SIZE                                              \
+	(64) /**< requests kept in each thread's request cache */
+#endif
+
 /**
  * @brief request allocation flags
  */
@@ -31,6 +50,24 @@ enum {
 	DEVICE_DEFAULT_REQUEST = 0,
 };
 
+/**
+ * @brief page buffer allocation flags
+ */
+enum {
+	DEVICE_BUFFER_DEFAULT = 0,
+	DEVICE_BUFFER_ZERO = (1 << 0), /**< clear the buffer */
+};
+
+/**
+ * @brief device capability flags
+ */
+enum {
+	DEVICE_ASYNC_COMPLETION = 0,
+	DEVICE_SYNC_COMPLETION =
+		(1 << 0), /**< end_rq is called before read/write returns */
+	DEVICE_LOW_LATENCY = (1 << 1), /**< read is as fast as the memcpy */
+};
+
 /**
  * @brief flash board I/O direction
  */
@@ -143,6 +180,8 @@ struct device_request {
 	pthread_cond_t cond;
 
 	void *rq_private; /**< contain the request's private data */
+
+	struct device_request *pool_next; /**< free list of the request pool */
 };
 
 /**
@@ -186,6 +225,7 @@ struct device {
 	struct device_info info;
 	uint64_t *badseg_bitmap;
 	void *d_private; /**< generally contain the sub-layer's data structure */
+	uint64_t d_flags; /**< capability flags set by the submodule */
 	int (*d_submodule_exit)(struct device *);
 };
 
@@ -202,6 +242,11 @@ struct device_operations {
 
 struct device_request *device_alloc_request(uint64_t flags);
 void device_free_request(struct device_request *);
+uint64_t device_get_request_pool_misses(void);
+
+void *device_alloc_buffer(struct device *, uint64_t flags);
+void device_free_buffer(struct device *, void *buffer);
+uint64_t device_get_buffer_pool_misses(void);
 
 int device_module_init(const uint64_t modnum, struct device **, uint64_t flags);
 int device_module_exit(struct device *);
@@ -286,4 +331,40 @@ static inline size_t device_get_total_pages(struct device *dev)
 	return device_get_total_size(dev) / device_get_page_size(dev);
 }
 
+/**
+ * @brief check the buffer can be passed to the direct I/O without a copy
+ *
+ * @param buffer pointer of the buffer
+ *
+ * @return 1 for aligned to DEVICE_BUFFER_ALIGN, 0 for not aligned
+ */
+static inline int device_is_aligned_buffer(const void *buffer)
+{
+	return ((uintptr_t)buffer % DEVICE_BUFFER_ALIGN) == 0;
+}
+
+/**
+ * @brief check the device completes the requests before returning
+ *
+ * @param dev device structure pointer
+ *
+ * @return 1 for the synchronous completion, 0 for the asynchronous one
+ */
+static inline int device_is_sync_completion(struct device *dev)
+{
+	return (dev->d_flags & DEVICE_SYNC_COMPLETION) != 0;
+}
+
+/**
+ * @brief check the device is fast enough to make the read-ahead useless
+ *
+ * @param dev device structure pointer
+ *
+ * @return 1 for the memory-speed device, 0 otherwise
+ */
+static inline int device_is_low_latency(struct device *dev)
+{
+	return (dev->d_flags & DEVICE_LOW_LATENCY) != 0;
+}
+
 #endif
@@ -0,0 +1,443 @@
+/**
+ * @file flash-coro.h
+ * @brief C++20 coroutine front-end of the flash interfaces (header-only)
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ *
+ * @note
+ * This header is empty unless it is compiled with C++20 or later.
+ * Each read and write is submitted by the `submit` of the flash operations
+ * and the coroutine is resumed by the executor's threads after the I/O
+ * completes. So a few threads can keep many I/Os in flight.
+ *
+ * @code
+ * ftl::task<> copy(ftl::executor &ex, off_t from, off_t to)
+ * {
+ *	char buffer[4096];
+ *	ssize_t ret = co_await ex.read(buffer, sizeof(buffer), from);
+ *	if (ret == sizeof(buffer))
+ *		co_await ex.write(buffer, sizeof(buffer), to);
+ * }
+ *
+ * ftl::executor ex(flash);
+ * ex.spawn(copy(ex, 0, 4096));
+ * ex.run();
+ * @endcode
+ */
+#ifndef FLASH_CORO_H
+#define FLASH_CORO_H
+
+#if defined(__cplusplus) && __cplusplus >= 202002L
+
+#include <coroutine>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "flash.h"
+#include "page.h"
+
+namespace ftl
+{
+template <typename T = void> class task;
+
+namespace detail
+{
+/**
+ * @brief common part of the task's promise
+ */
+struct promise_base {
+	std::coroutine_handle<> continuation = std::noop_coroutine();
+	std::exception_ptr exception;
+
+	/**
+	 * @brief resume the awaiting coroutine when the task finishes
+	 */
+	struct final_awaiter {
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+		template <typename P>
+		std::coroutine_handle<>
+		await_suspend(std::coroutine_handle<P> handle) noexcept
+		{
+			return handle.promise().continuation;
+		}
+		void await_resume() const noexcept
+		{
+		}
+	};
+
+	std::suspend_always initial_suspend() const noexcept
+	{
+		return {};
+	}
+	final_awaiter final_suspend() const noexcept
+	{
+		return {};
+	}
+	void unhandled_exception() noexcept
+	{
+		exception = std::current_exception();
+	}
+};
+
+template <typename T> struct promise : promise_base {
+	T value{};
+
+	task<T> get_return_object() noexcept;
+	void return_value(T v)
+	{
+		value = std::move(v);
+	}
+	T result()
+	{
+		if (exception) {
+			std::rethrow_exception(exception);
+		}
+		return std::move(value);
+	}
+};
+
+template <> struct promise<void> : promise_base {
+	task<void> get_return_object() noexcept;
+	void return_void() const noexcept
+	{
+	}
+	void result()
+	{
+		if (exception) {
+			std::rethrow_exception(exception);
+		}
+	}
+};
+
+/**
+ * @brief fire-and-forget coroutine used by the `executor::spawn`
+ */
+struct detached {
+	struct promise_type {
+		detached get_return_object() const noexcept
+		{
+			return {};
+		}
+		std::suspend_never initial_suspend() const noexcept
+		{
+			return {};
+		}
+		std::suspend_never final_suspend() const noexcept
+		{
+			return {};
+		}
+		void return_void() const noexcept
+		{
+		}
+		void unhandled_exception() const noexcept
+		{
+			std::terminate();
+		}
+	};
+};
+} // namespace detail
+
+/**
+ * @brief lazily started coroutine which can be awaited once
+ */
+template <typename T> class task {
+    public:
+	using promise_type = detail::promise<T>;
+	using handle_type = std::coroutine_handle<promise_type>;
+
+	explicit task(handle_type handle) noexcept : handle_(handle)
+	{
+	}
+	task(task &&other) noexcept : handle_(std::exchange(other.handle_, {}))
+	{
+	}
+	task(const task &) = delete;
+	task &operator=(const task &) = delete;
+	~task()
+	{
+		if (handle_) {
+			handle_.destroy();
+		}
+	}
+
+	bool await_ready() const noexcept
+	{
+		return !handle_ || handle_.done();
+	}
+	std::coroutine_handle<>
+	await_suspend(std::coroutine_handle<> awaiter) noexcept
+	{
+		handle_.promise().continuation = awaiter;
+		return handle_;
+	}
+	T await_resume()
+	{
+		return handle_.promise().result();
+	}
+
+    private:
+	handle_type handle_;
+};
+
+namespace detail
+{
+template <typename T> task<T> promise<T>::get_return_object() noexcept
+{
+	return task<T>(std::coroutine_handle<promise<T> >::from_promise(*this));
+}
+
+inline task<void> promise<void>::get_return_object() noexcept
+{
+	return task<void>(
+		std::coroutine_handle<promise<void> >::from_promise(*this));
+}
+} // namespace detail
+
+/**
+ * @brief run the coroutines and resume them when their I/Os complete
+ *
+ * @note
+ * `run` can be called by several threads at the same time. It returns
+ * when every spawned task finishes. The executor must outlive its tasks.
+ */
+class executor {
+    public:
+	/**
+	 * @brief awaitable of a read or a write
+	 */
+	class io_awaiter {
+	    public:
+		io_awaiter(executor &ex, unsigned int opcode, void *buffer,
+			   size_t count, off_t offset) noexcept
+			: ex_(ex), io_(), handle_()
+		{
+			io_.opcode = opcode;
+			io_.buffer = buffer;
+			io_.count = count;
+			io_.offset = offset;
+		}
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+		bool await_suspend(std::coroutine_handle<> handle)
+		{
+			struct flash_device *flash = ex_.device();
+			int ret;
+
+			if (flash->f_op->submit == NULL) {
+				/** the submodule only has blocking calls */
+				io_.ret = io_.opcode == FLASH_IO_WRITE ?
+						  flash->f_op->write(
+							  flash, io_.buffer,
+							  io_.count,
+							  io_.offset) :
+						  flash->f_op->read(
+							  flash, io_.buffer,
+							  io_.count,
+							  io_.offset);
+				return false;
+			}
+
+			handle_ = handle;
+			io_.end_io = &io_awaiter::end_io;
+			io_.io_private = this;
+			ret = flash->f_op->submit(flash, &io_);
+			if (ret) {
+				io_.ret = ret;
+				return false;
+			}
+			return true;
+		}
+		/**
+		 * @return processed size or negative number for fail
+		 */
+		ssize_t await_resume() const noexcept
+		{
+			return io_.ret;
+		}
+
+	    private:
+		static void end_io(struct flash_io *io)
+		{
+			io_awaiter *self =
+				static_cast<io_awaiter *>(io->io_private);
+			self->ex_.post(self->handle_);
+		}
+
+		executor &ex_;
+		struct flash_io io_;
+		std::coroutine_handle<> handle_;
+	};
+
+	/**
+	 * @brief awaitable of the trim (forced garbage collection)
+	 *
+	 * @note
+	 * The trim has no asynchronous form, so it runs on its own thread.
+	 */
+	class trim_awaiter {
+	    public:
+		explicit trim_awaiter(executor &ex) noexcept : ex_(ex), ret_(0)
+		{
+		}
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			std::thread([this, handle]() {
+				struct flash_device *flash = ex_.device();
+				ret_ = flash->f_op->ioctl(flash,
+							  PAGE_FTL_IOCTL_TRIM);
+				ex_.post(handle);
+			}).detach();
+		}
+		int await_resume() const noexcept
+		{
+			return ret_;
+		}
+
+	    private:
+		executor &ex_;
+		int ret_;
+	};
+
+	/**
+	 * @brief awaitable which moves the coroutine to the executor
+	 */
+	struct schedule_awaiter {
+		executor &ex;
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			ex.post(handle);
+		}
+		void await_resume() const noexcept
+		{
+		}
+	};
+
+	explicit executor(struct flash_device *flash) noexcept
+		: flash_(flash), nr_tasks_(0)
+	{
+	}
+	executor(const executor &) = delete;
+	executor &operator=(const executor &) = delete;
+
+	struct flash_device *device() const noexcept
+	{
+		return flash_;
+	}
+
+	io_awaiter read(void *buffer, size_t count, off_t offset) noexcept
+	{
+		return io_awaiter(*this, FLASH_IO_READ, buffer, count, offset);
+	}
+	io_awaiter write(void *buffer, size_t count, off_t offset) noexcept
+	{
+		return io_awaiter(*this, FLASH_IO_WRITE, buffer, count, offset);
+	}
+	trim_awaiter trim() noexcept
+	{
+		return trim_awaiter(*this);
+	}
+	schedule_awaiter schedule() noexcept
+	{
+		return schedule_awaiter{ *this };
+	}
+
+	/**
+	 * @brief queue the coroutine to be resumed by `run`
+	 *
+	 * @param handle coroutine to resume
+	 */
+	void post(std::coroutine_handle<> handle)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		ready_.push_back(handle);
+		cond_.notify_one();
+	}
+
+	/**
+	 * @brief start the task on the executor without awaiting it
+	 *
+	 * @param t task to run; an exception from the task is ignored
+	 */
+	void spawn(task<void> t)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			nr_tasks_++;
+		}
+		start(std::move(t));
+	}
+
+	/**
+	 * @brief resume the ready coroutines until every task finishes
+	 */
+	void run()
+	{
+		while (true) {
+			std::coroutine_handle<> handle;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				cond_.wait(lock, [this]() {
+					return !ready_.empty() ||
+					       nr_tasks_ == 0;
+				});
+				if (ready_.empty()) {
+					return;
+				}
+				handle = ready_.front();
+				ready_.pop_front();
+			}
+			handle.resume();
+		}
+	}
+
+    private:
+	detail::detached start(task<void> t)
+	{
+		co_await schedule();
+		try {
+			co_await t;
+		} catch (...) {
+		}
+		finish();
+	}
+
+	void finish()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (--nr_tasks_ == 0) {
+			cond_.notify_all();
+		}
+	}
+
+	struct flash_device *flash_;
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	std::deque<std::coroutine_handle<> > ready_;
+	size_t nr_tasks_;
+};
+} // namespace ftl
+
+#endif
+
+#endif
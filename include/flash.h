@@ -15,6 +15,7 @@ extern "C" {
 #include <stdlib.h>
 #include <stdint.h>
 #include <pthread.h>
+#include <sys/types.h>
 
 /**
  * @brief flags related on the flash and submodule
@@ -23,8 +24,41 @@ enum {
 	FLASH_DEFAULT_FLAG = 0 /**< flash default flags */,
 };
 
+/**
+ * @brief operation codes of the asynchronous I/O
+ */
+enum {
+	FLASH_IO_READ = 0,
+	FLASH_IO_WRITE,
+};
+
 struct flash_device;
 struct flash_operations;
+struct flash_io;
+
+typedef void (*flash_io_end_fn)(struct flash_io *);
+
+/**
+ * @brief asynchronous I/O descriptor
+ *
+ * @note
+ * The descriptor and the buffer must be valid until the I/O completes.
+ * When `end_io` is NULL, the completed I/O is queued to the device's
+ * completion queue and it is reaped by the `poll`. Otherwise, `end_io` is
+ * called on the internal thread; it must not block for a long time.
+ */
+struct flash_io {
+	unsigned int opcode; /**< FLASH_IO_READ or FLASH_IO_WRITE */
+	void *buffer; /**< pointer of the data buffer */
+	size_t count; /**< length of the buffer (bytes) */
+	off_t offset; /**< offset of the position (bytes) */
+
+	ssize_t ret; /**< processed size or negative number (set on the end) */
+	flash_io_end_fn end_io; /**< completion function (optional) */
+	void *io_private; /**< user's private data */
+
+	struct flash_io *next; /**< used by the completion queue */
+};
 
 /**
  * @brief contain the flash device information
@@ -42,6 +76,12 @@ struct flash_device {
  * `struct flash_device *` means flash control information
  * - count: length of the buffer (bytes)
  * - offset: offset of the write position (bytes, NOT sector(512 bytes))
+ *
+ * `submit` and `poll` are optional; a submodule may leave them NULL.
+ * - submit: queue the I/O and return without waiting for it
+ * - poll: reap at least `min_nr` and at most `max_nr` completed I/Os
+ *   without the `end_io`. It returns earlier when no I/O is in flight.
+ *   (`min_nr` 0 never blocks)
  */
 struct flash_operations {
 	int (*open)(struct flash_device *, const char *name,
@@ -53,6 +93,10 @@ struct flash_operations {
 	int (*ioctl)(struct flash_device *, unsigned int request,
 		     ...); /**< for other instruction sets (barely use) */
 	int (*close)(struct flash_device *); /** close the flash device */
+	int (*submit)(struct flash_device *,
+		      struct flash_io *); /**< submit the asynchronous I/O */
+	int (*poll)(struct flash_device *, struct flash_io **ios, size_t min_nr,
+		    size_t max_nr); /**< reap the completed I/Os */
 };
 
 int flash_module_init(struct flash_device **, uint64_t flags);
@@ -0,0 +1,67 @@
+/**
+ * @file hbitmap.h
+ * @brief hierarchical bitmap which has the summary levels
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ *
+ * @note
+ * Each bit of the upper level summarizes a word of the lower level. The
+ * `any` levels tell whether the word has a one bit and the `full` levels
+ * tell whether every bit of the word is one. So, the search visits a word
+ * per level, O(log64 n), instead of the whole bitmap.
+ * `hbitmap` is not thread-safe.
+ */
+#ifndef HBITMAP_H
+#define HBITMAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "bits.h"
+
+#define HBITMAP_MAX_LEVELS (11) /**< 64^11 covers the 64-bit index */
+
+/**
+ * @brief hierarchical bitmap
+ *
+ * @note
+ * The level 0 is the bitmap itself, so `any[0]` and `full[0]` are the same
+ * array. The bits after the level's size are always zero.
+ */
+struct hbitmap {
+	uint64_t nr_bits;
+	int nr_levels; /**< the number of the levels including the level 0 */
+	uint64_t level_bits[HBITMAP_MAX_LEVELS]; /**< size of each level */
+	uint64_t *any[HBITMAP_MAX_LEVELS]; /**< word has a one bit */
+	uint64_t *full[HBITMAP_MAX_LEVELS]; /**< word's bits are all one */
+};
+
+struct hbitmap *hbitmap_init(uint64_t nr_bits);
+void hbitmap_set_bit(struct hbitmap *hbitmap, uint64_t index);
+void hbitmap_reset_bit(struct hbitmap *hbitmap, uint64_t index);
+uint64_t hbitmap_find_first_one_bit(struct hbitmap *hbitmap, uint64_t idx);
+uint64_t hbitmap_find_first_zero_bit(struct hbitmap *hbitmap, uint64_t idx);
+void hbitmap_free(struct hbitmap *hbitmap);
+
+/**
+ * @brief get the value at the index position bit
+ *
+ * @param hbitmap pointer of the hierarchical bitmap
+ * @param index get position
+ *
+ * @return bit status at the index position
+ */
+static inline int hbitmap_get_bit(struct hbitmap *hbitmap, uint64_t index)
+{
+	return get_bit(hbitmap->any[0], index);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,7 +5,9 @@
  * @version 0.1
  * @date 2021-09-30
  * @note
- * This is not thread-safe.
+ * `lru_cache` is not thread-safe. Only the deferred write-back runs on the
+ * cache's flusher thread (see `lru_set_flusher()`). `sharded_cache` is
+ * the thread-safe variant (see cache.h).
  */
 #ifndef LRU_H
 #define LRU_H
@@ -16,14 +18,24 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 #include "log.h"
 
 /**
  * @brief deallocate the value for eviction function type. 0 means successfully evicted
+ *
+ * @note
+ * Returning `LRU_DEALLOC_DEFER` hands the entry to the flusher thread,
+ * which calls the flush function for it (e.g., write-back of a dirty entry).
  */
 typedef int (*lru_dealloc_fn)(const uint64_t, uintptr_t);
 
+#define LRU_DEALLOC_DEFER (1) /**< release the entry on the flusher thread */
+#define LRU_DEFAULT_EVICT_SIZE (1) /**< entries evicted when the cache is full */
+
+struct lru_flusher;
+
 /**
  * @brief doubly-linked list data structure
  */
@@ -34,21 +46,44 @@ struct lru_node {
 	struct lru_node *prev;
 };
 
+#define LRU_INDEX_EMPTY ((uint32_t)-1) /**< unused slot of the index */
+
 /**
  * @brief main LRU cache data structure
+ *
+ * @note
+ * Nodes come from the arena allocated by `lru_init()`, so the insertion
+ * doesn't call the allocator. The index is an open-addressing (linear
+ * probing) table of the arena positions, and has at least twice the slots
+ * of the capacity.
  */
 struct lru_cache {
 	size_t capacity; /**< total number of the lru_node */
 	size_t size; /**< current number of the lru_node */
 	struct lru_node *head;
 	lru_dealloc_fn deallocate;
+	struct lru_node *nodes; /**< node arena (`capacity` nodes) */
+	struct lru_node *free_nodes; /**< unused nodes linked by `next` */
+	uint32_t *index; /**< arena position of the node for each slot */
+	size_t index_mask; /**< number of the index slots - 1 */
+	size_t evict_size; /**< entries evicted from the tail at once */
+	struct lru_flusher *flusher; /**< NULL without the deferred release */
 	struct lru_node nil; /**< don't access this directly */
 };
 
 struct lru_cache *lru_init(const size_t capacity, lru_dealloc_fn deallocate);
 int lru_put(struct lru_cache *cache, const uint64_t key, uintptr_t value);
 uintptr_t lru_get(struct lru_cache *cache, const uint64_t key);
+uintptr_t lru_peek(struct lru_cache *cache, const uint64_t key);
+int lru_delete(struct lru_cache *cache, const uint64_t key);
+int lru_remove(struct lru_cache *cache, const uint64_t key, uintptr_t *value);
+int lru_pop(struct lru_cache *cache, uint64_t *key, uintptr_t *value);
+int lru_evict(struct lru_cache *cache, const size_t nr_entries);
 int lru_free(struct lru_cache *cache);
+int lru_set_evict_size(struct lru_cache *cache, const size_t nr_entries);
+int lru_set_evict_ratio(struct lru_cache *cache, const unsigned int percent);
+int lru_set_flusher(struct lru_cache *cache, lru_dealloc_fn flush);
+int lru_flush(struct lru_cache *cache);
 
 /**
  * @brief get evict size of the LRU cache
@@ -58,12 +93,13 @@ int lru_free(struct lru_cache *cache);
  * @return number of the eviction entries
  *
  * @note
- * Default LRU cache's eviction size is 30% of its capacity
+ * Default LRU cache's eviction size is `LRU_DEFAULT_EVICT_SIZE`; it is
+ * changed by `lru_set_evict_size()` or `lru_set_evict_ratio()`.
  */
 static inline size_t lru_get_evict_size(struct lru_cache *cache)
 {
-	pr_debug("evict size ==> %zu\n", (size_t)(cache->capacity));
-	return cache->capacity;
+	pr_debug("evict size ==> %zu\n", cache->evict_size);
+	return cache->evict_size;
 }
 
 #ifdef __cplusplus
@@ -19,9 +19,22 @@
 
 #include "flash.h"
 #include "device.h"
+#include "cache.h"
+#include "hbitmap.h"
 
-// #define PAGE_FTL_USE_CACHE
-#define PAGE_FTL_CACHE_SIZE ((1 << 10))
+#define PAGE_FTL_USE_CACHE
+#ifndef PAGE_FTL_CACHE_SIZE
+#define PAGE_FTL_CACHE_SIZE                                                    \
+	((1 << 10)) /**< pages kept in the read cache */
+#endif
+#ifndef PAGE_FTL_CACHE_POLICY
+#define PAGE_FTL_CACHE_POLICY                                                  \
+	(CACHE_POLICY_LRU) /**< default eviction policy of the read cache */
+#endif
+#ifndef PAGE_FTL_CACHE_NR_SHARDS
+#define PAGE_FTL_CACHE_NR_SHARDS                                               \
+	(16) /**< independently locked parts of the read cache */
+#endif
 #define PAGE_FTL_GC_RATIO                                                      \
 	((double)10 /                                                          \
 	 100) /**< maximum the number of segments garbage collected */
@@ -30,43 +43,358 @@
 	((double)20 /                                                          \
 	 100) /**< gc triggered when number of the free pages under threshold */
 
+#ifndef PAGE_FTL_NR_LPN_LOCKS
+#define PAGE_FTL_NR_LPN_LOCKS                                                  \
+	(1024) /**< number of the lock stripes over the LPN space */
+#endif
+
+#define PAGE_FTL_SUMMARY_MAGIC                                                 \
+	((uint32_t)0x53554d4d) /**< "SUMM"; marks a valid summary page */
+
+#define PAGE_FTL_JOURNAL_MAGIC                                                 \
+	((uint32_t)0x4a524e4c) /**< "JRNL"; marks a valid journal page */
+#define PAGE_FTL_JOURNAL_NR_SEGMENTS                                           \
+	(2) /**< first segments reserved for the journal (ping-pong) */
+#ifndef PAGE_FTL_JOURNAL_COMMIT_INTERVAL
+#define PAGE_FTL_JOURNAL_COMMIT_INTERVAL                                       \
+	(5) /**< group commit interval (ms) */
+#endif
+#ifndef PAGE_FTL_JOURNAL_COMMIT_SIZE
+#define PAGE_FTL_JOURNAL_COMMIT_SIZE                                           \
+	(256) /**< commit early when this many deltas are pending */
+#endif
+
+#ifndef PAGE_FTL_WAIT_SPIN_COUNT
+#define PAGE_FTL_WAIT_SPIN_COUNT                                               \
+	(256) /**< polls of an asynchronous request before sleeping */
+#endif
+
+#ifndef PAGE_FTL_MQ_QUEUE_DEPTH
+#define PAGE_FTL_MQ_QUEUE_DEPTH                                                \
+	(128) /**< number of the slots in each submission queue */
+#endif
+
+#ifndef PAGE_FTL_RA_NR_STREAMS
+#define PAGE_FTL_RA_NR_STREAMS                                                 \
+	(8) /**< sequential streams tracked by the read-ahead */
+#endif
+
+#ifndef PAGE_FTL_RA_NR_SLOTS
+#define PAGE_FTL_RA_NR_SLOTS                                                   \
+	(512) /**< pages kept in the read-ahead cache */
+#endif
+
+#ifndef PAGE_FTL_RA_MIN_WINDOW
+#define PAGE_FTL_RA_MIN_WINDOW                                                 \
+	(4) /**< pages prefetched when a stream is detected */
+#endif
+
+#ifndef PAGE_FTL_RA_MAX_WINDOW
+#define PAGE_FTL_RA_MAX_WINDOW                                                 \
+	(64) /**< upper bound of the read-ahead window (pages) */
+#endif
+
+#ifndef PAGE_FTL_INIT_MAX_THREADS
+#define PAGE_FTL_INIT_MAX_THREADS                                              \
+	(16) /**< upper bound of the threads which initialize the tables */
+#endif
+
+#ifndef PAGE_FTL_INIT_MIN_CHUNK
+#define PAGE_FTL_INIT_MIN_CHUNK                                                \
+	(1 << 18) /**< the least map entries (or pages) worth a thread */
+#endif
+
+#define PAGE_FTL_USE_BITS_ALIGN (64) /**< alignment of the use bitmap slab */
+
 enum {
 	PAGE_FTL_IOCTL_TRIM = 0,
+	PAGE_FTL_IOCTL_FLUSH, /**< make all previous writes' mapping durable */
+};
+
+enum {
+	PAGE_FTL_JOURNAL_SNAPSHOT = (1 << 0), /**< page is a part of snapshot */
+	PAGE_FTL_JOURNAL_SNAPSHOT_END = (1 << 1), /**< last snapshot page */
 };
 
 /**
  * @brief segment information structure
  * @note
- * Segment number is same as block number
+ * Segment number is same as block number.
+ * `mutex` protects the `lpn_list` and the segment's range of the p2l table.
+ * The counters and the bitmap which are swept over every segment live in
+ * the parallel arrays of the `page_ftl` (`nr_free`, `nr_valid` and
+ * `use_bits`) instead.
  */
 struct page_ftl_segment {
-	gint nr_free_pages;
-	gint nr_valid_pages;
-	gint is_gc;
+	pthread_mutex_t mutex;
+
+	gint nr_written_pages; /**< data pages which are taken and written */
+	gint is_closed; /**< summary block is written (or given up) */
+	gint has_summary; /**< valid summary block exists on the device */
+	gint erase_epoch; /**< odd while the segment is being erased */
 
-	uint64_t *use_bits; /**< contain the use page information */
 	GList *lpn_list; /**< lba_list which contains the valid data */
 };
 
+/**
+ * @brief header of each summary page
+ *
+ * @note
+ * The summary block occupies the last pages of a segment and contains the
+ * physical-to-logical table of the segment's data pages. Each page of the
+ * block starts with this header and the remaining bytes are `uint32_t` LPNs.
+ */
+struct page_ftl_summary_header {
+	uint32_t magic; /**< PAGE_FTL_SUMMARY_MAGIC */
+	uint32_t segnum; /**< segment which owns this summary */
+	uint64_t seqnum; /**< larger value means the newer summary */
+	uint32_t index; /**< page index in the summary block */
+	uint32_t nr_entries; /**< number of LPNs in this page */
+};
+
+/**
+ * @brief header of each journal page
+ *
+ * @note
+ * The remaining bytes of the page are `struct page_ftl_journal_entry`.
+ * A generation starts with the snapshot of the segments which have no
+ * summary, so the older generation can be discarded.
+ */
+struct page_ftl_journal_header {
+	uint32_t magic; /**< PAGE_FTL_JOURNAL_MAGIC */
+	uint32_t flags; /**< PAGE_FTL_JOURNAL_SNAPSHOT* */
+	uint64_t generation; /**< incremented when the segment changes */
+	uint64_t seqnum; /**< shared with the summary's sequence number */
+	uint32_t index; /**< page index in the journal segment */
+	uint32_t nr_entries; /**< number of entries in this page */
+};
+
+/**
+ * @brief mapping delta which is recorded in the journal
+ */
+struct page_ftl_journal_entry {
+	uint32_t lpn;
+	uint32_t ppn;
+};
+
+/**
+ * @brief journal page loaded during the recovery
+ */
+struct page_ftl_journal_page {
+	uint64_t seqnum;
+	uint32_t nr_entries;
+	struct page_ftl_journal_entry *entries;
+};
+
+/**
+ * @brief append-only mapping-delta journal information
+ */
+struct page_ftl_journal {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond; /**< wake up the commit thread */
+	pthread_cond_t commit_cond; /**< wake up the flush waiters */
+	pthread_t thread;
+
+	struct page_ftl_journal_entry *pending; /**< filled by the writers */
+	struct page_ftl_journal_entry *spare; /**< used by the commit thread */
+	size_t nr_pending;
+	size_t pending_size; /**< capacity of the pending buffer */
+	size_t spare_size; /**< capacity of the spare buffer */
+
+	uint64_t nr_appended; /**< total number of appended deltas */
+	uint64_t nr_committed; /**< appended deltas which are durable */
+	int error; /**< sticky commit or append error; nothing is committed */
+
+	size_t segnum; /**< current journal segment */
+	size_t page; /**< next page index in the current segment */
+	uint64_t generation;
+
+	int is_flush;
+	int is_exit;
+	int is_running;
+};
+
+struct page_ftl_mq_cmd;
+typedef void (*page_ftl_mq_end_fn)(struct page_ftl_mq_cmd *);
+
+/**
+ * @brief command which carries a request to the multi-queue workers
+ *
+ * @note
+ * `end_cmd` runs on the worker thread after `ret` is set. The request
+ * belongs to the FTL once it is submitted; it is already released when
+ * `ret` is positive.
+ */
+struct page_ftl_mq_cmd {
+	struct device_request *request;
+	ssize_t ret; /**< return value of the request */
+	page_ftl_mq_end_fn end_cmd; /**< completion function */
+	void *cmd_private; /**< submitter's private data */
+};
+
+/**
+ * @brief per-CPU submission queue (ring buffer)
+ */
+struct page_ftl_mq_queue {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond; /**< wake up the submitters waiting for a slot */
+	struct page_ftl_mq_cmd *ring[PAGE_FTL_MQ_QUEUE_DEPTH];
+	size_t head; /**< index of the oldest command */
+	size_t nr_cmds;
+};
+
+/**
+ * @brief multi-queue submission layer information
+ */
+struct page_ftl_mq {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond; /**< wake up the idle workers */
+
+	struct page_ftl_mq_queue *queues;
+	size_t nr_queues; /**< same as the number of online CPUs */
+	pthread_t *workers;
+	size_t nr_workers; /**< at least one worker per bus */
+
+	gint nr_pending; /**< commands in the queues */
+	gint nr_steals; /**< commands taken from the other worker's queue */
+	int is_exit;
+
+	pthread_mutex_t cq_mutex; /**< protects the completion queue */
+	pthread_cond_t cq_cond; /**< wake up the pollers */
+	struct flash_io *cq_head; /**< oldest completed I/O */
+	struct flash_io *cq_tail;
+	size_t nr_cq_ready; /**< completed I/Os which are not reaped */
+	size_t nr_cq_inflight; /**< submitted I/Os which go to the queue */
+};
+
+/**
+ * @brief state of the read-ahead cache slot
+ */
+enum {
+	PAGE_FTL_RA_EMPTY = 0,
+	PAGE_FTL_RA_INFLIGHT, /**< prefetch is submitted */
+	PAGE_FTL_RA_READY, /**< buffer contains the page */
+};
+
+/**
+ * @brief read-ahead cache slot
+ *
+ * @note
+ * The page is valid only while the LPN is still mapped to `ppn` and the
+ * segment's erase epoch is not changed.
+ */
+struct page_ftl_ra_slot {
+	size_t lpn;
+	uint32_t ppn; /**< physical page which the buffer is read from */
+	gint epoch; /**< erase epoch of the ppn's segment */
+	int state; /**< PAGE_FTL_RA_* */
+	uint64_t ticket; /**< distinguish the prefetches of a slot */
+	void *buffer;
+};
+
+/**
+ * @brief sequential read stream detected by the last read offset
+ */
+struct page_ftl_ra_stream {
+	size_t next_sector; /**< expected offset of the next read */
+	size_t ra_lpn; /**< first LPN which is not prefetched yet */
+	size_t window; /**< pages to prefetch ahead (0 for random) */
+	uint64_t last_used;
+};
+
+/**
+ * @brief read-ahead information
+ */
+struct page_ftl_ra {
+	pthread_mutex_t mutex; /**< protects the streams and slots */
+	pthread_cond_t cond; /**< wake up the readers waiting for a prefetch */
+	struct page_ftl_ra_stream streams[PAGE_FTL_RA_NR_STREAMS];
+	struct page_ftl_ra_slot *slots;
+	uint64_t clock;
+	uint64_t ticket;
+	gint nr_hits;
+	gint nr_issued;
+};
+
+/**
+ * @brief read cache of the flash pages (keyed by the LPN)
+ */
+struct page_ftl_cache {
+	struct sharded_cache *pages; /**< LPN to the `page_ftl_cache_entry` */
+	size_t nr_pages; /**< capacity decided at open time */
+	gint nr_hits;
+	gint nr_misses;
+};
+
+/**
+ * @brief stages of the open which are reported to the open hook
+ */
+enum {
+	PAGE_FTL_OPEN_DEVICE = 0, /**< device open */
+	PAGE_FTL_OPEN_MAP, /**< mapping table initialization */
+	PAGE_FTL_OPEN_SEGMENT, /**< segment metadata initialization */
+	PAGE_FTL_OPEN_RECOVERY, /**< journal and summary recovery */
+	PAGE_FTL_OPEN_TOTAL, /**< whole open */
+	NR_PAGE_FTL_OPEN_STAGE,
+};
+
+struct page_ftl;
+
+/**
+ * @brief instrumentation hook which receives the time of each open stage
+ *
+ * @param pgftl pointer of the page FTL structure
+ * @param stage open stage (e.g., `PAGE_FTL_OPEN_MAP`)
+ * @param elapsed_ns elapsed time of the stage
+ * @param data data which is given with the hook
+ */
+typedef void (*page_ftl_open_hook_fn)(struct page_ftl *pgftl, int stage,
+				      uint64_t elapsed_ns, void *data);
+
 /**
  * @brief contain the page flash translation layer information
  */
 struct page_ftl {
 	uint32_t *trans_map; /**< page-level mapping table */
+	uint32_t *p2l_map; /**< physical-to-logical table (for summary) */
 	uint64_t alloc_segnum; /**< last allocated segment number */
+	struct hbitmap *free_segs; /**< segments which have the free pages */
 	struct page_ftl_segment *segments;
+	/**
+	 * Segment metadata in the parallel arrays indexed by the segnum.
+	 * `use_bits` and `nr_free` are protected by the `alloc_mutex`.
+	 * `free_segs` has the bit of the segment whose `nr_free` isn't 0
+	 * (see `page_ftl_update_free_segment()`).
+	 */
+	gint *nr_free; /**< free data pages of each segment */
+	gint *nr_valid; /**< valid pages of each segment */
+	uint64_t *use_bits; /**< used pages of every segment in a slab */
+	size_t nr_use_words; /**< words of a segment's use bitmap */
+	uint64_t seqnum; /**< next summary and journal sequence number */
 	struct device *dev;
-	pthread_mutex_t mutex;
-	pthread_mutex_t gc_mutex;
+	pthread_mutex_t mutex; /**< protects the gc_seg_bits' setting */
+	pthread_mutex_t gc_mutex; /**< serializes the garbage collections */
+	pthread_mutex_t alloc_mutex; /**< protects the page allocation */
+	pthread_mutex_t *lpn_locks; /**< serialize the updates of an LPN */
 	pthread_rwlock_t *bus_rwlock;
-#ifdef PAGE_FTL_USE_GLOBAL_RWLOCK
-	pthread_rwlock_t rwlock;
-#endif
 	pthread_t gc_thread;
 	int o_flags;
+	int cache_policy; /**< policy of the read cache (see cache.h) */
+
+	struct page_ftl_journal *journal;
+	struct page_ftl_mq *mq;
+	struct page_ftl_ra *ra; /**< NULL when the read-ahead is disabled */
+	struct page_ftl_cache *cache; /**< NULL when the cache is disabled */
+
+	page_ftl_open_hook_fn open_hook; /**< NULL when nobody listens */
+	void *open_hook_data;
 
-	GList *gc_list; /**< garbage collection target list */
-	uint64_t *gc_seg_bits; /**< to find segnum is in gc list or not */
+	/**
+	 * segnum is the gc target or being collected. The bit is set with the
+	 * `mutex` and cleared by the gc after the erase, so the victim scan
+	 * reads it with the `mutex` and the `gc_mutex`.
+	 */
+	uint64_t *gc_seg_bits;
 };
 
 /* page-interface.c */
@@ -74,23 +402,106 @@ int page_ftl_open(struct page_ftl *, const char *name, int flags);
 int page_ftl_close(struct page_ftl *);
 
 ssize_t page_ftl_submit_request(struct page_ftl *, struct device_request *);
+ssize_t page_ftl_submit_requests(struct page_ftl *, struct device_request **,
+				 size_t nr_requests);
+ssize_t page_ftl_process_request(struct page_ftl *, struct device_request *);
 ssize_t page_ftl_write(struct page_ftl *, struct device_request *);
 ssize_t page_ftl_read(struct page_ftl *, struct device_request *);
 
+/* page-write.c */
+ssize_t page_ftl_write_locked(struct page_ftl *, struct device_request *);
+
 int page_ftl_module_init(struct flash_device *, uint64_t flags);
 int page_ftl_module_exit(struct flash_device *);
 
+/* page-read.c */
+ssize_t page_ftl_read_no_fill(struct page_ftl *, struct device_request *);
+ssize_t page_ftl_read_ppn(struct page_ftl *, uint32_t ppn, void *buffer);
+
 /* page-map.c */
 struct device_address page_ftl_get_free_page(struct page_ftl *);
-int page_ftl_update_map(struct page_ftl *, size_t sector, uint32_t ppn);
+void page_ftl_update_free_segment(struct page_ftl *, size_t segnum);
+int page_ftl_update_map(struct page_ftl *, size_t sector, uint32_t old_ppn,
+			uint32_t ppn);
 
 /* page-core.c */
 int page_ftl_segment_data_init(struct page_ftl *, struct page_ftl_segment *);
+int page_ftl_set_open_hook(struct page_ftl *, page_ftl_open_hook_fn hook,
+			   void *data);
+const char *page_ftl_get_open_stage_name(int stage);
 
 /* page-gc.c */
 ssize_t page_ftl_do_gc(struct page_ftl *);
 ssize_t page_ftl_gc_from_list(struct page_ftl *, struct device_request *,
 			      double gc_ratio);
+int page_ftl_segment_erase(struct page_ftl *, struct device_address);
+
+/* page-summary.c */
+int page_ftl_summary_write(struct page_ftl *, size_t segnum);
+int page_ftl_summary_recovery(struct page_ftl *);
+
+/* page-journal.c */
+int page_ftl_journal_init(struct page_ftl *);
+int page_ftl_journal_start(struct page_ftl *);
+int page_ftl_journal_append(struct page_ftl *, size_t lpn, uint32_t ppn);
+int page_ftl_journal_flush(struct page_ftl *);
+int page_ftl_journal_load(struct page_ftl *, struct page_ftl_journal_page **,
+			  size_t *nr_pages);
+void page_ftl_journal_free_pages(struct page_ftl_journal_page *,
+				 size_t nr_pages);
+void page_ftl_journal_exit(struct page_ftl *);
+
+/* page-mq.c */
+int page_ftl_mq_init(struct page_ftl *);
+int page_ftl_mq_submit(struct page_ftl *, struct page_ftl_mq_cmd *);
+void page_ftl_mq_exit(struct page_ftl *);
+void page_ftl_mq_start_io(struct page_ftl *, struct flash_io *);
+void page_ftl_mq_end_io(struct page_ftl *, struct flash_io *);
+int page_ftl_mq_poll(struct page_ftl *, struct flash_io **ios, size_t min_nr,
+		     size_t max_nr);
+
+/* page-readahead.c */
+int page_ftl_readahead_init(struct page_ftl *);
+int page_ftl_readahead_copy(struct page_ftl *, size_t sector, void *buffer,
+			    size_t len);
+void page_ftl_readahead(struct page_ftl *, size_t sector, size_t count);
+void page_ftl_readahead_exit(struct page_ftl *);
+
+/* page-cache.c */
+int page_ftl_set_cache_policy(struct page_ftl *, int policy);
+int page_ftl_cache_init(struct page_ftl *);
+int page_ftl_cache_copy(struct page_ftl *, size_t lpn, uint32_t ppn,
+			gint epoch, void *buffer, size_t offset, size_t len);
+void page_ftl_cache_fill(struct page_ftl *, size_t lpn, uint32_t ppn,
+			 gint epoch, const void *page);
+void page_ftl_cache_update(struct page_ftl *, size_t lpn, uint32_t ppn,
+			   gint epoch, const void *page);
+void page_ftl_cache_invalidate(struct page_ftl *, size_t lpn);
+void page_ftl_cache_exit(struct page_ftl *);
+
+/**
+ * @brief check the segment is reserved for the journal
+ *
+ * @param segnum segment number to check
+ *
+ * @return 1 for the journal segment, 0 otherwise
+ */
+static inline int page_ftl_journal_is_reserved(size_t segnum)
+{
+	return segnum < PAGE_FTL_JOURNAL_NR_SEGMENTS;
+}
+
+/**
+ * @brief get the next sequence number shared by the summary and journal
+ *
+ * @param pgftl pointer of the page-ftl structure
+ *
+ * @return newly issued sequence number
+ */
+static inline uint64_t page_ftl_get_next_seqnum(struct page_ftl *pgftl)
+{
+	return __atomic_fetch_add(&pgftl->seqnum, 1, __ATOMIC_SEQ_CST);
+}
 
 static inline size_t page_ftl_get_map_size(struct page_ftl *pgftl)
 {
@@ -103,12 +514,97 @@ static inline size_t page_ftl_get_lpn(struct page_ftl *pgftl, size_t sector)
 	return sector / device_get_page_size(pgftl->dev);
 }
 
+/**
+ * @brief load the mapping entry without any lock
+ *
+ * @param pgftl pointer of the page-ftl structure
+ * @param lpn logical page number
+ *
+ * @return physical page number (PADDR_EMPTY for the unmapped LPN)
+ *
+ * @note
+ * The returned page may be erased by the gc after this call. The reader must
+ * validate it with the segment's `erase_epoch`.
+ */
+static inline uint32_t page_ftl_map_load(struct page_ftl *pgftl, size_t lpn)
+{
+	return __atomic_load_n(&pgftl->trans_map[lpn], __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief replace the mapping entry only if it is not changed
+ *
+ * @param pgftl pointer of the page-ftl structure
+ * @param lpn logical page number
+ * @param old_ppn expected current physical page number
+ * @param ppn new physical page number
+ *
+ * @return 1 for success, 0 when the entry is not `old_ppn`
+ */
+static inline int page_ftl_map_cas(struct page_ftl *pgftl, size_t lpn,
+				   uint32_t old_ppn, uint32_t ppn)
+{
+	return __atomic_compare_exchange_n(&pgftl->trans_map[lpn], &old_ppn,
+					   ppn, false, __ATOMIC_ACQ_REL,
+					   __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief get the lock stripe which covers the LPN
+ *
+ * @param pgftl pointer of the page-ftl structure
+ * @param lpn logical page number
+ *
+ * @return pointer of the stripe's mutex
+ *
+ * @note
+ * Lock order: LPN stripe -> allocator -> segment -> gc target -> journal.
+ * The read cache's shard locks are leaves.
+ */
+static inline pthread_mutex_t *page_ftl_get_lpn_lock(struct page_ftl *pgftl,
+						     size_t lpn)
+{
+	return &pgftl->lpn_locks[lpn % PAGE_FTL_NR_LPN_LOCKS];
+}
+
 static inline size_t page_ftl_get_page_offset(struct page_ftl *pgftl,
 					      size_t sector)
 {
 	return sector % device_get_page_size(pgftl->dev);
 }
 
+/**
+ * @brief get the number of pages reserved for the summary block
+ *
+ * @param pgftl pointer of the page-ftl structure
+ *
+ * @return the number of summary pages at the end of each segment
+ */
+static inline size_t page_ftl_get_summary_pages(struct page_ftl *pgftl)
+{
+	size_t page_size = device_get_page_size(pgftl->dev);
+	size_t entries_per_page;
+
+	entries_per_page = (page_size - sizeof(struct page_ftl_summary_header)) /
+			   sizeof(uint32_t);
+	return (device_get_pages_per_segment(pgftl->dev) + entries_per_page -
+		1) /
+	       entries_per_page;
+}
+
+/**
+ * @brief get the number of pages which can contain the user data
+ *
+ * @param pgftl pointer of the page-ftl structure
+ *
+ * @return the number of data pages in a segment
+ */
+static inline size_t page_ftl_get_data_pages(struct page_ftl *pgftl)
+{
+	return device_get_pages_per_segment(pgftl->dev) -
+	       page_ftl_get_summary_pages(pgftl);
+}
+
 static inline size_t page_ftl_get_segment_number(struct page_ftl *pgftl,
 						 uintptr_t segment)
 {
@@ -116,19 +612,30 @@ static inline size_t page_ftl_get_segment_number(struct page_ftl *pgftl,
 	       sizeof(struct page_ftl_segment);
 }
 
+/**
+ * @brief get the use bitmap of the segment in the slab
+ *
+ * @param pgftl pointer of the page-ftl structure
+ * @param segnum segment number
+ *
+ * @return use bitmap of the segment
+ */
+static inline uint64_t *page_ftl_get_use_bits(struct page_ftl *pgftl,
+					      size_t segnum)
+{
+	return &pgftl->use_bits[segnum * pgftl->nr_use_words];
+}
+
 static inline size_t page_ftl_get_free_pages(struct page_ftl *pgftl)
 {
 	size_t free_pages;
 	size_t nr_segments, segnum;
-	struct page_ftl_segment *segment;
 
 	nr_segments = device_get_nr_segments(pgftl->dev);
 
 	free_pages = 0;
 	for (segnum = 0; segnum < nr_segments; segnum++) {
-		segment = &pgftl->segments[segnum];
-		assert(NULL != segment);
-		free_pages += (size_t)g_atomic_int_get(&segment->nr_free_pages);
+		free_pages += (size_t)g_atomic_int_get(&pgftl->nr_free[segnum]);
 	}
 	return free_pages;
 }
@@ -15,13 +15,28 @@
 
 #include "device.h"
 
+#ifndef RAMDISK_DISCARD_ON_ERASE
+/**
+ * @brief return the erased segment's memory to the OS
+ *
+ * @note
+ * It makes the RSS track the live data, but the next write of the segment
+ * pays for the page faults. So, it is disabled by default.
+ */
+#define RAMDISK_DISCARD_ON_ERASE (0)
+#endif
+
 /**
  * @brief structure for manage the ramdisk
+ *
+ * @note
+ * The page whose `is_used` bit is zero is read as zero without touching the
+ * `buffer`, so the erase only clears the bits.
  */
 struct ramdisk {
 	size_t size;
-	char *buffer;
-	uint64_t *is_used;
+	char *buffer; /**< reserved mapping; faulted in by the first write */
+	uint64_t *is_used; /**< written pages (atomic operations) */
 	int o_flags;
 };
 
@@ -0,0 +1,214 @@
+#include "argmin.h"
+#include "unity.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/**
+ * @brief find the smallest candidate one by one
+ */
+static size_t argmin_test_reference(const int32_t *values, size_t nr_values,
+				    const uint64_t *include,
+				    const uint64_t *exclude)
+{
+	size_t idx = ARGMIN_NOT_FOUND;
+	for (size_t i = 0; i < nr_values; i++) {
+		if ((include && !get_bit((uint64_t *)include, i)) ||
+		    (exclude && get_bit((uint64_t *)exclude, i))) {
+			continue;
+		}
+		if (idx == ARGMIN_NOT_FOUND || values[i] < values[idx]) {
+			idx = i;
+		}
+	}
+	return idx;
+}
+
+static const char *names[] = { "generic", "avx2", "avx512" };
+
+static argmin_block_fn argmin_test_get_block(int variant)
+{
+	switch (variant) {
+#if BITS_USE_SIMD
+	case 1:
+		return __builtin_cpu_supports("avx2") ? argmin_block_avx2 :
+							NULL;
+	case 2:
+		return __builtin_cpu_supports("avx512f") ? argmin_block_avx512 :
+							   NULL;
+#endif
+	case 0:
+		return argmin_block_generic;
+	default:
+		return NULL;
+	}
+}
+
+void test_argmin(void)
+{
+	const int32_t values[] = { 5, 3, 7, 3, INT32_MAX, 1 };
+	uint64_t include = 0x1f, exclude = 0x2;
+
+	TEST_ASSERT_EQUAL_UINT64(ARGMIN_NOT_FOUND,
+				 argmin_masked(values, 0, NULL, NULL));
+	TEST_ASSERT_EQUAL_UINT64(5, argmin_masked(values, 6, NULL, NULL));
+	/** the first one wins the tie */
+	TEST_ASSERT_EQUAL_UINT64(1, argmin_masked(values, 6, &include, NULL));
+	TEST_ASSERT_EQUAL_UINT64(3,
+				 argmin_masked(values, 6, &include, &exclude));
+	include = 0x10;
+	TEST_ASSERT_EQUAL_UINT64(4, argmin_masked(values, 6, &include, NULL));
+	include = 0;
+	TEST_ASSERT_EQUAL_UINT64(ARGMIN_NOT_FOUND,
+				 argmin_masked(values, 6, &include, NULL));
+}
+
+/**
+ * @brief compare each variant with the reference
+ */
+void test_argmin_random(void)
+{
+	const size_t sizes[] = { 1, 63, 64, 65, 1000, 4096 + 17 };
+	unsigned int seed = 1;
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(size_t); i++) {
+		size_t nr_values = sizes[i];
+		int32_t *values;
+		uint64_t *include, *exclude;
+
+		values = (int32_t *)malloc(nr_values * sizeof(int32_t));
+		include = (uint64_t *)calloc(1,
+					     BITS_TO_UINT64_ALIGN(nr_values));
+		exclude = (uint64_t *)calloc(1,
+					     BITS_TO_UINT64_ALIGN(nr_values));
+		for (int round = 0; round < 16; round++) {
+			/** the small range makes the ties */
+			int32_t range = round % 2 ? 8 : INT32_MAX;
+			int density = round * 6 + 1;
+
+			for (size_t v = 0; v < nr_values; v++) {
+				values[v] = (int32_t)(rand_r(&seed) % range);
+				if ((int)(rand_r(&seed) % 100) < density) {
+					set_bit(include, v);
+				} else {
+					reset_bit(include, v);
+				}
+				if (rand_r(&seed) % 16 == 0) {
+					set_bit(exclude, v);
+				} else {
+					reset_bit(exclude, v);
+				}
+			}
+			for (int variant = 0; variant < 3; variant++) {
+				argmin_block_fn block =
+					argmin_test_get_block(variant);
+				if (block == NULL) {
+					continue;
+				}
+				TEST_ASSERT_EQUAL_UINT64(
+					argmin_test_reference(values, nr_values,
+							      include, exclude),
+					argmin_masked_with(values, nr_values,
+							   include, exclude,
+							   block));
+				TEST_ASSERT_EQUAL_UINT64(
+					argmin_test_reference(values, nr_values,
+							      NULL, NULL),
+					argmin_masked_with(values, nr_values,
+							   NULL, NULL, block));
+			}
+		}
+		free(exclude);
+		free(include);
+		free(values);
+	}
+}
+
+static double argmin_test_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief victim search over a million segments
+ *
+ * @note
+ * `bitwise` visits each segment with its mask bits as the scan over the
+ * segment structures does. Half of the segments are the candidates.
+ */
+void test_argmin_benchmark(void)
+{
+	const size_t nr_segments = 1 << 20, nr_scans = 64;
+	int32_t *values;
+	uint64_t *include, *exclude;
+	unsigned int seed = 1;
+	size_t expected, sum;
+	double start, ns;
+
+	values = (int32_t *)malloc(nr_segments * sizeof(int32_t));
+	include = (uint64_t *)calloc(1, BITS_TO_UINT64_ALIGN(nr_segments));
+	exclude = (uint64_t *)calloc(1, BITS_TO_UINT64_ALIGN(nr_segments));
+	for (size_t i = 0; i < nr_segments; i++) {
+		values[i] = (int32_t)(rand_r(&seed) % 65536) + 1;
+		if (rand_r(&seed) % 2) {
+			set_bit(include, i);
+		}
+		if (rand_r(&seed) % 1024 == 0) {
+			set_bit(exclude, i);
+		}
+	}
+	expected = argmin_test_reference(values, nr_segments, include,
+					  exclude);
+
+	start = argmin_test_now();
+	sum = 0;
+	for (size_t scan = 0; scan < nr_scans; scan++) {
+		sum += argmin_test_reference(values, nr_segments, include,
+					     exclude);
+	}
+	ns = (argmin_test_now() - start) / (double)nr_scans;
+	printf("argmin %-7s: %8.1f us/scan\n", "bitwise", ns / 1e3);
+	TEST_ASSERT_EQUAL_UINT64(expected * nr_scans, sum);
+
+	for (int variant = 0; variant < 3; variant++) {
+		argmin_block_fn block = argmin_test_get_block(variant);
+		if (block == NULL) {
+			continue;
+		}
+		start = argmin_test_now();
+		sum = 0;
+		for (size_t scan = 0; scan < nr_scans; scan++) {
+			sum += argmin_masked_with(values, nr_segments, include,
+						  exclude, block);
+		}
+		ns = (argmin_test_now() - start) / (double)nr_scans;
+		printf("argmin %-7s: %8.1f us/scan\n", names[variant],
+		       ns / 1e3);
+		TEST_ASSERT_EQUAL_UINT64(expected * nr_scans, sum);
+	}
+	free(exclude);
+	free(include);
+	free(values);
+}
+
+int main(void)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_argmin);
+	RUN_TEST(test_argmin_random);
+	RUN_TEST(test_argmin_benchmark);
+	return UNITY_END();
+}
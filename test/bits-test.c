@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 
 void setUp(void)
 {
@@ -88,10 +89,324 @@ void test_get_bits(void)
 	}
 }
 
+static uint64_t bits_test_find_naive(uint64_t *bits, uint64_t size,
+				     uint64_t idx, int value)
+{
+	for (; idx < size; idx++) {
+		if (get_bit(bits, idx) == value) {
+			return idx;
+		}
+	}
+	return BITS_NOT_FOUND;
+}
+
+void test_find_bits(void)
+{
+	/** not a multiple of the word and long enough for the vector loop */
+	const uint64_t nr_bits = 64 * 37 + 13;
+	const int densities[] = { 0, 1, 50, 99, 100 };
+	uint64_t *bits, bit;
+	unsigned int seed = 1;
+
+	bits = (uint64_t *)malloc((size_t)BITS_TO_UINT64_ALIGN(nr_bits));
+	for (size_t d = 0; d < sizeof(densities) / sizeof(int); d++) {
+		uint64_t nr_ones = 0, count = 0;
+
+		/** garbage after the size must be ignored */
+		memset(bits, 0xa5, (size_t)BITS_TO_UINT64_ALIGN(nr_bits));
+		for (uint64_t i = 0; i < nr_bits; i++) {
+			if ((int)(rand_r(&seed) % 100) < densities[d]) {
+				set_bit(bits, i);
+				nr_ones++;
+			} else {
+				reset_bit(bits, i);
+			}
+		}
+		for (uint64_t i = 0; i <= nr_bits; i++) {
+			TEST_ASSERT_EQUAL_UINT64(
+				bits_test_find_naive(bits, nr_bits, i, 1),
+				find_first_one_bit(bits, nr_bits, i));
+			TEST_ASSERT_EQUAL_UINT64(
+				bits_test_find_naive(bits, nr_bits, i, 0),
+				find_first_zero_bit(bits, nr_bits, i));
+		}
+		for_each_one_bit(bit, bits, nr_bits)
+		{
+			TEST_ASSERT_EQUAL_INT(1, get_bit(bits, bit));
+			count++;
+		}
+		TEST_ASSERT_EQUAL_UINT64(nr_ones, count);
+		for_each_zero_bit(bit, bits, nr_bits)
+		{
+			TEST_ASSERT_EQUAL_INT(0, get_bit(bits, bit));
+			count++;
+		}
+		TEST_ASSERT_EQUAL_UINT64(nr_bits, count);
+		TEST_ASSERT_EQUAL_UINT64(nr_ones,
+					 count_one_bits(bits, nr_bits));
+		TEST_ASSERT_EQUAL_UINT64(nr_bits - nr_ones,
+					 count_zero_bits(bits, nr_bits));
+	}
+	bit = find_next_one_bit(bits, nr_bits, BITS_NOT_FOUND);
+	TEST_ASSERT_EQUAL_UINT64(BITS_NOT_FOUND, bit);
+	free(bits);
+}
+
+#if BITS_USE_SIMD
+void test_find_word_simd(void)
+{
+	const uint64_t nr_words = 67;
+	uint64_t bits[nr_words];
+
+	for (uint64_t target = 0; target <= nr_words; target++) {
+		for (int i = 0; i < 2; i++) {
+			uint64_t skip = i ? (uint64_t)UINT64_MAX : 0;
+			for (uint64_t w = 0; w < nr_words; w++) {
+				bits[w] = skip;
+			}
+			if (target < nr_words) {
+				/** only one byte differs */
+				bits[target] ^= (uint64_t)0x80 << 56;
+			}
+			for (uint64_t start = 0; start <= target; start++) {
+				TEST_ASSERT_EQUAL_UINT64(
+					target, bits_find_word_sse2(bits, start,
+								    nr_words,
+								    skip));
+				if (!__builtin_cpu_supports("avx2")) {
+					continue;
+				}
+				TEST_ASSERT_EQUAL_UINT64(
+					target, bits_find_word_avx2(bits, start,
+								    nr_words,
+								    skip));
+			}
+		}
+	}
+}
+#endif
+
+void test_bits_atomic(void)
+{
+	const uint64_t nr_bits = 130;
+	uint64_t bits[BITS_TO_UINT64(nr_bits) + 1];
+	uint64_t bit;
+
+	memset(bits, 0, sizeof(bits));
+	TEST_ASSERT_EQUAL_INT(0, test_and_set_bit_atomic(bits, 65));
+	TEST_ASSERT_EQUAL_INT(1, test_and_set_bit_atomic(bits, 65));
+	TEST_ASSERT_EQUAL_INT(1, get_bit(bits, 65));
+	TEST_ASSERT_EQUAL_INT(1, get_bit_atomic(bits, 65));
+	TEST_ASSERT_EQUAL_INT(0, get_bit_atomic(bits, 64));
+	TEST_ASSERT_EQUAL_INT(1, test_and_clear_bit_atomic(bits, 65));
+	TEST_ASSERT_EQUAL_INT(0, test_and_clear_bit_atomic(bits, 65));
+
+	set_bit(bits, 1);
+	bit = claim_first_zero_bit_atomic(bits, nr_bits, 0);
+	TEST_ASSERT_EQUAL_UINT64(0, bit);
+	bit = claim_first_zero_bit_atomic(bits, nr_bits, 0);
+	TEST_ASSERT_EQUAL_UINT64(2, bit);
+	bit = claim_first_zero_bit_atomic(bits, nr_bits, 70);
+	TEST_ASSERT_EQUAL_UINT64(70, bit);
+	for (uint64_t i = 0; i < nr_bits; i++) {
+		claim_first_zero_bit_atomic(bits, nr_bits, 0);
+	}
+	TEST_ASSERT_EQUAL_UINT64(nr_bits, count_one_bits(bits, nr_bits));
+	bit = claim_first_zero_bit_atomic(bits, nr_bits, 0);
+	TEST_ASSERT_EQUAL_UINT64(BITS_NOT_FOUND, bit);
+	/** the bits after the size are never claimed */
+	TEST_ASSERT_EQUAL_UINT64(0, bits[BITS_TO_UINT64(nr_bits)] >> 2);
+}
+
+struct bits_test_claim {
+	uint64_t *bits;
+	uint64_t nr_bits;
+	int *owners; /**< the number of the claims of each bit */
+	size_t nr_claims;
+};
+
+static void *bits_test_claim_thread(void *data)
+{
+	struct bits_test_claim *claim = (struct bits_test_claim *)data;
+	uint64_t bit;
+
+	while ((bit = claim_first_zero_bit_atomic(claim->bits, claim->nr_bits,
+						  0)) != BITS_NOT_FOUND) {
+		__atomic_fetch_add(&claim->owners[bit], 1, __ATOMIC_RELAXED);
+		claim->nr_claims++;
+	}
+	return NULL;
+}
+
+/**
+ * @brief concurrent claims never get the same bit
+ */
+void test_bits_claim_concurrent(void)
+{
+	const uint64_t nr_bits = 64 * 1024 + 7;
+	const size_t nr_threads = 4;
+	struct bits_test_claim claims[nr_threads];
+	pthread_t tids[nr_threads];
+	uint64_t *bits;
+	int *owners;
+	size_t nr_claims = 0;
+
+	bits = (uint64_t *)calloc(1, (size_t)BITS_TO_UINT64_ALIGN(nr_bits));
+	owners = (int *)calloc((size_t)nr_bits, sizeof(int));
+	for (size_t i = 0; i < nr_threads; i++) {
+		claims[i].bits = bits;
+		claims[i].nr_bits = nr_bits;
+		claims[i].owners = owners;
+		claims[i].nr_claims = 0;
+		pthread_create(&tids[i], NULL, bits_test_claim_thread,
+			       &claims[i]);
+	}
+	for (size_t i = 0; i < nr_threads; i++) {
+		pthread_join(tids[i], NULL);
+		nr_claims += claims[i].nr_claims;
+	}
+	TEST_ASSERT_EQUAL_UINT64(nr_bits, nr_claims);
+	for (uint64_t i = 0; i < nr_bits; i++) {
+		TEST_ASSERT_EQUAL_INT(1, owners[i]);
+	}
+	free(owners);
+	free(bits);
+}
+
+/**
+ * @brief bit by bit search which was used before the bit scan instruction
+ */
+static uint64_t bits_test_find_zero_legacy(uint64_t *bits, uint64_t size,
+					   uint64_t idx)
+{
+	while (idx < size) {
+		uint64_t bucket = bits[BITS_TO_UINT64(idx)];
+		if (bucket < (uint64_t)UINT64_MAX) {
+			uint64_t diff = 0;
+			for (diff = 0; diff < BITS_PER_UINT64; diff++) {
+				if ((bucket & ((uint64_t)0x1 << diff)) == 0x0) {
+					break;
+				}
+			}
+			return idx + diff;
+		}
+		idx += BITS_PER_UINT64;
+	}
+	return BITS_NOT_FOUND;
+}
+
+static double bits_test_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief throughput of the zero bit search
+ *
+ * @note
+ * `segment` allocates every page of a 128 pages segment in order as
+ * `page_ftl_get_free_page()` does. `scan` finds the last zero bit of the
+ * 1M bits bitmap.
+ */
+void test_bits_benchmark(void)
+{
+	const uint64_t nr_pages = 128;
+	const uint64_t nr_bits = (uint64_t)1 << 20;
+	const uint64_t nr_words = nr_bits / BITS_PER_UINT64;
+	const size_t nr_segments = 1 << 14, nr_scans = 256;
+	const uint64_t full = (uint64_t)UINT64_MAX;
+	uint64_t segment[BITS_TO_UINT64(nr_pages) + 1];
+	uint64_t *bits, sum = 0;
+	double start, legacy_ns = 0, ns = 0;
+
+	for (int is_legacy = 1; is_legacy >= 0; is_legacy--) {
+		uint64_t (*find)(uint64_t *, uint64_t, uint64_t) =
+			is_legacy ? bits_test_find_zero_legacy :
+				    find_first_zero_bit;
+
+		start = bits_test_now();
+		for (size_t i = 0; i < nr_segments; i++) {
+			memset(segment, 0, sizeof(segment));
+			for (uint64_t page = 0; page < nr_pages; page++) {
+				uint64_t pos = find(segment, nr_pages, 0);
+				set_bit(segment, pos);
+				sum += pos;
+			}
+		}
+		ns = (bits_test_now() - start) /
+		     (double)(nr_segments * nr_pages);
+		if (is_legacy) {
+			legacy_ns = ns;
+		}
+	}
+	printf("segment: legacy %6.2f ns/alloc, bit scan %6.2f ns/alloc\n",
+	       legacy_ns, ns);
+
+	bits = (uint64_t *)malloc((size_t)BITS_TO_UINT64_ALIGN(nr_bits));
+	memset(bits, 0xff, (size_t)BITS_TO_UINT64_ALIGN(nr_bits));
+	reset_bit(bits, nr_bits - 1);
+	for (int variant = 0; variant < 4; variant++) {
+		const char *names[] = { "legacy", "generic", "sse2", "avx2" };
+		uint64_t pos = 0;
+
+#if BITS_USE_SIMD
+		if (variant == 3 && !__builtin_cpu_supports("avx2")) {
+			continue;
+		}
+#else
+		if (variant >= 2) {
+			continue;
+		}
+#endif
+		start = bits_test_now();
+		for (size_t i = 0; i < nr_scans; i++) {
+			switch (variant) {
+			case 0:
+				pos = bits_test_find_zero_legacy(bits, nr_bits,
+								 0);
+				break;
+			case 1:
+				pos = bits_find_word_generic(bits, 0, nr_words,
+							     full);
+				break;
+#if BITS_USE_SIMD
+			case 2:
+				pos = bits_find_word_sse2(bits, 0, nr_words,
+							  full);
+				break;
+			case 3:
+				pos = bits_find_word_avx2(bits, 0, nr_words,
+							  full);
+				break;
+#endif
+			default:
+				break;
+			}
+			sum += pos;
+		}
+		ns = (bits_test_now() - start) / (double)nr_scans;
+		printf("scan %-7s: %8.2f GiB/s\n", names[variant],
+		       (double)(nr_bits / BITS_PER_BYTE) / ns);
+	}
+	TEST_ASSERT_EQUAL_UINT64(nr_bits - 1,
+				 find_first_zero_bit(bits, nr_bits, 0));
+	TEST_ASSERT_NOT_EQUAL(0, sum);
+	free(bits);
+}
+
 int main(void)
 {
 	UNITY_BEGIN();
 	RUN_TEST(test_bits);
 	RUN_TEST(test_get_bits);
+	RUN_TEST(test_find_bits);
+#if BITS_USE_SIMD
+	RUN_TEST(test_find_word_simd);
+#endif
+	RUN_TEST(test_bits_atomic);
+	RUN_TEST(test_bits_claim_concurrent);
+	RUN_TEST(test_bits_benchmark);
 	return UNITY_END();
 }
@@ -0,0 +1,501 @@
+#include "cache.h"
+#include "unity.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <pthread.h>
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static double cache_bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int cache_nr_deallocs;
+
+struct cache_test_value {
+	uint64_t key;
+};
+
+static int cache_test_dealloc(const uint64_t key, uintptr_t value)
+{
+	struct cache_test_value *entry =
+		(struct cache_test_value *)value;
+	if (entry->key != key) {
+		return -EINVAL;
+	}
+	__atomic_fetch_add(&cache_nr_deallocs, 1, __ATOMIC_RELAXED);
+	free(entry);
+	return 0;
+}
+
+static int cache_test_access(const uint64_t key, uintptr_t value,
+				 void *data)
+{
+	struct cache_test_value *entry =
+		(struct cache_test_value *)value;
+	(void)data;
+	return entry->key == key ? 0 : -EINVAL;
+}
+
+static struct cache_test_value *cache_test_alloc(uint64_t key)
+{
+	struct cache_test_value *entry =
+		(struct cache_test_value *)malloc(
+			sizeof(struct cache_test_value));
+	entry->key = key;
+	return entry;
+}
+
+void test_cache_init(void)
+{
+	TEST_ASSERT_NULL(cache_init(NR_CACHE_POLICY, 16, NULL));
+	TEST_ASSERT_NULL(cache_init(CACHE_POLICY_LRU, 0, NULL));
+	for (int policy = 0; policy < NR_CACHE_POLICY; policy++) {
+		struct cache *cache = cache_init(policy, 16, NULL);
+		const char *name = cache_get_policy_name(policy);
+
+		TEST_ASSERT_NOT_NULL(cache);
+		TEST_ASSERT_EQUAL_INT(policy, cache_get_policy(name));
+		cache_free(cache);
+	}
+	TEST_ASSERT_EQUAL_INT(-EINVAL, cache_get_policy("mru"));
+	TEST_ASSERT_NULL(cache_get_policy_name(-1));
+}
+
+void test_cache_fill(void)
+{
+	const size_t capacity = 100;
+	const size_t nr_puts = 1000;
+
+	for (int policy = 0; policy < NR_CACHE_POLICY; policy++) {
+		struct cache *cache;
+
+		cache_nr_deallocs = 0;
+		cache = cache_init(policy, capacity, cache_test_dealloc);
+		for (size_t key = 0; key < capacity; key++) {
+			TEST_ASSERT_EQUAL_INT(
+				0, cache_put(cache, key,
+					     (uintptr_t)cache_test_alloc(key)));
+		}
+		TEST_ASSERT_EQUAL_INT(capacity, cache->size);
+		for (size_t key = 0; key < capacity; key++) {
+			struct cache_test_value *entry =
+				(struct cache_test_value *)cache_get(cache,
+								     key);
+			TEST_ASSERT_NOT_NULL(entry);
+			TEST_ASSERT_EQUAL_INT(key, entry->key);
+		}
+		TEST_ASSERT_EQUAL_INT(0, cache_nr_deallocs);
+
+		/** replacing the value deallocates the previous one */
+		cache_put(cache, 7, (uintptr_t)cache_test_alloc(7));
+		TEST_ASSERT_EQUAL_INT(1, cache_nr_deallocs);
+		TEST_ASSERT_EQUAL_INT(0, cache_delete(cache, 7));
+		TEST_ASSERT_EQUAL_INT(-ENOENT, cache_delete(cache, 7));
+		TEST_ASSERT_EQUAL_INT(0, cache_peek(cache, 7));
+		TEST_ASSERT_EQUAL_INT(capacity - 1, cache->size);
+
+		for (size_t key = capacity; key < nr_puts; key++) {
+			cache_put(cache, key, (uintptr_t)cache_test_alloc(key));
+			TEST_ASSERT_LESS_OR_EQUAL(capacity, cache->size);
+		}
+		TEST_ASSERT_EQUAL_INT(capacity, cache->size);
+		TEST_ASSERT_EQUAL_INT(0, cache_evict(cache, 10));
+		TEST_ASSERT_EQUAL_INT(capacity - 10, cache->size);
+		cache_free(cache);
+		TEST_ASSERT_EQUAL_INT(nr_puts + 1, cache_nr_deallocs);
+	}
+}
+
+/**
+ * @brief random operations never return the stale value
+ */
+void test_cache_random_ops(void)
+{
+	const size_t capacity = 128;
+	const size_t nr_keys = 512;
+	uintptr_t expected[nr_keys];
+
+	for (int policy = 0; policy < NR_CACHE_POLICY; policy++) {
+		struct cache *cache = cache_init(policy, capacity, NULL);
+		unsigned int seed = (unsigned int)policy + 1;
+		uintptr_t version = 1;
+		size_t nr_hits = 0;
+
+		memset(expected, 0, sizeof(expected));
+		for (size_t i = 0; i < 1 << 17; i++) {
+			uint64_t key = (uint64_t)rand_r(&seed) % nr_keys;
+			int op = rand_r(&seed) % 8;
+			uintptr_t value;
+
+			if (op < 2) {
+				cache_put(cache, key, version);
+				expected[key] = version++;
+			} else if (op == 2) {
+				cache_delete(cache, key);
+				expected[key] = 0;
+			} else {
+				value = op == 3 ? cache_peek(cache, key) :
+						  cache_get(cache, key);
+				if (value) {
+					TEST_ASSERT_EQUAL_INT(expected[key],
+							      value);
+					nr_hits++;
+				}
+			}
+			TEST_ASSERT_LESS_OR_EQUAL(capacity, cache->size);
+		}
+		TEST_ASSERT_GREATER_THAN(0, nr_hits);
+		cache_free(cache);
+	}
+}
+
+/**
+ * @brief hit ratio of the hot keys which are interleaved with a long scan
+ *
+ * @note
+ * Every read of the hot set is followed by a read of the new key. The reuse
+ * distance of the hot keys exceeds the capacity, so the strict LRU (and
+ * CLOCK) lets the scan flush them, while 2Q and ARC keep them.
+ */
+void test_cache_scan_resistance(void)
+{
+	const size_t capacity = 256;
+	const size_t nr_hot = 192;
+	const size_t nr_reads = 1 << 16;
+	double hit_ratio[NR_CACHE_POLICY];
+
+	for (int policy = 0; policy < NR_CACHE_POLICY; policy++) {
+		struct cache *cache = cache_init(policy, capacity, NULL);
+		unsigned int seed = 1;
+		uint64_t scan_key = nr_hot;
+		size_t nr_hits = 0;
+
+		for (size_t i = 0; i < nr_reads; i++, scan_key++) {
+			uint64_t key = (uint64_t)rand_r(&seed) % nr_hot;
+			if (cache_get(cache, key)) {
+				nr_hits++;
+			} else {
+				cache_put(cache, key, key + 1);
+			}
+			if (!cache_get(cache, scan_key)) {
+				cache_put(cache, scan_key, scan_key);
+			}
+		}
+		hit_ratio[policy] = (double)nr_hits / (double)nr_reads;
+		printf("%-5s: hot set hit ratio %5.1f%%\n",
+		       cache_get_policy_name(policy), hit_ratio[policy] * 100);
+		cache_free(cache);
+	}
+	TEST_ASSERT_GREATER_THAN(hit_ratio[CACHE_POLICY_LRU],
+				 hit_ratio[CACHE_POLICY_2Q]);
+	TEST_ASSERT_GREATER_THAN(hit_ratio[CACHE_POLICY_LRU],
+				 hit_ratio[CACHE_POLICY_ARC]);
+}
+
+/**
+ * @brief cost of the hits and the misses of each policy
+ */
+void test_cache_benchmark(void)
+{
+	const size_t capacity = 1 << 14;
+	const size_t nr_ops = 1 << 20;
+
+	for (int policy = 0; policy < NR_CACHE_POLICY; policy++) {
+		struct cache *cache = cache_init(policy, capacity, NULL);
+		unsigned int seed = 1;
+		size_t nr_hits = 0;
+		double start, op_ns;
+
+		start = cache_bench_now();
+		for (size_t i = 0; i < nr_ops; i++) {
+			/** 80% of the accesses hit a half of the cache */
+			uint64_t key = (uint64_t)rand_r(&seed) % capacity;
+			if (rand_r(&seed) % 5 != 0) {
+				key %= capacity / 2;
+			} else {
+				key += capacity;
+			}
+			if (cache_get(cache, key)) {
+				nr_hits++;
+			} else {
+				cache_put(cache, key, key + 1);
+			}
+		}
+		op_ns = (cache_bench_now() - start) / (double)nr_ops;
+		printf("%-5s: %6.1f ns/op, hit ratio %5.1f%%\n",
+		       cache_get_policy_name(policy), op_ns,
+		       (double)nr_hits * 100 / (double)nr_ops);
+		TEST_ASSERT_GREATER_THAN(0, nr_hits);
+		cache_free(cache);
+	}
+}
+
+void test_sharded_cache_fill(void)
+{
+	struct sharded_cache *cache;
+	const size_t nr_puts = 1000;
+
+	TEST_ASSERT_NULL(sharded_cache_init(CACHE_POLICY_LRU, 0, 4, NULL));
+	TEST_ASSERT_NULL(sharded_cache_init(CACHE_POLICY_LRU, 4, 8, NULL));
+
+	cache_nr_deallocs = 0;
+	cache = sharded_cache_init(CACHE_POLICY_LRU, 64, 4,
+				   cache_test_dealloc);
+	TEST_ASSERT_NOT_NULL(cache);
+	TEST_ASSERT_EQUAL_INT(64, cache->capacity);
+	for (size_t key = 0; key < 16; key++) {
+		TEST_ASSERT_EQUAL_INT(
+			0, sharded_cache_put(cache, key,
+					     (uintptr_t)cache_test_alloc(key)));
+	}
+	/** more hits than the access buffer */
+	for (size_t i = 0; i < 4 * SHARDED_CACHE_NR_ACCESSES; i++) {
+		TEST_ASSERT_EQUAL_INT(0, sharded_cache_access(cache, i % 16,
+							      cache_test_access,
+							      NULL));
+	}
+	TEST_ASSERT_EQUAL_INT(0, sharded_cache_delete(cache, 3));
+	TEST_ASSERT_EQUAL_INT(-ENOENT, sharded_cache_delete(cache, 3));
+	TEST_ASSERT_EQUAL_INT(0, sharded_cache_get(cache, 3));
+	TEST_ASSERT_EQUAL_INT(-ENOENT, sharded_cache_access(cache, 3,
+							    cache_test_access,
+							    NULL));
+	TEST_ASSERT_EQUAL_INT(1, cache_nr_deallocs);
+
+	for (size_t key = 16; key < nr_puts; key++) {
+		sharded_cache_put(cache, key,
+				  (uintptr_t)cache_test_alloc(key));
+	}
+	TEST_ASSERT_GREATER_OR_EQUAL(nr_puts - 1 - cache->capacity,
+				     (size_t)cache_nr_deallocs);
+	TEST_ASSERT_EQUAL_INT(0, sharded_cache_free(cache));
+	TEST_ASSERT_EQUAL_INT(nr_puts, cache_nr_deallocs);
+}
+
+/**
+ * @brief keeps the hot keys while the cold keys are streamed
+ */
+void test_sharded_cache_hot_keys(void)
+{
+	struct sharded_cache *cache;
+	const size_t nr_hot = 32;
+
+	cache = sharded_cache_init(CACHE_POLICY_LRU, 256, 4, NULL);
+	for (size_t key = 0; key < nr_hot; key++) {
+		sharded_cache_put(cache, key, key + 1);
+	}
+	for (size_t key = nr_hot; key < 64 * 256; key++) {
+		for (size_t hot = 0; hot < nr_hot && key % 16 == 0; hot++) {
+			sharded_cache_get(cache, hot);
+		}
+		sharded_cache_put(cache, key, key + 1);
+	}
+	for (size_t key = 0; key < nr_hot; key++) {
+		TEST_ASSERT_EQUAL_INT(key + 1, sharded_cache_get(cache, key));
+	}
+	sharded_cache_free(cache);
+}
+
+struct cache_test_thread {
+	struct sharded_cache *shard_cache;
+	struct lru_cache *cache; /**< global lock variant */
+	pthread_mutex_t *mutex;
+	unsigned int seed;
+	size_t nr_ops;
+	size_t nr_keys;
+	size_t nr_errors;
+	size_t nr_hits;
+};
+
+static void *sharded_cache_stress_thread(void *data)
+{
+	struct cache_test_thread *t = (struct cache_test_thread *)data;
+
+	for (size_t i = 0; i < t->nr_ops; i++) {
+		uint64_t key = (uint64_t)rand_r(&t->seed) % t->nr_keys;
+		int op = rand_r(&t->seed) % 8;
+		int ret;
+
+		if (op == 0) {
+			ret = sharded_cache_put(
+				t->shard_cache, key,
+				(uintptr_t)cache_test_alloc(key));
+		} else if (op == 1) {
+			ret = sharded_cache_delete(t->shard_cache, key);
+			ret = ret == -ENOENT ? 0 : ret;
+		} else {
+			ret = sharded_cache_access(t->shard_cache, key,
+						   cache_test_access, NULL);
+			t->nr_hits += ret == 0;
+			ret = ret == -ENOENT ? 0 : ret;
+		}
+		t->nr_errors += ret != 0;
+	}
+	return NULL;
+}
+
+/**
+ * @brief concurrent puts, deletes and accesses on each policy
+ */
+void test_sharded_cache_stress(void)
+{
+	const size_t nr_threads = 4;
+	struct cache_test_thread threads[nr_threads];
+	pthread_t tids[nr_threads];
+	const size_t nr_ops = 1 << 16;
+	size_t nr_puts = 0;
+	unsigned int seed;
+
+	/** every inserted value is deallocated exactly once */
+	for (size_t i = 0; i < nr_threads; i++) {
+		seed = (unsigned int)i + 1;
+		for (size_t op = 0; op < nr_ops; op++) {
+			rand_r(&seed);
+			nr_puts += rand_r(&seed) % 8 == 0;
+		}
+	}
+
+	for (int policy = 0; policy < NR_CACHE_POLICY; policy++) {
+		struct sharded_cache *cache;
+
+		cache_nr_deallocs = 0;
+		cache = sharded_cache_init(policy, 1024, 16,
+					   cache_test_dealloc);
+		for (size_t i = 0; i < nr_threads; i++) {
+			memset(&threads[i], 0,
+			       sizeof(struct cache_test_thread));
+			threads[i].shard_cache = cache;
+			threads[i].seed = (unsigned int)i + 1;
+			threads[i].nr_ops = nr_ops;
+			threads[i].nr_keys = 4096;
+			pthread_create(&tids[i], NULL,
+				       sharded_cache_stress_thread,
+				       &threads[i]);
+		}
+		for (size_t i = 0; i < nr_threads; i++) {
+			pthread_join(tids[i], NULL);
+			TEST_ASSERT_EQUAL_INT(0, threads[i].nr_errors);
+			TEST_ASSERT_GREATER_THAN(0, threads[i].nr_hits);
+		}
+		sharded_cache_free(cache);
+		TEST_ASSERT_EQUAL_INT(nr_puts, cache_nr_deallocs);
+	}
+}
+
+static void *sharded_cache_bench_thread(void *data)
+{
+	struct cache_test_thread *t = (struct cache_test_thread *)data;
+
+	for (size_t i = 0; i < t->nr_ops; i++) {
+		uint64_t key = (uint64_t)rand_r(&t->seed) % t->nr_keys;
+		if (t->shard_cache) {
+			t->nr_hits +=
+				sharded_cache_get(t->shard_cache, key) != 0;
+			continue;
+		}
+		pthread_mutex_lock(t->mutex);
+		t->nr_hits += lru_get(t->cache, key) != 0;
+		pthread_mutex_unlock(t->mutex);
+	}
+	return NULL;
+}
+
+/**
+ * @brief compares the hit throughput with the globally locked `lru_cache`
+ */
+void test_sharded_cache_benchmark(void)
+{
+	const size_t nr_keys = 1 << 14;
+	const size_t nr_ops = 1 << 18;
+	pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+	for (size_t nr_threads = 1; nr_threads <= 8; nr_threads <<= 1) {
+		struct cache_test_thread threads[8];
+		pthread_t tids[8];
+		double mops[2];
+
+		for (int is_shard = 0; is_shard < 2; is_shard++) {
+			struct sharded_cache *shard_cache = NULL;
+			struct lru_cache *cache = NULL;
+			double start;
+
+			/** the keys are not spread evenly over the shards */
+			if (is_shard) {
+				shard_cache = sharded_cache_init(
+					CACHE_POLICY_LRU, 2 * nr_keys, 16,
+					NULL);
+			} else {
+				cache = lru_init(nr_keys, NULL);
+			}
+			for (size_t key = 0; key < nr_keys; key++) {
+				if (is_shard) {
+					sharded_cache_put(shard_cache, key,
+							  key + 1);
+				} else {
+					lru_put(cache, key, key + 1);
+				}
+			}
+
+			start = cache_bench_now();
+			for (size_t i = 0; i < nr_threads; i++) {
+				memset(&threads[i], 0,
+				       sizeof(struct cache_test_thread));
+				threads[i].shard_cache = shard_cache;
+				threads[i].cache = cache;
+				threads[i].mutex = &mutex;
+				threads[i].seed = (unsigned int)i + 1;
+				threads[i].nr_ops = nr_ops / nr_threads;
+				threads[i].nr_keys = nr_keys;
+				pthread_create(&tids[i], NULL,
+					       sharded_cache_bench_thread,
+					       &threads[i]);
+			}
+			for (size_t i = 0; i < nr_threads; i++) {
+				pthread_join(tids[i], NULL);
+				TEST_ASSERT_EQUAL_INT(threads[i].nr_ops,
+						      threads[i].nr_hits);
+			}
+			mops[is_shard] = (double)nr_ops * 1e3 /
+					 (cache_bench_now() - start);
+
+			if (is_shard) {
+				sharded_cache_free(shard_cache);
+			} else {
+				lru_free(cache);
+			}
+		}
+		printf("threads %zu: global lock %6.2f Mops/s, "
+		       "sharded %6.2f Mops/s\n",
+		       nr_threads, mops[0], mops[1]);
+	}
+}
+
+int main(void)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_cache_init);
+	RUN_TEST(test_cache_fill);
+	RUN_TEST(test_cache_random_ops);
+	RUN_TEST(test_cache_scan_resistance);
+	RUN_TEST(test_cache_benchmark);
+	RUN_TEST(test_sharded_cache_fill);
+	RUN_TEST(test_sharded_cache_hot_keys);
+	RUN_TEST(test_sharded_cache_stress);
+	RUN_TEST(test_sharded_cache_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,147 @@
+#include "hbitmap.h"
+#include "unity.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_hbitmap_init(void)
+{
+	struct hbitmap *hbitmap;
+
+	TEST_ASSERT_NULL(hbitmap_init(0));
+	hbitmap = hbitmap_init(64);
+	TEST_ASSERT_EQUAL_INT(1, hbitmap->nr_levels);
+	hbitmap_free(hbitmap);
+	hbitmap = hbitmap_init(65);
+	TEST_ASSERT_EQUAL_INT(2, hbitmap->nr_levels);
+	hbitmap_free(hbitmap);
+	hbitmap = hbitmap_init((uint64_t)1 << 24);
+	TEST_ASSERT_EQUAL_INT(4, hbitmap->nr_levels);
+	TEST_ASSERT_EQUAL_UINT64(BITS_NOT_FOUND,
+				 hbitmap_find_first_one_bit(hbitmap, 0));
+	TEST_ASSERT_EQUAL_UINT64(0, hbitmap_find_first_zero_bit(hbitmap, 0));
+	hbitmap_free(hbitmap);
+}
+
+/**
+ * @brief compare the search with the flat bitmap's
+ */
+void test_hbitmap_random(void)
+{
+	const uint64_t sizes[] = { 1, 63, 64, 65, 4097, 64 * 64 * 64 + 5 };
+	unsigned int seed = 1;
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(uint64_t); i++) {
+		uint64_t nr_bits = sizes[i];
+		struct hbitmap *hbitmap = hbitmap_init(nr_bits);
+		uint64_t *bits;
+
+		bits = (uint64_t *)calloc(1, BITS_TO_UINT64_ALIGN(nr_bits));
+		for (int round = 0; round < 4; round++) {
+			/** sparse, half, dense and full */
+			int density = round == 3 ? 100 : round * 45 + 1;
+
+			for (uint64_t bit = 0; bit < nr_bits; bit++) {
+				if ((int)(rand_r(&seed) % 100) < density) {
+					hbitmap_set_bit(hbitmap, bit);
+					set_bit(bits, bit);
+				} else {
+					hbitmap_reset_bit(hbitmap, bit);
+					reset_bit(bits, bit);
+				}
+			}
+			for (uint64_t n = 0; n < 512; n++) {
+				uint64_t idx = (uint64_t)rand_r(&seed) %
+					       (nr_bits + 1);
+				TEST_ASSERT_EQUAL_INT(
+					get_bit(bits, idx % nr_bits),
+					hbitmap_get_bit(hbitmap,
+							idx % nr_bits));
+				TEST_ASSERT_EQUAL_UINT64(
+					find_first_one_bit(bits, nr_bits, idx),
+					hbitmap_find_first_one_bit(hbitmap,
+								   idx));
+				TEST_ASSERT_EQUAL_UINT64(
+					find_first_zero_bit(bits, nr_bits, idx),
+					hbitmap_find_first_zero_bit(hbitmap,
+								    idx));
+			}
+		}
+		free(bits);
+		hbitmap_free(hbitmap);
+	}
+}
+
+static double hbitmap_test_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief find the last free one on the nearly full bitmap
+ *
+ * @note
+ * It models the free segment search of the large and nearly full device.
+ */
+void test_hbitmap_benchmark(void)
+{
+	const uint64_t nr_bits = (uint64_t)1 << 22;
+	const size_t nr_finds = 1 << 12;
+	struct hbitmap *hbitmap = hbitmap_init(nr_bits);
+	uint64_t *bits, sum = 0;
+	unsigned int seed = 1;
+	double start, flat_ns, hier_ns;
+
+	bits = (uint64_t *)calloc(1, BITS_TO_UINT64_ALIGN(nr_bits));
+	for (uint64_t bit = 0; bit < nr_bits; bit++) {
+		hbitmap_set_bit(hbitmap, bit);
+		set_bit(bits, bit);
+	}
+
+	start = hbitmap_test_now();
+	for (size_t i = 0; i < nr_finds; i++) {
+		uint64_t bit = (uint64_t)rand_r(&seed) % nr_bits;
+		reset_bit(bits, bit);
+		sum += find_first_zero_bit(bits, nr_bits, 0);
+		set_bit(bits, bit);
+	}
+	flat_ns = (hbitmap_test_now() - start) / (double)nr_finds;
+
+	seed = 1;
+	start = hbitmap_test_now();
+	for (size_t i = 0; i < nr_finds; i++) {
+		uint64_t bit = (uint64_t)rand_r(&seed) % nr_bits;
+		hbitmap_reset_bit(hbitmap, bit);
+		sum -= hbitmap_find_first_zero_bit(hbitmap, 0);
+		hbitmap_set_bit(hbitmap, bit);
+	}
+	hier_ns = (hbitmap_test_now() - start) / (double)nr_finds;
+
+	printf("flat %8.1f ns/find, hierarchical %8.1f ns/find\n", flat_ns,
+	       hier_ns);
+	TEST_ASSERT_EQUAL_UINT64(0, sum);
+	free(bits);
+	hbitmap_free(hbitmap);
+}
+
+int main(void)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_hbitmap_init);
+	RUN_TEST(test_hbitmap_random);
+	RUN_TEST(test_hbitmap_benchmark);
+	return UNITY_END();
+}
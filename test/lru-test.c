@@ -1,8 +1,12 @@
 #include "lru.h"
 #include "unity.h"
 
+#include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include <stdint.h>
 
 void setUp(void)
@@ -94,6 +98,213 @@ void test_lru_small_fill(void)
 	TEST_ASSERT_EQUAL_INT(0, lru_free(cache));
 }
 
+void test_lru_delete(void)
+{
+	struct lru_cache *cache;
+	int *data;
+	cache = lru_init(10, dealloc_data);
+	for (size_t i = 1; i <= 10; i++) {
+		data = (int *)malloc(sizeof(int));
+		*data = (int)i;
+		TEST_ASSERT_EQUAL_INT(0, lru_put(cache, i, (uintptr_t)data));
+	}
+	TEST_ASSERT_EQUAL_INT(0, lru_delete(cache, 5));
+	TEST_ASSERT_EQUAL_INT(-ENOENT, lru_delete(cache, 5));
+	TEST_ASSERT_NULL((void *)lru_get(cache, 5));
+	TEST_ASSERT_EQUAL_INT(9, cache->size);
+
+	/** replacing the value deallocates the previous one */
+	data = (int *)malloc(sizeof(int));
+	*data = 30;
+	TEST_ASSERT_EQUAL_INT(0, lru_put(cache, 3, (uintptr_t)data));
+	TEST_ASSERT_EQUAL_INT(30, *(int *)lru_get(cache, 3));
+	TEST_ASSERT_EQUAL_INT(9, cache->size);
+	TEST_ASSERT_EQUAL_INT(0, lru_free(cache));
+}
+
+void test_lru_random_ops(void)
+{
+	const size_t cache_size = 64;
+	const size_t nr_keys = 256;
+	uintptr_t expected[256];
+	size_t last_used[256];
+	size_t nr_present = 0;
+	struct lru_cache *cache;
+	unsigned int seed = 1;
+
+	memset(expected, 0, sizeof(expected));
+	memset(last_used, 0, sizeof(last_used));
+	cache = lru_init(cache_size, NULL);
+	for (int i = 0; i < 100000; i++) {
+		size_t key = (size_t)rand_r(&seed) % nr_keys;
+		uintptr_t value = (uintptr_t)i + 1;
+		switch (rand_r(&seed) % 3) {
+		case 0:
+			if (expected[key] == 0 && nr_present >= cache_size) {
+				/** the least recently used entry is evicted */
+				size_t victim = nr_keys;
+				for (size_t k = 0; k < nr_keys; k++) {
+					if (expected[k] &&
+					    (victim == nr_keys ||
+					     last_used[k] < last_used[victim])) {
+						victim = k;
+					}
+				}
+				expected[victim] = 0;
+				nr_present--;
+			}
+			nr_present += expected[key] == 0;
+			expected[key] = value;
+			last_used[key] = (size_t)i;
+			TEST_ASSERT_EQUAL_INT(0, lru_put(cache, key, value));
+			break;
+		case 1:
+			TEST_ASSERT_EQUAL_INT(expected[key] ? 0 : -ENOENT,
+					      lru_delete(cache, key));
+			nr_present -= expected[key] != 0;
+			expected[key] = 0;
+			break;
+		default:
+			TEST_ASSERT_EQUAL_INT(expected[key],
+					      lru_get(cache, key));
+			last_used[key] = (size_t)i;
+			break;
+		}
+		TEST_ASSERT_EQUAL_INT(nr_present, cache->size);
+	}
+	TEST_ASSERT_EQUAL_INT(0, lru_free(cache));
+}
+
+void test_lru_evict_ratio(void)
+{
+	struct lru_cache *cache;
+	cache = lru_init(100, NULL);
+	TEST_ASSERT_EQUAL_INT(-EINVAL, lru_set_evict_ratio(cache, 0));
+	TEST_ASSERT_EQUAL_INT(-EINVAL, lru_set_evict_size(cache, 101));
+	TEST_ASSERT_EQUAL_INT(0, lru_set_evict_ratio(cache, 30));
+	TEST_ASSERT_EQUAL_INT(30, lru_get_evict_size(cache));
+	for (size_t i = 0; i < 101; i++) {
+		TEST_ASSERT_EQUAL_INT(0, lru_put(cache, i, i + 1));
+	}
+	/** the oldest 30 entries are evicted by the last insertion */
+	TEST_ASSERT_EQUAL_INT(71, cache->size);
+	TEST_ASSERT_NULL((void *)lru_get(cache, 29));
+	TEST_ASSERT_EQUAL_INT(31, lru_get(cache, 30));
+	TEST_ASSERT_EQUAL_INT(0, lru_free(cache));
+}
+
+static int nr_flushed;
+static int nr_dirty;
+
+/**
+ * @brief defer the odd (dirty) values to the flusher
+ */
+static int dealloc_dirty(const uint64_t key, uintptr_t value)
+{
+	(void)key;
+	if (value & 1) {
+		return LRU_DEALLOC_DEFER;
+	}
+	return 0;
+}
+
+static int flush_dirty(const uint64_t key, uintptr_t value)
+{
+	(void)key;
+	TEST_ASSERT_EQUAL_INT(1, value & 1);
+	usleep(10);
+	__atomic_fetch_add(&nr_flushed, 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+void test_lru_deferred_flush(void)
+{
+	struct lru_cache *cache;
+	nr_flushed = 0;
+	nr_dirty = 0;
+	cache = lru_init(16, dealloc_dirty);
+	TEST_ASSERT_EQUAL_INT(0, lru_set_flusher(cache, flush_dirty));
+	for (size_t i = 0; i < 10000; i++) {
+		TEST_ASSERT_EQUAL_INT(0, lru_put(cache, i, i + 1));
+		nr_dirty += (int)((i + 1) & 1);
+		TEST_ASSERT_EQUAL_INT(i + 1, lru_get(cache, i));
+	}
+	TEST_ASSERT_EQUAL_INT(16, cache->size);
+	TEST_ASSERT_EQUAL_INT(0, lru_flush(cache));
+	/** every dirty entry except the cached ones is flushed */
+	TEST_ASSERT_EQUAL_INT(nr_dirty - 8,
+			      __atomic_load_n(&nr_flushed, __ATOMIC_RELAXED));
+	TEST_ASSERT_EQUAL_INT(0, lru_free(cache));
+	TEST_ASSERT_EQUAL_INT(nr_dirty, nr_flushed);
+}
+
+/**
+ * @brief previous lookup of the LRU cache which walks the list
+ */
+static struct lru_node *lru_walk_find(struct lru_cache *cache, uint64_t key)
+{
+	struct lru_node *it;
+	for (it = cache->head->next; it != cache->head; it = it->next) {
+		if (it->key == key) {
+			return it;
+		}
+	}
+	return NULL;
+}
+
+static double lru_bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+void test_lru_benchmark(void)
+{
+	const size_t nr_gets = 1 << 16;
+	const size_t nr_walks = 1 << 8;
+	unsigned int seed = 1;
+
+	for (size_t capacity = 1 << 10; capacity <= 1 << 19; capacity <<= 3) {
+		struct lru_cache *cache = lru_init(capacity, NULL);
+		double start, get_ns, put_ns, walk_ns;
+		uintptr_t sum = 0;
+		size_t i;
+
+		start = lru_bench_now();
+		for (i = 0; i < capacity; i++) {
+			lru_put(cache, i, i + 1);
+		}
+		put_ns = (lru_bench_now() - start) / (double)capacity;
+
+		start = lru_bench_now();
+		for (i = 0; i < nr_gets; i++) {
+			sum += lru_get(cache, (size_t)rand_r(&seed) % capacity);
+		}
+		get_ns = (lru_bench_now() - start) / (double)nr_gets;
+
+		/** the list walk takes too long for the larger capacity */
+		walk_ns = 0;
+		start = lru_bench_now();
+		for (i = 0; i < nr_walks && capacity <= 1 << 16; i++) {
+			struct lru_node *node = lru_walk_find(
+				cache, (size_t)rand_r(&seed) % capacity);
+			sum += node->value;
+		}
+		if (i > 0) {
+			walk_ns = (lru_bench_now() - start) / (double)i;
+		}
+
+		printf("capacity %7zu: put %6.1f ns, get %6.1f ns, "
+		       "list walk %10.1f ns (sum: %zu)\n",
+		       capacity, put_ns, get_ns, walk_ns, (size_t)sum);
+		if (walk_ns > 0 && capacity >= 1 << 13) {
+			TEST_ASSERT_LESS_THAN(walk_ns, get_ns);
+		}
+		TEST_ASSERT_EQUAL_INT(0, lru_free(cache));
+	}
+}
+
 int main(void)
 {
 	UNITY_BEGIN();
@@ -101,5 +312,10 @@ int main(void)
 	RUN_TEST(test_lru_fill);
 	RUN_TEST(test_lru_big_fill);
 	RUN_TEST(test_lru_small_fill);
+	RUN_TEST(test_lru_delete);
+	RUN_TEST(test_lru_random_ops);
+	RUN_TEST(test_lru_evict_ratio);
+	RUN_TEST(test_lru_deferred_flush);
+	RUN_TEST(test_lru_benchmark);
 	return UNITY_END();
 }
@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "module.h"
+#include "flash.h"
+#include "page.h"
+#include "device.h"
+#include "unity.h"
+
+struct flash_device *flash;
+struct page_ftl *pgftl;
+
+static const struct device_operations *orig_d_op;
+static struct device_operations fault_d_op;
+static int nr_erases;
+static int is_journal_fault; /**< fail every write to the journal */
+static int nr_data_faults; /**< fail the next writes to the data segments */
+static size_t fault_segnum; /**< segment of the last failed data write */
+static int is_summary_fault; /**< fail every read of the summary blocks */
+
+void setUp(void)
+{
+	TEST_ASSERT_EQUAL_INT(0, module_init(PAGE_FTL_MODULE, &flash,
+					     RAMDISK_MODULE));
+	TEST_ASSERT_EQUAL_INT(0,
+			      flash->f_op->open(flash, NULL, O_CREAT | O_RDWR));
+	pgftl = (struct page_ftl *)flash->f_private;
+	nr_erases = 0;
+	is_journal_fault = 0;
+	nr_data_faults = 0;
+	is_summary_fault = 0;
+}
+
+void tearDown(void)
+{
+	if (orig_d_op) {
+		pgftl->dev->d_op = orig_d_op;
+		orig_d_op = NULL;
+	}
+	flash->f_op->close(flash);
+	TEST_ASSERT_EQUAL_INT(0, module_exit(flash));
+}
+
+/**
+ * @brief fail the writes selected by the fault flags
+ *
+ * @note
+ * The journal's failed request is released by its completion here, but
+ * the data write's request is left to the caller as the ramdisk does.
+ */
+static ssize_t fault_write(struct device *dev, struct device_request *request)
+{
+	size_t segnum = request->paddr.format.block;
+
+	if (segnum < PAGE_FTL_JOURNAL_NR_SEGMENTS) {
+		if (is_journal_fault) {
+			if (request->end_rq) {
+				request->end_rq(request);
+			}
+			return -EIO;
+		}
+	} else if (nr_data_faults > 0) {
+		nr_data_faults--;
+		fault_segnum = segnum;
+		return -EIO;
+	}
+	return orig_d_op->write(dev, request);
+}
+
+static ssize_t fault_read(struct device *dev, struct device_request *request)
+{
+	size_t page = request->paddr.lpn % device_get_pages_per_segment(dev);
+
+	if (is_summary_fault &&
+	    request->paddr.format.block >= PAGE_FTL_JOURNAL_NR_SEGMENTS &&
+	    page >= page_ftl_get_data_pages(pgftl)) {
+		return -EIO;
+	}
+	return orig_d_op->read(dev, request);
+}
+
+static int fault_count_erase(struct device *dev,
+			     struct device_request *request)
+{
+	nr_erases++;
+	return orig_d_op->erase(dev, request);
+}
+
+static void fault_inject(void)
+{
+	orig_d_op = pgftl->dev->d_op;
+	fault_d_op = *orig_d_op;
+	fault_d_op.write = fault_write;
+	fault_d_op.read = fault_read;
+	fault_d_op.erase = fault_count_erase;
+	pgftl->dev->d_op = &fault_d_op;
+}
+
+void test_flush(void)
+{
+	size_t page_size = device_get_page_size(pgftl->dev);
+	char *buffer = (char *)malloc(page_size);
+
+	TEST_ASSERT_NOT_NULL(buffer);
+	memset(buffer, 0x5a, page_size);
+	TEST_ASSERT_EQUAL_INT((int)page_size,
+			      flash->f_op->write(flash, buffer, page_size, 0));
+	TEST_ASSERT_EQUAL_INT(0,
+			      flash->f_op->ioctl(flash, PAGE_FTL_IOCTL_FLUSH));
+	free(buffer);
+}
+
+/**
+ * @brief the gc must not erase the victim when the journal is not durable
+ */
+void test_flush_failure_stops_gc(void)
+{
+	size_t page_size = device_get_page_size(pgftl->dev);
+	size_t nr_data_pages = page_ftl_get_data_pages(pgftl);
+	char *buffer = (char *)malloc(page_size);
+	size_t lpn;
+
+	TEST_ASSERT_NOT_NULL(buffer);
+	/** fill the first data segment and invalidate a page of it */
+	for (lpn = 0; lpn <= nr_data_pages; lpn++) {
+		memcpy(buffer, &lpn, sizeof(size_t));
+		TEST_ASSERT_EQUAL_INT(
+			(int)page_size,
+			flash->f_op->write(flash, buffer, page_size,
+					   (off_t)(lpn * page_size)));
+	}
+	TEST_ASSERT_EQUAL_INT((int)page_size,
+			      flash->f_op->write(flash, buffer, page_size, 0));
+	TEST_ASSERT_EQUAL_INT(0,
+			      flash->f_op->ioctl(flash, PAGE_FTL_IOCTL_FLUSH));
+
+	is_journal_fault = 1;
+	fault_inject();
+	TEST_ASSERT_TRUE(page_ftl_do_gc(pgftl) < 0);
+	TEST_ASSERT_EQUAL_INT(0, nr_erases);
+	/** the error is sticky */
+	TEST_ASSERT_TRUE(flash->f_op->ioctl(flash, PAGE_FTL_IOCTL_FLUSH) < 0);
+	TEST_ASSERT_EQUAL_INT(0, nr_erases);
+	free(buffer);
+}
+
+/**
+ * @brief the page of a failed write still counts to close its segment
+ */
+void test_write_failure_closes_segment(void)
+{
+	size_t page_size = device_get_page_size(pgftl->dev);
+	size_t nr_data_pages = page_ftl_get_data_pages(pgftl);
+	struct page_ftl_segment *segment;
+	char *buffer = (char *)malloc(page_size);
+	size_t lpn;
+
+	TEST_ASSERT_NOT_NULL(buffer);
+	memset(buffer, 0x5a, page_size);
+	nr_data_faults = 1;
+	fault_inject();
+	TEST_ASSERT_TRUE(flash->f_op->write(flash, buffer, page_size, 0) <= 0);
+	TEST_ASSERT_EQUAL_INT(0, nr_data_faults);
+	segment = &pgftl->segments[fault_segnum];
+	TEST_ASSERT_EQUAL_INT(1, g_atomic_int_get(&segment->nr_written_pages));
+
+	for (lpn = 0; lpn < nr_data_pages - 1; lpn++) {
+		TEST_ASSERT_EQUAL_INT(
+			(int)page_size,
+			flash->f_op->write(flash, buffer, page_size,
+					   (off_t)(lpn * page_size)));
+	}
+	TEST_ASSERT_EQUAL_INT(1, g_atomic_int_get(&segment->is_closed));
+	TEST_ASSERT_EQUAL_INT(1, g_atomic_int_get(&segment->has_summary));
+	free(buffer);
+}
+
+/**
+ * @brief drop the in-memory metadata and rebuild it from the device
+ *
+ * @return return value of the `page_ftl_summary_recovery()`
+ *
+ * @note
+ * The ramdisk keeps its contents, so this is the crash after the flush.
+ */
+static int recover(void)
+{
+	size_t nr_segments = device_get_nr_segments(pgftl->dev);
+	size_t nr_total_pages = device_get_total_pages(pgftl->dev);
+	size_t nr_entries = page_ftl_get_map_size(pgftl) / sizeof(uint32_t);
+	size_t idx;
+	int ret;
+
+	page_ftl_journal_exit(pgftl);
+	for (idx = 0; idx < nr_entries; idx++) {
+		pgftl->trans_map[idx] = PADDR_EMPTY;
+	}
+	for (idx = 0; idx < nr_total_pages; idx++) {
+		pgftl->p2l_map[idx] = PADDR_EMPTY;
+	}
+	for (idx = 0; idx < nr_segments; idx++) {
+		page_ftl_segment_data_init(pgftl, &pgftl->segments[idx]);
+		reset_bit(pgftl->gc_seg_bits, idx);
+	}
+	TEST_ASSERT_EQUAL_INT(0, page_ftl_journal_init(pgftl));
+	ret = page_ftl_summary_recovery(pgftl);
+	if (ret == 0) {
+		TEST_ASSERT_EQUAL_INT(0, page_ftl_journal_start(pgftl));
+	}
+	return ret;
+}
+
+/**
+ * @brief overwrite the LPNs over several segments and flush the mappings
+ *
+ * @return the last written value of each LPN
+ */
+static size_t *write_and_flush(size_t nr_lpns, size_t nr_writes)
+{
+	size_t page_size = device_get_page_size(pgftl->dev);
+	size_t *expected = (size_t *)malloc(nr_lpns * sizeof(size_t));
+	char *buffer = (char *)calloc(1, page_size);
+	size_t i;
+
+	TEST_ASSERT_NOT_NULL(expected);
+	TEST_ASSERT_NOT_NULL(buffer);
+	for (i = 0; i < nr_writes; i++) {
+		size_t lpn = i % nr_lpns;
+		memcpy(buffer, &i, sizeof(size_t));
+		TEST_ASSERT_EQUAL_INT(
+			(int)page_size,
+			flash->f_op->write(flash, buffer, page_size,
+					   (off_t)(lpn * page_size)));
+		expected[lpn] = i;
+	}
+	TEST_ASSERT_EQUAL_INT(0,
+			      flash->f_op->ioctl(flash, PAGE_FTL_IOCTL_FLUSH));
+	free(buffer);
+	return expected;
+}
+
+static void check_read_back(size_t *expected, size_t nr_lpns)
+{
+	size_t page_size = device_get_page_size(pgftl->dev);
+	char *buffer = (char *)malloc(page_size);
+	size_t lpn, value;
+
+	TEST_ASSERT_NOT_NULL(buffer);
+	for (lpn = 0; lpn < nr_lpns; lpn++) {
+		TEST_ASSERT_EQUAL_INT(
+			(int)page_size,
+			flash->f_op->read(flash, buffer, page_size,
+					  (off_t)(lpn * page_size)));
+		memcpy(&value, buffer, sizeof(size_t));
+		TEST_ASSERT_EQUAL_UINT64(expected[lpn], value);
+	}
+	free(buffer);
+}
+
+/**
+ * @brief every flushed LPN is recovered from the summaries and journal
+ */
+void test_recovery(void)
+{
+	size_t nr_data_pages = page_ftl_get_data_pages(pgftl);
+	size_t nr_lpns = nr_data_pages + nr_data_pages / 2;
+	size_t *expected;
+
+	/** the summarized, the sealed open and the erased segments */
+	expected = write_and_flush(nr_lpns, nr_data_pages * 3 + 100);
+	TEST_ASSERT_EQUAL_INT(0, recover());
+	check_read_back(expected, nr_lpns);
+	/** the recovered state is recovered again */
+	TEST_ASSERT_EQUAL_INT(0, recover());
+	check_read_back(expected, nr_lpns);
+	free(expected);
+}
+
+/**
+ * @brief the summary read failure aborts the recovery without the erase
+ */
+void test_recovery_summary_read_failure(void)
+{
+	size_t nr_data_pages = page_ftl_get_data_pages(pgftl);
+	size_t nr_lpns = nr_data_pages + 100;
+	size_t *expected;
+
+	expected = write_and_flush(nr_lpns, nr_lpns);
+	is_summary_fault = 1;
+	fault_inject();
+	TEST_ASSERT_TRUE(recover() < 0);
+	TEST_ASSERT_EQUAL_INT(0, nr_erases);
+
+	is_summary_fault = 0;
+	TEST_ASSERT_EQUAL_INT(0, recover());
+	check_read_back(expected, nr_lpns);
+	free(expected);
+}
+
+int main(void)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_flush);
+	RUN_TEST(test_flush_failure_stops_gc);
+	RUN_TEST(test_write_failure_closes_segment);
+	RUN_TEST(test_recovery);
+	RUN_TEST(test_recovery_summary_read_failure);
+	return UNITY_END();
+}
@@ -188,6 +188,51 @@ void test_erase(void)
 	free(buffer);
 }
 
+void test_erase_reads_zero(void)
+{
+	struct device_request request;
+	struct device_address addr;
+	char *buffer, *zero;
+	size_t page_size;
+
+	TEST_ASSERT_EQUAL_INT(0, dev->d_op->open(dev, NULL, O_CREAT | O_RDWR));
+	page_size = device_get_page_size(dev);
+	buffer = (char *)malloc(page_size);
+	zero = (char *)calloc(1, page_size);
+	TEST_ASSERT_NOT_NULL(buffer);
+	TEST_ASSERT_NOT_NULL(zero);
+
+	addr.lpn = 0;
+	memset(buffer, 0xab, page_size);
+	request.paddr = addr;
+	request.data_len = page_size;
+	request.end_rq = NULL;
+	request.flag = DEVICE_WRITE;
+	request.sector = 0;
+	request.data = buffer;
+	TEST_ASSERT_EQUAL_INT(request.data_len,
+			      dev->d_op->write(dev, &request));
+
+	request.flag = DEVICE_ERASE;
+	TEST_ASSERT_EQUAL_INT(0, dev->d_op->erase(dev, &request));
+
+	/** the erased page and the never written page are read as zero */
+	for (addr.lpn = 0; addr.lpn < 2; addr.lpn++) {
+		memset(buffer, 0xff, page_size);
+		request.paddr = addr;
+		request.data_len = page_size;
+		request.flag = DEVICE_READ;
+		request.data = buffer;
+		TEST_ASSERT_EQUAL_INT(request.data_len,
+				      dev->d_op->read(dev, &request));
+		TEST_ASSERT_EQUAL_MEMORY(zero, buffer, page_size);
+	}
+
+	TEST_ASSERT_EQUAL_INT(0, dev->d_op->close(dev));
+	free(zero);
+	free(buffer);
+}
+
 static void end_rq(struct device_request *request)
 {
 	struct device_address paddr = request->paddr;
@@ -275,6 +320,56 @@ void test_end_rq_works(void)
 	free(is_check);
 }
 
+void test_request_pool_recycles(void)
+{
+	struct device_request *request, *recycled;
+	uint64_t misses;
+
+	request = device_alloc_request(DEVICE_DEFAULT_REQUEST);
+	TEST_ASSERT_NOT_NULL(request);
+	request->flag = DEVICE_READ;
+	request->data_len = 4096;
+	request->end_rq = end_rq;
+	g_atomic_int_set(&request->is_finish, 1);
+	device_free_request(request);
+
+	misses = device_get_request_pool_misses();
+	recycled = device_alloc_request(DEVICE_DEFAULT_REQUEST);
+	TEST_ASSERT_EQUAL_PTR(request, recycled);
+	TEST_ASSERT_EQUAL_UINT64(misses, device_get_request_pool_misses());
+	TEST_ASSERT_EQUAL_UINT(0, recycled->flag);
+	TEST_ASSERT_EQUAL_UINT(0, recycled->data_len);
+	TEST_ASSERT_NULL(recycled->end_rq);
+	TEST_ASSERT_EQUAL_INT(0, g_atomic_int_get(&recycled->is_finish));
+	device_free_request(recycled);
+}
+
+void test_buffer_pool_recycles(void)
+{
+	char *buffer, *recycled;
+	size_t page_size;
+	uint64_t misses;
+	size_t i;
+
+	TEST_ASSERT_EQUAL_INT(0, dev->d_op->open(dev, NULL, O_CREAT | O_RDWR));
+	page_size = device_get_page_size(dev);
+	buffer = (char *)device_alloc_buffer(dev, DEVICE_BUFFER_DEFAULT);
+	TEST_ASSERT_NOT_NULL(buffer);
+	TEST_ASSERT_TRUE(device_is_aligned_buffer(buffer));
+	memset(buffer, 0xff, page_size);
+	device_free_buffer(dev, buffer);
+
+	misses = device_get_buffer_pool_misses();
+	recycled = (char *)device_alloc_buffer(dev, DEVICE_BUFFER_ZERO);
+	TEST_ASSERT_EQUAL_PTR(buffer, recycled);
+	TEST_ASSERT_EQUAL_UINT64(misses, device_get_buffer_pool_misses());
+	for (i = 0; i < page_size; i++) {
+		TEST_ASSERT_EQUAL_INT(0, recycled[i]);
+	}
+	device_free_buffer(dev, recycled);
+	TEST_ASSERT_EQUAL_INT(0, dev->d_op->close(dev));
+}
+
 int main(void)
 {
 	UNITY_BEGIN();
@@ -282,6 +377,9 @@ int main(void)
 	RUN_TEST(test_full_write);
 	RUN_TEST(test_overwrite);
 	RUN_TEST(test_erase);
+	RUN_TEST(test_erase_reads_zero);
 	RUN_TEST(test_end_rq_works);
+	RUN_TEST(test_request_pool_recycles);
+	RUN_TEST(test_buffer_pool_recycles);
 	return UNITY_END();
 }
@@ -0,0 +1,234 @@
+/**
+ * @file cache-2q.c
+ * @brief 2Q policy of the cache
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ *
+ * @note
+ * A new entry waits in the FIFO (A1in) and is evicted from there unless it
+ * is inserted again while its key is remembered in the ghost list (A1out).
+ * Only such entries reach the LRU main queue (Am). So, a one-time scan only
+ * flushes A1in and the hot entries of Am survive.
+ */
+#include "cache.h"
+#include "log.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define CACHE_2Q_IN_RATIO (25) /**< A1in's share of the capacity (%) */
+#define CACHE_2Q_OUT_RATIO (50) /**< keys kept in A1out (% of the capacity) */
+
+/**
+ * @brief queues of the 2Q policy
+ *
+ * @note
+ * The queues are the `lru_cache` without the deallocation function; the
+ * policy moves the entries between them. A1in is used only by the put and
+ * the peek, so its order is FIFO.
+ */
+struct cache_2q {
+	struct lru_cache *in; /**< A1in: FIFO of the new entries */
+	struct lru_cache *main; /**< Am: LRU of the re-referenced entries */
+	struct lru_cache *out; /**< A1out: keys evicted from A1in */
+	size_t nr_in; /**< target size of A1in */
+};
+
+static inline struct cache_2q *cache_2q_get_private(struct cache *cache)
+{
+	return (struct cache_2q *)cache->c_private;
+}
+
+/**
+ * @brief evict an entry from A1in if it exceeds the target, otherwise Am
+ *
+ * @return return value of the deallocation
+ */
+static int cache_2q_evict_one(struct cache *cache)
+{
+	struct cache_2q *q = cache_2q_get_private(cache);
+	uint64_t key;
+	uintptr_t value;
+
+	if (q->in->size > q->nr_in || q->main->size == 0) {
+		lru_pop(q->in, &key, &value);
+		/** the full ghost list forgets the oldest key */
+		lru_put(q->out, key, 1);
+	} else {
+		lru_pop(q->main, &key, &value);
+	}
+	cache->size -= 1;
+	return cache_dealloc(cache, key, value);
+}
+
+static int cache_2q_evict(struct cache *cache, const size_t nr_entries)
+{
+	size_t i;
+	int ret = 0;
+
+	for (i = 0; i < nr_entries && cache->size > 0; i++) {
+		ret = cache_2q_evict_one(cache);
+		if (ret) {
+			break;
+		}
+	}
+	return ret;
+}
+
+/**
+ * @brief replace the value of the resident entry
+ *
+ * @return 1 when the key is resident, negative number for fail
+ */
+static int cache_2q_replace(struct cache *cache, struct lru_cache *queue,
+			    const uint64_t key, uintptr_t value)
+{
+	uintptr_t old = lru_peek(queue, key);
+	int ret;
+
+	if (!old) {
+		return 0;
+	}
+	if (old != value) {
+		ret = cache_dealloc(cache, key, old);
+		if (ret) {
+			return ret;
+		}
+	}
+	ret = lru_put(queue, key, value);
+	return ret ? ret : 1;
+}
+
+static int cache_2q_put(struct cache *cache, const uint64_t key,
+			uintptr_t value)
+{
+	struct cache_2q *q = cache_2q_get_private(cache);
+	struct lru_cache *queue = q->in;
+	int ret;
+
+	ret = cache_2q_replace(cache, q->main, key, value);
+	if (ret == 0) {
+		/** the re-inserted entry restarts in A1in */
+		ret = cache_2q_replace(cache, q->in, key, value);
+	}
+	if (ret) {
+		return ret < 0 ? ret : 0;
+	}
+
+	if (lru_remove(q->out, key, NULL) == 0) {
+		queue = q->main;
+	}
+	if (cache->size >= cache->capacity) {
+		cache_2q_evict_one(cache);
+	}
+	ret = lru_put(queue, key, value);
+	if (ret == 0) {
+		cache->size += 1;
+	}
+	return ret;
+}
+
+static uintptr_t cache_2q_get(struct cache *cache, const uint64_t key)
+{
+	struct cache_2q *q = cache_2q_get_private(cache);
+	uintptr_t value = lru_get(q->main, key);
+
+	return value ? value : lru_peek(q->in, key);
+}
+
+static uintptr_t cache_2q_peek(struct cache *cache, const uint64_t key)
+{
+	struct cache_2q *q = cache_2q_get_private(cache);
+	uintptr_t value = lru_peek(q->main, key);
+
+	return value ? value : lru_peek(q->in, key);
+}
+
+static int cache_2q_delete(struct cache *cache, const uint64_t key)
+{
+	struct cache_2q *q = cache_2q_get_private(cache);
+	uintptr_t value;
+
+	lru_remove(q->out, key, NULL);
+	if (lru_remove(q->main, key, &value) &&
+	    lru_remove(q->in, key, &value)) {
+		return -ENOENT;
+	}
+	cache->size -= 1;
+	return cache_dealloc(cache, key, value);
+}
+
+/**
+ * @brief deallocate the resident entries and free the queue
+ */
+static void cache_2q_free_queue(struct cache *cache, struct lru_cache *queue)
+{
+	uint64_t key;
+	uintptr_t value;
+
+	if (queue == NULL) {
+		return;
+	}
+	while (!lru_pop(queue, &key, &value)) {
+		cache_dealloc(cache, key, value);
+	}
+	lru_free(queue);
+}
+
+static void cache_2q_free(struct cache *cache)
+{
+	struct cache_2q *q = cache_2q_get_private(cache);
+
+	cache_2q_free_queue(cache, q->in);
+	cache_2q_free_queue(cache, q->main);
+	if (q->out) {
+		lru_free(q->out);
+	}
+	free(q);
+	cache->c_private = NULL;
+}
+
+static const struct cache_operations cache_2q_ops = {
+	.put = cache_2q_put,
+	.get = cache_2q_get,
+	.peek = cache_2q_peek,
+	.del = cache_2q_delete,
+	.evict = cache_2q_evict,
+	.free = cache_2q_free,
+};
+
+/**
+ * @brief initialize the 2Q policy
+ *
+ * @param cache cache data structure pointer
+ *
+ * @return 0 for success, negative number for fail
+ */
+int cache_2q_init(struct cache *cache)
+{
+	struct cache_2q *q;
+	size_t nr_out;
+
+	q = (struct cache_2q *)malloc(sizeof(struct cache_2q));
+	if (q == NULL) {
+		return -ENOMEM;
+	}
+	memset(q, 0, sizeof(struct cache_2q));
+	cache->c_private = q;
+
+	q->nr_in = cache->capacity * CACHE_2Q_IN_RATIO / 100;
+	q->nr_in = q->nr_in ? q->nr_in : 1;
+	nr_out = cache->capacity * CACHE_2Q_OUT_RATIO / 100;
+	nr_out = nr_out ? nr_out : 1;
+	q->in = lru_init(cache->capacity, NULL);
+	q->main = lru_init(cache->capacity, NULL);
+	q->out = lru_init(nr_out, NULL);
+	if (q->in == NULL || q->main == NULL || q->out == NULL) {
+		pr_err("memory allocation failed\n");
+		cache_2q_free(cache);
+		return -ENOMEM;
+	}
+	cache->c_op = &cache_2q_ops;
+	return 0;
+}
@@ -0,0 +1,273 @@
+/**
+ * @file cache-arc.c
+ * @brief ARC (adaptive replacement cache) policy of the cache
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ *
+ * @note
+ * T1 keeps the entries seen once and T2 the entries seen again. The keys
+ * evicted from them are remembered in the ghost lists B1 and B2. An insert
+ * which hits a ghost list moves the target size of T1 (`p`) toward the list
+ * which would have kept the entry. So, the split between the recency and
+ * the frequency adapts to the workload and a scan only flushes T1.
+ */
+#include "cache.h"
+#include "log.h"
+
+#include <errno.h>
+#include <string.h>
+
+/**
+ * @brief lists of the ARC policy
+ *
+ * @note
+ * The lists are the `lru_cache` without the deallocation function; the
+ * policy moves the entries between them. The ghost lists have the value 1.
+ */
+struct cache_arc {
+	struct lru_cache *t1; /**< resident, seen once */
+	struct lru_cache *t2; /**< resident, seen twice or more */
+	struct lru_cache *b1; /**< ghost of T1 */
+	struct lru_cache *b2; /**< ghost of T2 */
+	size_t p; /**< target size of T1 */
+};
+
+static inline struct cache_arc *cache_arc_get_private(struct cache *cache)
+{
+	return (struct cache_arc *)cache->c_private;
+}
+
+/**
+ * @brief evict the LRU entry of T1 or T2 to its ghost list
+ *
+ * @param cache cache data structure pointer
+ * @param is_b2_hit the insert which needs the space hit B2
+ *
+ * @return return value of the deallocation
+ */
+static int cache_arc_replace(struct cache *cache, int is_b2_hit)
+{
+	struct cache_arc *arc = cache_arc_get_private(cache);
+	uint64_t key;
+	uintptr_t value;
+
+	if (arc->t1->size > 0 &&
+	    (arc->t1->size > arc->p || (is_b2_hit && arc->t1->size == arc->p) ||
+	     arc->t2->size == 0)) {
+		lru_pop(arc->t1, &key, &value);
+		lru_put(arc->b1, key, 1);
+	} else {
+		lru_pop(arc->t2, &key, &value);
+		lru_put(arc->b2, key, 1);
+	}
+	cache->size -= 1;
+	return cache_dealloc(cache, key, value);
+}
+
+static int cache_arc_evict(struct cache *cache, const size_t nr_entries)
+{
+	size_t i;
+	int ret = 0;
+
+	for (i = 0; i < nr_entries && cache->size > 0; i++) {
+		ret = cache_arc_replace(cache, 0);
+		if (ret) {
+			break;
+		}
+	}
+	return ret;
+}
+
+/**
+ * @brief make the room for the key which is in neither lists nor ghosts
+ *
+ * @note
+ * |T1| + |B1| and the size of the all lists are kept under the capacity and
+ * twice of the capacity, respectively.
+ */
+static void cache_arc_make_room(struct cache *cache)
+{
+	struct cache_arc *arc = cache_arc_get_private(cache);
+	size_t capacity = cache->capacity;
+	size_t nr_l1 = arc->t1->size + arc->b1->size;
+	uint64_t key;
+	uintptr_t value;
+
+	if (nr_l1 >= capacity) {
+		if (arc->t1->size < capacity) {
+			lru_pop(arc->b1, &key, NULL);
+		} else {
+			/** B1 is empty; T1 fills the whole cache */
+			lru_pop(arc->t1, &key, &value);
+			cache->size -= 1;
+			cache_dealloc(cache, key, value);
+			return;
+		}
+	} else if (nr_l1 + arc->t2->size + arc->b2->size >= 2 * capacity) {
+		lru_pop(arc->b2, &key, NULL);
+	}
+	if (cache->size >= capacity) {
+		cache_arc_replace(cache, 0);
+	}
+}
+
+/**
+ * @brief promote the resident entry to T2
+ *
+ * @return value of the entry, 0 when the key isn't resident
+ */
+static uintptr_t cache_arc_promote(struct cache_arc *arc, const uint64_t key)
+{
+	uintptr_t value;
+
+	if (lru_remove(arc->t1, key, &value) == 0) {
+		lru_put(arc->t2, key, value);
+		return value;
+	}
+	return lru_get(arc->t2, key);
+}
+
+static int cache_arc_put(struct cache *cache, const uint64_t key,
+			 uintptr_t value)
+{
+	struct cache_arc *arc = cache_arc_get_private(cache);
+	size_t nr_b1 = arc->b1->size, nr_b2 = arc->b2->size;
+	uintptr_t old;
+	size_t delta;
+	int ret = 0;
+
+	old = cache_arc_promote(arc, key);
+	if (old) {
+		if (old != value) {
+			ret = cache_dealloc(cache, key, old);
+		}
+		lru_put(arc->t2, key, value);
+		return ret;
+	}
+
+	if (lru_remove(arc->b1, key, NULL) == 0) {
+		/** T1 was too small to keep the entry */
+		delta = nr_b2 > nr_b1 ? nr_b2 / nr_b1 : 1;
+		arc->p = arc->p + delta < cache->capacity ? arc->p + delta :
+							    cache->capacity;
+		if (cache->size >= cache->capacity) {
+			cache_arc_replace(cache, 0);
+		}
+		ret = lru_put(arc->t2, key, value);
+	} else if (lru_remove(arc->b2, key, NULL) == 0) {
+		/** T2 was too small to keep the entry */
+		delta = nr_b1 > nr_b2 ? nr_b1 / nr_b2 : 1;
+		arc->p = arc->p > delta ? arc->p - delta : 0;
+		if (cache->size >= cache->capacity) {
+			cache_arc_replace(cache, 1);
+		}
+		ret = lru_put(arc->t2, key, value);
+	} else {
+		cache_arc_make_room(cache);
+		ret = lru_put(arc->t1, key, value);
+	}
+	if (ret == 0) {
+		cache->size += 1;
+	}
+	return ret;
+}
+
+static uintptr_t cache_arc_get(struct cache *cache, const uint64_t key)
+{
+	return cache_arc_promote(cache_arc_get_private(cache), key);
+}
+
+static uintptr_t cache_arc_peek(struct cache *cache, const uint64_t key)
+{
+	struct cache_arc *arc = cache_arc_get_private(cache);
+	uintptr_t value = lru_peek(arc->t1, key);
+
+	return value ? value : lru_peek(arc->t2, key);
+}
+
+static int cache_arc_delete(struct cache *cache, const uint64_t key)
+{
+	struct cache_arc *arc = cache_arc_get_private(cache);
+	uintptr_t value;
+
+	if (lru_remove(arc->t1, key, &value) &&
+	    lru_remove(arc->t2, key, &value)) {
+		lru_remove(arc->b1, key, NULL);
+		lru_remove(arc->b2, key, NULL);
+		return -ENOENT;
+	}
+	cache->size -= 1;
+	return cache_dealloc(cache, key, value);
+}
+
+/**
+ * @brief deallocate the resident entries and free the list
+ */
+static void cache_arc_free_list(struct cache *cache, struct lru_cache *list,
+				int is_ghost)
+{
+	uint64_t key;
+	uintptr_t value;
+
+	if (list == NULL) {
+		return;
+	}
+	while (!is_ghost && !lru_pop(list, &key, &value)) {
+		cache_dealloc(cache, key, value);
+	}
+	lru_free(list);
+}
+
+static void cache_arc_free(struct cache *cache)
+{
+	struct cache_arc *arc = cache_arc_get_private(cache);
+
+	cache_arc_free_list(cache, arc->t1, 0);
+	cache_arc_free_list(cache, arc->t2, 0);
+	cache_arc_free_list(cache, arc->b1, 1);
+	cache_arc_free_list(cache, arc->b2, 1);
+	free(arc);
+	cache->c_private = NULL;
+}
+
+static const struct cache_operations cache_arc_ops = {
+	.put = cache_arc_put,
+	.get = cache_arc_get,
+	.peek = cache_arc_peek,
+	.del = cache_arc_delete,
+	.evict = cache_arc_evict,
+	.free = cache_arc_free,
+};
+
+/**
+ * @brief initialize the ARC policy
+ *
+ * @param cache cache data structure pointer
+ *
+ * @return 0 for success, negative number for fail
+ */
+int cache_arc_init(struct cache *cache)
+{
+	struct cache_arc *arc;
+
+	arc = (struct cache_arc *)malloc(sizeof(struct cache_arc));
+	if (arc == NULL) {
+		return -ENOMEM;
+	}
+	memset(arc, 0, sizeof(struct cache_arc));
+	cache->c_private = arc;
+
+	arc->t1 = lru_init(cache->capacity, NULL);
+	arc->t2 = lru_init(cache->capacity, NULL);
+	arc->b1 = lru_init(cache->capacity, NULL);
+	arc->b2 = lru_init(cache->capacity, NULL);
+	if (arc->t1 == NULL || arc->t2 == NULL || arc->b1 == NULL ||
+	    arc->b2 == NULL) {
+		pr_err("memory allocation failed\n");
+		cache_arc_free(cache);
+		return -ENOMEM;
+	}
+	cache->c_op = &cache_arc_ops;
+	return 0;
+}
@@ -0,0 +1,262 @@
+/**
+ * @file cache-clock.c
+ * @brief CLOCK (second chance) policy of the cache
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ *
+ * @note
+ * The entries live in the fixed slots and a hit only sets the slot's bit in
+ * the reference bitmap. The hand sweeps the bitmap a word at a time; the
+ * referenced slots lose their bit and the first unreferenced one is evicted.
+ */
+#include "cache.h"
+#include "bits.h"
+#include "log.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+
+/**
+ * @brief slots and bitmaps of the CLOCK policy
+ */
+struct cache_clock {
+	struct lru_cache *index; /**< key to the slot + 1 (lookup only) */
+	uint64_t *keys;
+	uintptr_t *values;
+	uint64_t *used; /**< slot has an entry */
+	uint64_t *referenced; /**< slot is hit since the hand passed */
+	uint32_t *free_slots;
+	size_t nr_free;
+	size_t hand;
+};
+
+static inline struct cache_clock *cache_clock_get_private(struct cache *cache)
+{
+	return (struct cache_clock *)cache->c_private;
+}
+
+/**
+ * @brief find the slot of the key
+ *
+ * @return slot number, -1 when the key doesn't exist
+ */
+static inline ssize_t cache_clock_lookup(struct cache_clock *clock,
+					 const uint64_t key)
+{
+	return (ssize_t)lru_peek(clock->index, key) - 1;
+}
+
+/**
+ * @brief move the hand to the victim
+ *
+ * @param cache cache data structure pointer
+ *
+ * @return slot number of the victim
+ *
+ * @note
+ * The cache must not be empty. After a full turn every reference bit is
+ * cleared, so the sweep always finds the victim.
+ */
+static size_t cache_clock_sweep(struct cache *cache)
+{
+	struct cache_clock *clock = cache_clock_get_private(cache);
+
+	while (1) {
+		size_t word = clock->hand / BITS_PER_UINT64;
+		size_t bit = clock->hand % BITS_PER_UINT64;
+		uint64_t mask = (uint64_t)UINT64_MAX << bit;
+		uint64_t candidates =
+			clock->used[word] & ~clock->referenced[word] & mask;
+
+		if (candidates) {
+			size_t victim = (size_t)__builtin_ctzll(candidates);
+			/** second chance of the passed slots is consumed */
+			clock->referenced[word] &=
+				~(mask & (((uint64_t)1 << victim) - 1));
+			victim += word * BITS_PER_UINT64;
+			clock->hand = (victim + 1) % cache->capacity;
+			return victim;
+		}
+		clock->referenced[word] &= ~mask;
+		clock->hand = (word + 1) * BITS_PER_UINT64;
+		if (clock->hand >= cache->capacity) {
+			clock->hand = 0;
+		}
+	}
+}
+
+/**
+ * @brief remove the entry in the slot and return the slot to the free list
+ *
+ * @return return value of the deallocation
+ */
+static int cache_clock_release(struct cache *cache, size_t slot)
+{
+	struct cache_clock *clock = cache_clock_get_private(cache);
+	uint64_t key = clock->keys[slot];
+	uintptr_t value = clock->values[slot];
+
+	lru_remove(clock->index, key, NULL);
+	reset_bit(clock->used, slot);
+	reset_bit(clock->referenced, slot);
+	clock->values[slot] = 0;
+	clock->free_slots[clock->nr_free++] = (uint32_t)slot;
+	cache->size -= 1;
+	return cache_dealloc(cache, key, value);
+}
+
+static int cache_clock_evict(struct cache *cache, const size_t nr_entries)
+{
+	size_t i;
+	int ret = 0;
+
+	for (i = 0; i < nr_entries && cache->size > 0; i++) {
+		ret = cache_clock_release(cache, cache_clock_sweep(cache));
+		if (ret) {
+			break;
+		}
+	}
+	return ret;
+}
+
+static int cache_clock_put(struct cache *cache, const uint64_t key,
+			   uintptr_t value)
+{
+	struct cache_clock *clock = cache_clock_get_private(cache);
+	ssize_t slot = cache_clock_lookup(clock, key);
+	int ret = 0;
+
+	if (slot >= 0) {
+		if (clock->values[slot] != value) {
+			ret = cache_dealloc(cache, key, clock->values[slot]);
+		}
+		clock->values[slot] = value;
+		set_bit(clock->referenced, (uint64_t)slot);
+		return ret;
+	}
+
+	if (cache->size >= cache->capacity) {
+		cache_clock_evict(cache, 1);
+	}
+	slot = (ssize_t)clock->free_slots[--clock->nr_free];
+	ret = lru_put(clock->index, key, (uintptr_t)slot + 1);
+	if (ret) {
+		clock->free_slots[clock->nr_free++] = (uint32_t)slot;
+		return ret;
+	}
+	clock->keys[slot] = key;
+	clock->values[slot] = value;
+	set_bit(clock->used, (uint64_t)slot);
+	cache->size += 1;
+	return 0;
+}
+
+static uintptr_t cache_clock_get(struct cache *cache, const uint64_t key)
+{
+	struct cache_clock *clock = cache_clock_get_private(cache);
+	ssize_t slot = cache_clock_lookup(clock, key);
+
+	if (slot < 0) {
+		return (uintptr_t)NULL;
+	}
+	set_bit(clock->referenced, (uint64_t)slot);
+	return clock->values[slot];
+}
+
+static uintptr_t cache_clock_peek(struct cache *cache, const uint64_t key)
+{
+	struct cache_clock *clock = cache_clock_get_private(cache);
+	ssize_t slot = cache_clock_lookup(clock, key);
+
+	return slot < 0 ? (uintptr_t)NULL : clock->values[slot];
+}
+
+static int cache_clock_delete(struct cache *cache, const uint64_t key)
+{
+	ssize_t slot = cache_clock_lookup(cache_clock_get_private(cache), key);
+
+	if (slot < 0) {
+		return -ENOENT;
+	}
+	return cache_clock_release(cache, (size_t)slot);
+}
+
+static void cache_clock_free(struct cache *cache)
+{
+	struct cache_clock *clock = cache_clock_get_private(cache);
+	size_t slot;
+
+	if (clock == NULL) {
+		return;
+	}
+	for (slot = 0; clock->used && slot < cache->capacity; slot++) {
+		if (get_bit(clock->used, slot)) {
+			cache_dealloc(cache, clock->keys[slot],
+				      clock->values[slot]);
+		}
+	}
+	if (clock->index) {
+		lru_free(clock->index);
+	}
+	free(clock->keys);
+	free(clock->values);
+	free(clock->used);
+	free(clock->referenced);
+	free(clock->free_slots);
+	free(clock);
+	cache->c_private = NULL;
+}
+
+static const struct cache_operations cache_clock_ops = {
+	.put = cache_clock_put,
+	.get = cache_clock_get,
+	.peek = cache_clock_peek,
+	.del = cache_clock_delete,
+	.evict = cache_clock_evict,
+	.free = cache_clock_free,
+};
+
+/**
+ * @brief initialize the CLOCK policy
+ *
+ * @param cache cache data structure pointer
+ *
+ * @return 0 for success, negative number for fail
+ */
+int cache_clock_init(struct cache *cache)
+{
+	struct cache_clock *clock;
+	size_t capacity = cache->capacity;
+	size_t bitmap_size = (size_t)BITS_TO_UINT64_ALIGN(capacity);
+	size_t slot;
+
+	clock = (struct cache_clock *)malloc(sizeof(struct cache_clock));
+	if (clock == NULL) {
+		return -ENOMEM;
+	}
+	memset(clock, 0, sizeof(struct cache_clock));
+	cache->c_private = clock;
+
+	clock->index = lru_init(capacity, NULL);
+	clock->keys = (uint64_t *)malloc(capacity * sizeof(uint64_t));
+	clock->values = (uintptr_t *)calloc(capacity, sizeof(uintptr_t));
+	clock->used = (uint64_t *)calloc(1, bitmap_size);
+	clock->referenced = (uint64_t *)calloc(1, bitmap_size);
+	clock->free_slots = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+	if (clock->index == NULL || clock->keys == NULL ||
+	    clock->values == NULL || clock->used == NULL ||
+	    clock->referenced == NULL || clock->free_slots == NULL) {
+		pr_err("memory allocation failed\n");
+		cache_clock_free(cache);
+		return -ENOMEM;
+	}
+	/** the lower slots are used first */
+	for (slot = 0; slot < capacity; slot++) {
+		clock->free_slots[slot] = (uint32_t)(capacity - slot - 1);
+	}
+	clock->nr_free = capacity;
+	cache->c_op = &cache_clock_ops;
+	return 0;
+}
@@ -0,0 +1,207 @@
+/**
+ * @file cache.c
+ * @brief generic cache interface and the LRU policy
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ */
+#include "cache.h"
+#include "log.h"
+
+#include <errno.h>
+#include <string.h>
+#include <inttypes.h>
+
+static inline struct lru_cache *cache_lru_get_private(struct cache *cache)
+{
+	return (struct lru_cache *)cache->c_private;
+}
+
+static int cache_lru_put(struct cache *cache, const uint64_t key,
+			 uintptr_t value)
+{
+	struct lru_cache *lru = cache_lru_get_private(cache);
+	int ret = lru_put(lru, key, value);
+	cache->size = lru->size;
+	return ret;
+}
+
+static uintptr_t cache_lru_get(struct cache *cache, const uint64_t key)
+{
+	return lru_get(cache_lru_get_private(cache), key);
+}
+
+static uintptr_t cache_lru_peek(struct cache *cache, const uint64_t key)
+{
+	return lru_peek(cache_lru_get_private(cache), key);
+}
+
+static int cache_lru_delete(struct cache *cache, const uint64_t key)
+{
+	struct lru_cache *lru = cache_lru_get_private(cache);
+	int ret = lru_delete(lru, key);
+	cache->size = lru->size;
+	return ret;
+}
+
+static int cache_lru_evict(struct cache *cache, const size_t nr_entries)
+{
+	struct lru_cache *lru = cache_lru_get_private(cache);
+	int ret = lru_evict(lru, nr_entries);
+	cache->size = lru->size;
+	return ret;
+}
+
+static void cache_lru_free(struct cache *cache)
+{
+	lru_free(cache_lru_get_private(cache));
+	cache->c_private = NULL;
+}
+
+static const struct cache_operations cache_lru_ops = {
+	.put = cache_lru_put,
+	.get = cache_lru_get,
+	.peek = cache_lru_peek,
+	.del = cache_lru_delete,
+	.evict = cache_lru_evict,
+	.free = cache_lru_free,
+};
+
+/**
+ * @brief initialize the LRU policy which is the `lru_cache`
+ *
+ * @param cache cache data structure pointer
+ *
+ * @return 0 for success, negative number for fail
+ */
+static int cache_lru_init(struct cache *cache)
+{
+	cache->c_private = lru_init(cache->capacity, cache->deallocate);
+	if (cache->c_private == NULL) {
+		return -ENOMEM;
+	}
+	cache->c_op = &cache_lru_ops;
+	return 0;
+}
+
+/**
+ * @brief policy list table
+ *
+ * @note
+ * You must follow the policy index in the `cache.h`
+ */
+static int (*cache_policy_init[])(struct cache *) = {
+	/* [CACHE_POLICY_LRU] = */ cache_lru_init,
+	/* [CACHE_POLICY_CLOCK] = */ cache_clock_init,
+	/* [CACHE_POLICY_2Q] = */ cache_2q_init,
+	/* [CACHE_POLICY_ARC] = */ cache_arc_init,
+};
+
+static const char *cache_policy_name[] = {
+	"lru",
+	"clock",
+	"2q",
+	"arc",
+};
+
+/**
+ * @brief initialize the cache of the policy
+ *
+ * @param policy policy number described in the `cache.h`
+ * @param capacity maximum number of the resident entries
+ * @param deallocate deallocation function of the evicted value
+ *
+ * @return pointer of the cache, NULL for fail
+ */
+struct cache *cache_init(const int policy, const size_t capacity,
+			 lru_dealloc_fn deallocate)
+{
+	struct cache *cache;
+	int err;
+
+	if (policy < 0 || policy >= NR_CACHE_POLICY || capacity == 0) {
+		pr_err("invalid cache (policy: %d, capacity: %zu)\n", policy,
+		       capacity);
+		return NULL;
+	}
+	cache = (struct cache *)malloc(sizeof(struct cache));
+	if (cache == NULL) {
+		pr_err("memory allocation failed\n");
+		return NULL;
+	}
+	memset(cache, 0, sizeof(struct cache));
+	cache->policy = policy;
+	cache->capacity = capacity;
+	cache->deallocate = deallocate;
+
+	err = cache_policy_init[policy](cache);
+	if (err) {
+		pr_err("%s cache initialization failed (err: %d)\n",
+		       cache_policy_name[policy], err);
+		free(cache);
+		return NULL;
+	}
+	return cache;
+}
+
+/**
+ * @brief get the name of the policy
+ *
+ * @param policy policy number described in the `cache.h`
+ *
+ * @return name of the policy, NULL for the invalid policy
+ */
+const char *cache_get_policy_name(const int policy)
+{
+	if (policy < 0 || policy >= NR_CACHE_POLICY) {
+		return NULL;
+	}
+	return cache_policy_name[policy];
+}
+
+/**
+ * @brief get the policy number from its name
+ *
+ * @param name name of the policy (e.g., "arc")
+ *
+ * @return policy number, -EINVAL for the unknown name
+ */
+int cache_get_policy(const char *name)
+{
+	int policy;
+	for (policy = 0; policy < NR_CACHE_POLICY; policy++) {
+		if (!strcmp(name, cache_policy_name[policy])) {
+			return policy;
+		}
+	}
+	return -EINVAL;
+}
+
+/**
+ * @brief deallocate the value which leaves the cache
+ *
+ * @param cache cache data structure pointer
+ * @param key key of the value
+ * @param value value to deallocate
+ *
+ * @return 0 for success
+ *
+ * @note
+ * The policies except the LRU don't have the flusher. So, the deferred
+ * deallocation is an error for them.
+ */
+int cache_dealloc(struct cache *cache, const uint64_t key, uintptr_t value)
+{
+	int ret;
+
+	if (cache->deallocate == NULL) {
+		return 0;
+	}
+	ret = cache->deallocate(key, value);
+	if (ret == LRU_DEALLOC_DEFER) {
+		pr_err("deferred without the flusher (key: %" PRIu64 ")\n",
+		       key);
+		ret = -EINVAL;
+	}
+	return ret;
+}
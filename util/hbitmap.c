@@ -0,0 +1,298 @@
+/**
+ * @file hbitmap.c
+ * @brief hierarchical bitmap which has the summary levels
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ */
+#include "hbitmap.h"
+#include "log.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief get the mask of the valid bits in the level's word
+ */
+static inline uint64_t hbitmap_word_mask(struct hbitmap *hbitmap, int level,
+					 uint64_t word)
+{
+	uint64_t nr_bits = hbitmap->level_bits[level];
+
+	if (word == (nr_bits - 1) / BITS_PER_UINT64 &&
+	    nr_bits % BITS_PER_UINT64) {
+		return ((uint64_t)0x1 << (nr_bits % BITS_PER_UINT64)) - 1;
+	}
+	return (uint64_t)UINT64_MAX;
+}
+
+/**
+ * @brief set the summary bits of the word from the level 1
+ *
+ * @param hbitmap pointer of the hierarchical bitmap
+ * @param levels `any` or `full` levels
+ * @param index word position in the level 0
+ *
+ * @note
+ * The bit of the upper level is set only when the word changes its state.
+ */
+static void hbitmap_set_summary(struct hbitmap *hbitmap, uint64_t **levels,
+				uint64_t index)
+{
+	int is_full = levels == hbitmap->full;
+	int level;
+
+	for (level = 1; level < hbitmap->nr_levels; level++) {
+		uint64_t word = BITS_TO_UINT64(index);
+		uint64_t old = levels[level][word];
+
+		set_bit(levels[level], index);
+		if (is_full ? levels[level][word] !=
+				      hbitmap_word_mask(hbitmap, level, word) :
+			      old != 0) {
+			break;
+		}
+		index = word;
+	}
+}
+
+/**
+ * @brief reset the summary bits of the word from the level 1
+ *
+ * @param hbitmap pointer of the hierarchical bitmap
+ * @param levels `any` or `full` levels
+ * @param index word position in the level 0
+ */
+static void hbitmap_reset_summary(struct hbitmap *hbitmap, uint64_t **levels,
+				  uint64_t index)
+{
+	int is_full = levels == hbitmap->full;
+	int level;
+
+	for (level = 1; level < hbitmap->nr_levels; level++) {
+		uint64_t word = BITS_TO_UINT64(index);
+		uint64_t old = levels[level][word];
+
+		reset_bit(levels[level], index);
+		if (is_full ? old != hbitmap_word_mask(hbitmap, level, word) :
+			      levels[level][word] != 0) {
+			break;
+		}
+		index = word;
+	}
+}
+
+/**
+ * @brief set the index position bit
+ *
+ * @param hbitmap pointer of the hierarchical bitmap
+ * @param index set position
+ */
+void hbitmap_set_bit(struct hbitmap *hbitmap, uint64_t index)
+{
+	uint64_t *bits = hbitmap->any[0];
+	uint64_t word = BITS_TO_UINT64(index);
+	uint64_t old = bits[word];
+
+	set_bit(bits, index);
+	if (old == bits[word]) {
+		return;
+	}
+	if (old == 0) {
+		hbitmap_set_summary(hbitmap, hbitmap->any, word);
+	}
+	if (bits[word] == hbitmap_word_mask(hbitmap, 0, word)) {
+		hbitmap_set_summary(hbitmap, hbitmap->full, word);
+	}
+}
+
+/**
+ * @brief reset the index position bit
+ *
+ * @param hbitmap pointer of the hierarchical bitmap
+ * @param index reset position
+ */
+void hbitmap_reset_bit(struct hbitmap *hbitmap, uint64_t index)
+{
+	uint64_t *bits = hbitmap->any[0];
+	uint64_t word = BITS_TO_UINT64(index);
+	uint64_t old = bits[word];
+
+	reset_bit(bits, index);
+	if (old == bits[word]) {
+		return;
+	}
+	if (old == hbitmap_word_mask(hbitmap, 0, word)) {
+		hbitmap_reset_summary(hbitmap, hbitmap->full, word);
+	}
+	if (bits[word] == 0) {
+		hbitmap_reset_summary(hbitmap, hbitmap->any, word);
+	}
+}
+
+/**
+ * @brief get the bits of the word which can lead to the target bit
+ */
+static inline uint64_t hbitmap_get_candidates(struct hbitmap *hbitmap,
+					      int value, int level,
+					      uint64_t word)
+{
+	if (value) {
+		return hbitmap->any[level][word];
+	}
+	return ~hbitmap->full[level][word] &
+	       hbitmap_word_mask(hbitmap, level, word);
+}
+
+/**
+ * @brief find the first bit which has the value from the idx
+ *
+ * @param hbitmap pointer of the hierarchical bitmap
+ * @param idx start position bit
+ * @param value 1 for the one bit, 0 for the zero bit
+ *
+ * @return bit position, BITS_NOT_FOUND when it doesn't exist
+ *
+ * @note
+ * It climbs while the rest of the word has no candidate and then descends
+ * to the first candidate of each lower word.
+ */
+static uint64_t hbitmap_find(struct hbitmap *hbitmap, uint64_t idx, int value)
+{
+	uint64_t candidates;
+	int level = 0;
+
+	if (idx >= hbitmap->nr_bits) {
+		return BITS_NOT_FOUND;
+	}
+	while (1) {
+		uint64_t word = BITS_TO_UINT64(idx);
+
+		candidates = hbitmap_get_candidates(hbitmap, value, level,
+						    word) &
+			     ((uint64_t)UINT64_MAX << (idx % BITS_PER_UINT64));
+		if (candidates) {
+			idx = word * BITS_PER_UINT64 +
+			      (uint64_t)__builtin_ctzll(candidates);
+			break;
+		}
+		/** the next word is the next bit of the upper level */
+		idx = word + 1;
+		level += 1;
+		if (level == hbitmap->nr_levels ||
+		    idx >= hbitmap->level_bits[level]) {
+			return BITS_NOT_FOUND;
+		}
+	}
+	while (level > 0) {
+		level -= 1;
+		candidates = hbitmap_get_candidates(hbitmap, value, level, idx);
+		idx = idx * BITS_PER_UINT64 +
+		      (uint64_t)__builtin_ctzll(candidates);
+	}
+	return idx;
+}
+
+/**
+ * @brief find first one bit from the idx
+ *
+ * @param hbitmap pointer of the hierarchical bitmap
+ * @param idx start position bit
+ *
+ * @return first one bit position
+ */
+uint64_t hbitmap_find_first_one_bit(struct hbitmap *hbitmap, uint64_t idx)
+{
+	return hbitmap_find(hbitmap, idx, 1);
+}
+
+/**
+ * @brief find first zero bit from the idx
+ *
+ * @param hbitmap pointer of the hierarchical bitmap
+ * @param idx start position bit
+ *
+ * @return first zero bit position
+ */
+uint64_t hbitmap_find_first_zero_bit(struct hbitmap *hbitmap, uint64_t idx)
+{
+	return hbitmap_find(hbitmap, idx, 0);
+}
+
+/**
+ * @brief allocate the hierarchical bitmap whose bits are all zero
+ *
+ * @param nr_bits bitmap's size (the number of bits NOT bytes)
+ *
+ * @return pointer of the hierarchical bitmap, NULL for fail
+ */
+struct hbitmap *hbitmap_init(uint64_t nr_bits)
+{
+	struct hbitmap *hbitmap;
+	int level;
+
+	if (nr_bits == 0) {
+		pr_err("empty bitmap is not permitted\n");
+		return NULL;
+	}
+	hbitmap = (struct hbitmap *)malloc(sizeof(struct hbitmap));
+	if (hbitmap == NULL) {
+		pr_err("memory allocation failed\n");
+		return NULL;
+	}
+	memset(hbitmap, 0, sizeof(struct hbitmap));
+	hbitmap->nr_bits = nr_bits;
+
+	hbitmap->level_bits[0] = nr_bits;
+	for (level = 0; hbitmap->level_bits[level] > BITS_PER_UINT64;
+	     level++) {
+		hbitmap->level_bits[level + 1] =
+			(hbitmap->level_bits[level] + BITS_PER_UINT64 - 1) /
+			BITS_PER_UINT64;
+	}
+	hbitmap->nr_levels = level + 1;
+
+	hbitmap->any[0] = (uint64_t *)calloc(
+		1, (size_t)BITS_TO_UINT64_ALIGN(hbitmap->level_bits[0]));
+	hbitmap->full[0] = hbitmap->any[0];
+	if (hbitmap->any[0] == NULL) {
+		goto exception;
+	}
+	for (level = 1; level < hbitmap->nr_levels; level++) {
+		size_t size = (size_t)BITS_TO_UINT64_ALIGN(
+			hbitmap->level_bits[level]);
+		hbitmap->any[level] = (uint64_t *)calloc(1, size);
+		hbitmap->full[level] = (uint64_t *)calloc(1, size);
+		if (hbitmap->any[level] == NULL ||
+		    hbitmap->full[level] == NULL) {
+			goto exception;
+		}
+	}
+	return hbitmap;
+
+exception:
+	pr_err("memory allocation failed\n");
+	hbitmap_free(hbitmap);
+	return NULL;
+}
+
+/**
+ * @brief free the hierarchical bitmap
+ *
+ * @param hbitmap pointer of the hierarchical bitmap
+ */
+void hbitmap_free(struct hbitmap *hbitmap)
+{
+	int level;
+
+	if (hbitmap == NULL) {
+		return;
+	}
+	free(hbitmap->any[0]);
+	for (level = 1; level < HBITMAP_MAX_LEVELS; level++) {
+		free(hbitmap->any[level]);
+		free(hbitmap->full[level]);
+	}
+	free(hbitmap);
+}
@@ -7,13 +7,107 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "log.h"
 #include "lru.h"
 
+/**
+ * @brief background thread which releases the deferred entries
+ *
+ * @note
+ * A deferred node leaves the list and the index, but it goes back to the
+ * arena only after the flush. So, the number of the pending entries is
+ * bounded by the capacity, and the insertion waits for the flusher when
+ * the whole arena is pending.
+ */
+struct lru_flusher {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond; /**< wake up the flusher */
+	pthread_cond_t done_cond; /**< wake up the waiters of the flush */
+	lru_dealloc_fn flush;
+	struct lru_node *pending; /**< deferred nodes (FIFO) */
+	struct lru_node *pending_tail;
+	struct lru_node *flushed; /**< flushed nodes to return to the arena */
+	size_t nr_pending; /**< deferred nodes which are not flushed yet */
+	int is_exit;
+};
+
+/**
+ * @brief flush the deferred entries in the order of eviction
+ *
+ * @param data pointer of the flusher
+ *
+ * @return always NULL
+ */
+static void *lru_flusher_thread(void *data)
+{
+	struct lru_flusher *flusher = (struct lru_flusher *)data;
+
+	pthread_mutex_lock(&flusher->mutex);
+	while (1) {
+		struct lru_node *list, *node, *last;
+		size_t nr_nodes = 0;
+
+		while (flusher->pending == NULL && !flusher->is_exit) {
+			pthread_cond_wait(&flusher->cond, &flusher->mutex);
+		}
+		if (flusher->pending == NULL) {
+			break;
+		}
+		list = flusher->pending;
+		flusher->pending = flusher->pending_tail = NULL;
+		pthread_mutex_unlock(&flusher->mutex);
+
+		last = NULL;
+		for (node = list; node; node = node->next) {
+			int ret = flusher->flush(node->key, node->value);
+			if (ret) {
+				pr_err("flush failed (key: %" PRIu64
+				       ", ret: %d)\n",
+				       node->key, ret);
+			}
+			last = node;
+			nr_nodes++;
+		}
+
+		pthread_mutex_lock(&flusher->mutex);
+		last->next = flusher->flushed;
+		flusher->flushed = list;
+		flusher->nr_pending -= nr_nodes;
+		pthread_cond_broadcast(&flusher->done_cond);
+	}
+	pthread_mutex_unlock(&flusher->mutex);
+	return NULL;
+}
+
+/**
+ * @brief hand the evicted node to the flusher
+ *
+ * @param flusher pointer of the flusher
+ * @param node node which is removed from the list and the index
+ */
+static void lru_flusher_push(struct lru_flusher *flusher,
+			     struct lru_node *node)
+{
+	node->next = NULL;
+	pthread_mutex_lock(&flusher->mutex);
+	if (flusher->pending_tail) {
+		flusher->pending_tail->next = node;
+	} else {
+		flusher->pending = node;
+	}
+	flusher->pending_tail = node;
+	flusher->nr_pending++;
+	pthread_cond_signal(&flusher->cond);
+	pthread_mutex_unlock(&flusher->mutex);
+}
+
 /**
  * @brief initialize the LRU cache data strcture
  *
@@ -25,21 +119,54 @@
 struct lru_cache *lru_init(const size_t capacity, lru_dealloc_fn deallocate)
 {
 	struct lru_cache *cache = NULL;
+	size_t nr_slots;
+	size_t i;
 	if (capacity == 0) {
 		pr_err("capacity is zero\n");
 		goto exception;
 	}
+	if (capacity >= LRU_INDEX_EMPTY) {
+		pr_err("capacity is too large (capacity: %zu)\n", capacity);
+		goto exception;
+	}
 
 	cache = (struct lru_cache *)malloc(sizeof(struct lru_cache));
 	if (cache == NULL) {
 		pr_err("memory allocation failed\n");
 		goto exception;
 	}
+	memset(cache, 0, sizeof(struct lru_cache));
+
+	cache->nodes = (struct lru_node *)malloc(capacity *
+						 sizeof(struct lru_node));
+	if (cache->nodes == NULL) {
+		pr_err("node arena allocation failed\n");
+		goto exception;
+	}
+	cache->free_nodes = NULL;
+	for (i = capacity; i > 0; i--) {
+		cache->nodes[i - 1].next = cache->free_nodes;
+		cache->free_nodes = &cache->nodes[i - 1];
+	}
+
+	nr_slots = 1;
+	while (nr_slots < 2 * capacity) {
+		nr_slots <<= 1;
+	}
+	cache->index = (uint32_t *)malloc(nr_slots * sizeof(uint32_t));
+	if (cache->index == NULL) {
+		pr_err("index allocation failed\n");
+		goto exception;
+	}
+	memset(cache->index, 0xff, nr_slots * sizeof(uint32_t));
+	cache->index_mask = nr_slots - 1;
 
 	cache->head = &cache->nil;
 	cache->deallocate = deallocate;
 	cache->capacity = capacity;
 	cache->size = 0;
+	cache->evict_size = LRU_DEFAULT_EVICT_SIZE;
+	cache->flusher = NULL;
 
 	cache->nil.next = &cache->nil;
 	cache->nil.prev = &cache->nil;
@@ -52,22 +179,105 @@ exception:
 	return NULL;
 }
 
+/**
+ * @brief get the home slot of the key in the index
+ *
+ * @param cache LRU cache data structure pointer
+ * @param key key which identifies the node
+ *
+ * @return slot number of the index
+ */
+static inline size_t lru_index_hash(struct lru_cache *cache,
+				    const uint64_t key)
+{
+	uint64_t hash = key;
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	return (size_t)hash & cache->index_mask;
+}
+
+/**
+ * @brief find the index slot which has the key
+ *
+ * @param cache LRU cache data structure pointer
+ * @param key key which identifies the node
+ *
+ * @return slot number of the key, or the empty slot where the key would be
+ */
+static size_t lru_index_lookup(struct lru_cache *cache, const uint64_t key)
+{
+	size_t slot = lru_index_hash(cache, key);
+	while (cache->index[slot] != LRU_INDEX_EMPTY &&
+	       cache->nodes[cache->index[slot]].key != key) {
+		slot = (slot + 1) & cache->index_mask;
+	}
+	return slot;
+}
+
+/**
+ * @brief empty the index slot
+ *
+ * @param cache LRU cache data structure pointer
+ * @param slot slot which contains the deleted node
+ *
+ * @note
+ * The following entries of the probe sequence are shifted back, so the
+ * index doesn't need the tombstones.
+ */
+static void lru_index_remove(struct lru_cache *cache, size_t slot)
+{
+	size_t next = slot;
+	while (1) {
+		size_t home;
+		next = (next + 1) & cache->index_mask;
+		if (cache->index[next] == LRU_INDEX_EMPTY) {
+			break;
+		}
+		home = lru_index_hash(cache,
+				      cache->nodes[cache->index[next]].key);
+		/** move the entry when its home is not in (slot, next] */
+		if (((next - home) & cache->index_mask) >=
+		    ((next - slot) & cache->index_mask)) {
+			cache->index[slot] = cache->index[next];
+			slot = next;
+		}
+	}
+	cache->index[slot] = LRU_INDEX_EMPTY;
+}
+
 /**
  * @brief allocate the single node
  *
+ * @param cache LRU cache data structure pointer
  * @param key key for identify the node
  * @param value value for data in the node
  *
  * @return allocated node structure pointer
  */
-static struct lru_node *lru_alloc_node(const uint64_t key, uintptr_t value)
+static struct lru_node *lru_alloc_node(struct lru_cache *cache,
+				       const uint64_t key, uintptr_t value)
 {
+	struct lru_flusher *flusher = cache->flusher;
 	struct lru_node *node;
-	node = (struct lru_node *)malloc(sizeof(struct lru_node));
+
+	if (cache->free_nodes == NULL && flusher) {
+		/** take back the flushed nodes; wait if none is flushed yet */
+		pthread_mutex_lock(&flusher->mutex);
+		while (flusher->flushed == NULL && flusher->nr_pending > 0) {
+			pthread_cond_wait(&flusher->done_cond, &flusher->mutex);
+		}
+		cache->free_nodes = flusher->flushed;
+		flusher->flushed = NULL;
+		pthread_mutex_unlock(&flusher->mutex);
+	}
+
+	node = cache->free_nodes;
 	if (node == NULL) {
 		pr_err("node allocation failed\n");
 		return NULL;
 	}
+	cache->free_nodes = node->next;
 	node->key = key;
 	node->value = value;
 	return node;
@@ -76,16 +286,18 @@ static struct lru_node *lru_alloc_node(const uint64_t key, uintptr_t value)
 /**
  * @brief deallcate the allocated node
  *
+ * @param cache LRU cache data structure pointer
  * @param node node which wants to deallocate
  */
-static void lru_dealloc_node(struct lru_node *node)
+static void lru_dealloc_node(struct lru_cache *cache, struct lru_node *node)
 {
 	assert(NULL != node);
 #if 0
 	pr_debug("deallcate the node (key: %ld, value: %ld)\n", node->key,
 		 node->value); /**< Not recommend to print this line */
 #endif
-	free(node);
+	node->next = cache->free_nodes;
+	cache->free_nodes = node;
 }
 
 /**
@@ -115,6 +327,36 @@ static int lru_delete_node(struct lru_node *head, struct lru_node *deleted)
 	return 0;
 }
 
+/**
+ * @brief release the value of the node which is removed from the cache
+ *
+ * @param cache LRU cache data structure pointer
+ * @param node node which is removed from the list and the index
+ *
+ * @return 0 for success
+ *
+ * @note
+ * The node returns to the arena unless the deallocation is deferred.
+ */
+static int lru_release_node(struct lru_cache *cache, struct lru_node *node)
+{
+	int ret = 0;
+	if (cache->deallocate) {
+		ret = cache->deallocate(node->key, node->value);
+	}
+	if (ret == LRU_DEALLOC_DEFER) {
+		if (cache->flusher) {
+			lru_flusher_push(cache->flusher, node);
+			return 0;
+		}
+		pr_err("deferred without the flusher (key: %" PRIu64 ")\n",
+		       node->key);
+		ret = -EINVAL;
+	}
+	lru_dealloc_node(cache, node);
+	return ret;
+}
+
 /**
  * @brief implementation of the LRU eviction function
  *
@@ -126,13 +368,9 @@ static int __lru_do_evict(struct lru_cache *cache)
 {
 	struct lru_node *head = cache->head;
 	struct lru_node *target = head->prev;
-	int ret = 0;
 	lru_delete_node(head, target);
-	if (cache->deallocate) {
-		ret = cache->deallocate(target->key, target->value);
-	}
-	lru_dealloc_node(target);
-	return ret;
+	lru_index_remove(cache, lru_index_lookup(cache, target->key));
+	return lru_release_node(cache, target);
 }
 
 /**
@@ -147,12 +385,12 @@ static int lru_do_evict(struct lru_cache *cache, const uint64_t nr_evict)
 {
 	int ret = 0;
 	uint64_t i;
-	for (i = 0; i < nr_evict; i++) {
+	for (i = 0; i < nr_evict && cache->size > 0; i++) {
 		ret = __lru_do_evict(cache);
+		cache->size -= 1;
 		if (ret) {
 			return ret;
 		}
-		cache->size -= 1;
 	}
 	return ret;
 }
@@ -174,6 +412,24 @@ static void lru_node_insert(struct lru_node *node, struct lru_node *newnode)
 	node->next = newnode;
 }
 
+/**
+ * @brief find the node based on the key
+ *
+ * @param cache LRU cache data structure pointer
+ * @param key key which identifies the node
+ *
+ * @return pointer of the node
+ */
+static struct lru_node *lru_find_node(struct lru_cache *cache,
+				      const uint64_t key)
+{
+	size_t slot = lru_index_lookup(cache, key);
+	if (cache->index[slot] == LRU_INDEX_EMPTY) {
+		return NULL;
+	}
+	return &cache->nodes[cache->index[slot]];
+}
+
 /**
  * @brief inser the key, value to the LRU cache
  *
@@ -182,51 +438,53 @@ static void lru_node_insert(struct lru_node *node, struct lru_node *newnode)
  * @param value value which contains the data
  *
  * @return 0 to success
+ *
+ * @note
+ * If the key already exists, its previous value is deallocated and replaced.
+ * The previous value is released inline. If its deallocation is deferred,
+ * the flush function is called inline, too.
  */
 int lru_put(struct lru_cache *cache, const uint64_t key, uintptr_t value)
 {
 	struct lru_node *head = cache->head;
 	struct lru_node *node = NULL;
+	int ret = 0;
 	assert(NULL != head);
 
+	node = lru_find_node(cache, key);
+	if (node) {
+		if (cache->deallocate && node->value != value) {
+			ret = cache->deallocate(node->key, node->value);
+		}
+		if (ret == LRU_DEALLOC_DEFER && cache->flusher) {
+			ret = cache->flusher->flush(node->key, node->value);
+		} else if (ret == LRU_DEALLOC_DEFER) {
+			ret = -EINVAL;
+		}
+		node->value = value;
+		lru_delete_node(head, node);
+		lru_node_insert(head, node);
+		return ret;
+	}
+
 	if (cache->size >= cache->capacity) {
 		pr_debug("eviction is called (size: %zu, cap: %zu)\n",
 			 cache->size, cache->capacity);
 		lru_do_evict(cache, lru_get_evict_size(cache));
 	}
 
-	node = lru_alloc_node(key, value);
+	node = lru_alloc_node(cache, key, value);
 	if (node == NULL) {
 		pr_err("memory allocation failed\n");
 		return -ENOMEM;
 	}
 	lru_node_insert(head, node);
+	cache->index[lru_index_lookup(cache, key)] =
+		(uint32_t)(node - cache->nodes);
 	cache->size += 1;
 	return 0;
 }
 
-/**
- * @brief find the node based on the key
- *
- * @param cache LRU cache data structure pointer
- * @param key key which identifies the node
- *
- * @return pointer of the node
- */
-static struct lru_node *lru_find_node(struct lru_cache *cache,
-				      const uint64_t key)
-{
-	struct lru_node *head = cache->head;
-	struct lru_node *it = head->next;
-	while (it != head) {
-		if (it->key == key) {
-			return it;
-		}
-		it = it->next;
-	}
-	return NULL;
-}
-
 /**
  * @brief get data from the LRU cache
  *
@@ -251,6 +509,117 @@ uintptr_t lru_get(struct lru_cache *cache, const uint64_t key)
 	return value;
 }
 
+/**
+ * @brief get data from the LRU cache without changing the order
+ *
+ * @param cache LRU cache data structrue pointer
+ * @param key key which identifies the node
+ *
+ * @return data in the node's value (0 when the key doesn't exist)
+ *
+ * @note
+ * This doesn't modify the cache. So, the concurrent peeks are safe.
+ */
+uintptr_t lru_peek(struct lru_cache *cache, const uint64_t key)
+{
+	struct lru_node *node = lru_find_node(cache, key);
+	return node ? node->value : (uintptr_t)NULL;
+}
+
+/**
+ * @brief delete the entry from the LRU cache
+ *
+ * @param cache LRU cache data structure pointer
+ * @param key key which identifies the node
+ *
+ * @return 0 to success, -ENOENT when the key doesn't exist
+ *
+ * @note
+ * The value is deallocated by the cache's deallocation function.
+ */
+int lru_delete(struct lru_cache *cache, const uint64_t key)
+{
+	struct lru_node *node;
+	size_t slot;
+	int ret = 0;
+
+	slot = lru_index_lookup(cache, key);
+	if (cache->index[slot] == LRU_INDEX_EMPTY) {
+		return -ENOENT;
+	}
+	node = &cache->nodes[cache->index[slot]];
+	lru_delete_node(cache->head, node);
+	lru_index_remove(cache, slot);
+	ret = lru_release_node(cache, node);
+	cache->size -= 1;
+	return ret;
+}
+
+/**
+ * @brief remove the entry without deallocating its value
+ *
+ * @param cache LRU cache data structure pointer
+ * @param key key which identifies the node
+ * @param value pointer which receives the removed value (can be NULL)
+ *
+ * @return 0 to success, -ENOENT when the key doesn't exist
+ *
+ * @note
+ * This is for moving the entry to the other cache.
+ */
+int lru_remove(struct lru_cache *cache, const uint64_t key, uintptr_t *value)
+{
+	struct lru_node *node;
+	size_t slot;
+
+	slot = lru_index_lookup(cache, key);
+	if (cache->index[slot] == LRU_INDEX_EMPTY) {
+		return -ENOENT;
+	}
+	node = &cache->nodes[cache->index[slot]];
+	if (value) {
+		*value = node->value;
+	}
+	lru_delete_node(cache->head, node);
+	lru_index_remove(cache, slot);
+	lru_dealloc_node(cache, node);
+	cache->size -= 1;
+	return 0;
+}
+
+/**
+ * @brief remove the least recently used entry without deallocating its value
+ *
+ * @param cache LRU cache data structure pointer
+ * @param key pointer which receives the removed key
+ * @param value pointer which receives the removed value (can be NULL)
+ *
+ * @return 0 to success, -ENOENT when the cache is empty
+ */
+int lru_pop(struct lru_cache *cache, uint64_t *key, uintptr_t *value)
+{
+	struct lru_node *target = cache->head->prev;
+
+	if (target == cache->head) {
+		return -ENOENT;
+	}
+	*key = target->key;
+	return lru_remove(cache, target->key, value);
+}
+
+/**
+ * @brief evict the least recently used entries
+ *
+ * @param cache LRU cache data structure pointer
+ * @param nr_entries number of the entries to evict
+ *
+ * @return 0 to success
+ */
+int lru_evict(struct lru_cache *cache, const size_t nr_entries)
+{
+	return lru_do_evict(cache, nr_entries);
+}
+
 /**
  * @brief deallocate the LRU cache structure
  *
@@ -268,22 +637,144 @@ int lru_free(struct lru_cache *cache)
 		return ret;
 	}
 	head = cache->head;
-	node = head->next;
+	node = head ? head->next : NULL; /**< NULL when the init failed */
 	while (node != head) {
 		assert(NULL != node);
 		next = node->next;
-		if (cache->deallocate) {
-			ret = cache->deallocate(node->key, node->value);
-			if (ret) {
-				pr_err("deallocate failed (key: %" PRIu64
-				       ", value: %" PRIuPTR ")\n",
-				       node->key, node->value);
-				return ret;
-			}
+		ret = lru_release_node(cache, node);
+		if (ret) {
+			/** the released node keeps its key and value */
+			pr_err("deallocate failed (key: %" PRIu64
+			       ", value: %" PRIuPTR ")\n",
+			       node->key, node->value);
+			return ret;
 		}
-		free(node);
 		node = next;
 	}
+	if (cache->flusher) {
+		struct lru_flusher *flusher = cache->flusher;
+		/** the flusher finishes the pending entries before exit */
+		pthread_mutex_lock(&flusher->mutex);
+		flusher->is_exit = 1;
+		pthread_cond_signal(&flusher->cond);
+		pthread_mutex_unlock(&flusher->mutex);
+		pthread_join(flusher->thread, NULL);
+		pthread_mutex_destroy(&flusher->mutex);
+		pthread_cond_destroy(&flusher->cond);
+		pthread_cond_destroy(&flusher->done_cond);
+		free(flusher);
+	}
+	free(cache->index);
+	free(cache->nodes);
 	free(cache);
 	return ret;
 }
+
+/**
+ * @brief set the number of the entries evicted at once
+ *
+ * @param cache LRU cache data structure pointer
+ * @param nr_entries number of the entries (1 to the capacity)
+ *
+ * @return 0 to success, -EINVAL for the invalid size
+ */
+int lru_set_evict_size(struct lru_cache *cache, const size_t nr_entries)
+{
+	if (nr_entries == 0 || nr_entries > cache->capacity) {
+		pr_err("invalid evict size (size: %zu, cap: %zu)\n", nr_entries,
+		       cache->capacity);
+		return -EINVAL;
+	}
+	cache->evict_size = nr_entries;
+	return 0;
+}
+
+/**
+ * @brief set the number of the entries evicted at once by the ratio
+ *
+ * @param cache LRU cache data structure pointer
+ * @param percent percentage of the capacity (1 to 100)
+ *
+ * @return 0 to success, -EINVAL for the invalid ratio
+ *
+ * @note
+ * At least one entry is evicted.
+ */
+int lru_set_evict_ratio(struct lru_cache *cache, const unsigned int percent)
+{
+	size_t nr_entries;
+	if (percent == 0 || percent > 100) {
+		pr_err("invalid evict ratio (percent: %u)\n", percent);
+		return -EINVAL;
+	}
+	nr_entries = cache->capacity * percent / 100;
+	return lru_set_evict_size(cache, nr_entries ? nr_entries : 1);
+}
+
+/**
+ * @brief start the flusher thread of the deferred entries
+ *
+ * @param cache LRU cache data structure pointer
+ * @param flush function which releases the deferred entry on the flusher
+ *
+ * @return 0 to success, negative number to fail
+ *
+ * @note
+ * When the deallocation function returns `LRU_DEALLOC_DEFER`, the entry is
+ * removed from the cache immediately and `flush` is called later on the
+ * flusher thread. A deferred entry can be missed by `lru_get()` before it
+ * is flushed; call `lru_flush()` before reading its backing store.
+ */
+int lru_set_flusher(struct lru_cache *cache, lru_dealloc_fn flush)
+{
+	struct lru_flusher *flusher;
+	int ret;
+
+	if (cache->flusher || flush == NULL) {
+		pr_err("invalid flusher (current: %p)\n", cache->flusher);
+		return -EINVAL;
+	}
+	flusher = (struct lru_flusher *)malloc(sizeof(struct lru_flusher));
+	if (flusher == NULL) {
+		pr_err("memory allocation failed\n");
+		return -ENOMEM;
+	}
+	memset(flusher, 0, sizeof(struct lru_flusher));
+	flusher->flush = flush;
+	pthread_mutex_init(&flusher->mutex, NULL);
+	pthread_cond_init(&flusher->cond, NULL);
+	pthread_cond_init(&flusher->done_cond, NULL);
+	ret = pthread_create(&flusher->thread, NULL, lru_flusher_thread,
+			     (void *)flusher);
+	if (ret) {
+		pr_err("flusher thread creation failed\n");
+		pthread_mutex_destroy(&flusher->mutex);
+		pthread_cond_destroy(&flusher->cond);
+		pthread_cond_destroy(&flusher->done_cond);
+		free(flusher);
+		return -ret;
+	}
+	cache->flusher = flusher;
+	return 0;
+}
+
+/**
+ * @brief wait until every deferred entry is flushed
+ *
+ * @param cache LRU cache data structure pointer
+ *
+ * @return 0 to success
+ */
+int lru_flush(struct lru_cache *cache)
+{
+	struct lru_flusher *flusher = cache->flusher;
+	if (flusher == NULL) {
+		return 0;
+	}
+	pthread_mutex_lock(&flusher->mutex);
+	while (flusher->nr_pending > 0) {
+		pthread_cond_wait(&flusher->done_cond, &flusher->mutex);
+	}
+	pthread_mutex_unlock(&flusher->mutex);
+	return 0;
+}
@@ -0,0 +1,304 @@
+/**
+ * @file sharded-cache.c
+ * @brief thread-safe cache which is sharded by the key
+ * @author Gijun Oh
+ * @version 0.2
+ * @date 2026-10-18
+ *
+ * @note
+ * Each shard is a `cache` with a reader-writer lock. The hits share the
+ * read lock and only peek the policy; they append the key to the shard's
+ * access buffer. The buffered hits are applied to the policy in a batch
+ * when the buffer is full or before the shard is modified. So, the policy
+ * sees nearly every hit while the hot keys are mostly read.
+ */
+#include "cache.h"
+
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * @brief select the shard of the key
+ *
+ * @param cache sharded cache data structure pointer
+ * @param key key which identifies the entry
+ *
+ * @return pointer of the shard
+ *
+ * @note
+ * The multiplier is different from the shard's index hash. Otherwise, the
+ * keys of a shard share the low bits and crowd into a part of the index.
+ */
+static inline struct cache_shard *
+sharded_cache_select(struct sharded_cache *cache, const uint64_t key)
+{
+	uint64_t hash = key * 0x9e3779b97f4a7c15ULL;
+	return &cache->shards[(size_t)(hash >> 32) % cache->nr_shards];
+}
+
+/**
+ * @brief apply the buffered hits of the shard to the policy
+ *
+ * @param shard shard whose write lock is held
+ *
+ * @note
+ * The removed keys are ignored by the policy.
+ */
+static void sharded_cache_drain(struct cache_shard *shard)
+{
+	size_t nr_accesses, i;
+
+	nr_accesses = __atomic_load_n(&shard->nr_accesses, __ATOMIC_RELAXED);
+	if (nr_accesses > SHARDED_CACHE_NR_ACCESSES) {
+		nr_accesses = SHARDED_CACHE_NR_ACCESSES;
+	}
+	for (i = 0; i < nr_accesses; i++) {
+		cache_get(shard->cache, shard->accesses[i]);
+	}
+	__atomic_store_n(&shard->nr_accesses, 0, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief record the hit while the read lock is held
+ *
+ * @param shard shard which has the key
+ * @param key key of the hit
+ *
+ * @return 1 when the buffer becomes full, 0 for otherwise
+ */
+static inline int sharded_cache_record(struct cache_shard *shard,
+				       const uint64_t key)
+{
+	size_t nr_accesses;
+
+	nr_accesses =
+		__atomic_fetch_add(&shard->nr_accesses, 1, __ATOMIC_RELAXED);
+	if (nr_accesses < SHARDED_CACHE_NR_ACCESSES) {
+		shard->accesses[nr_accesses] = key;
+	}
+	return nr_accesses + 1 == SHARDED_CACHE_NR_ACCESSES;
+}
+
+/**
+ * @brief promote the buffered hits if no one holds the shard
+ *
+ * @param shard shard whose buffer is full
+ *
+ * @note
+ * The hit never waits for the write lock. When the lock is busy, the next
+ * writer drains the buffer and the hits recorded meanwhile are lost.
+ */
+static void sharded_cache_try_drain(struct cache_shard *shard)
+{
+	if (pthread_rwlock_trywrlock(&shard->rwlock)) {
+		return;
+	}
+	sharded_cache_drain(shard);
+	pthread_rwlock_unlock(&shard->rwlock);
+}
+
+/**
+ * @brief initialize the sharded cache
+ *
+ * @param policy eviction policy of the shards (e.g., CACHE_POLICY_ARC)
+ * @param capacity total number of the entries
+ * @param nr_shards number of the shards (each has its own lock)
+ * @param deallocate deallocation function of the evicted value
+ *
+ * @return pointer of the sharded cache, NULL for fail
+ *
+ * @note
+ * The capacity is divided equally; a shard evicts its own entries even if
+ * the other shards have the free space.
+ */
+struct sharded_cache *sharded_cache_init(const int policy,
+					 const size_t capacity,
+					 const size_t nr_shards,
+					 lru_dealloc_fn deallocate)
+{
+	struct sharded_cache *cache;
+	size_t shard_capacity;
+	size_t i;
+
+	if (capacity == 0 || nr_shards == 0 || nr_shards > capacity) {
+		pr_err("invalid size (capacity: %zu, shards: %zu)\n", capacity,
+		       nr_shards);
+		return NULL;
+	}
+	shard_capacity = (capacity + nr_shards - 1) / nr_shards;
+
+	cache = (struct sharded_cache *)malloc(sizeof(struct sharded_cache));
+	if (cache == NULL) {
+		pr_err("memory allocation failed\n");
+		return NULL;
+	}
+	cache->nr_shards = nr_shards;
+	cache->capacity = shard_capacity * nr_shards;
+	/** each shard has its own cache line to avoid the false sharing */
+	if (posix_memalign((void **)&cache->shards,
+			   __alignof__(struct cache_shard),
+			   nr_shards * sizeof(struct cache_shard))) {
+		pr_err("memory allocation failed\n");
+		free(cache);
+		return NULL;
+	}
+	memset(cache->shards, 0, nr_shards * sizeof(struct cache_shard));
+
+	for (i = 0; i < nr_shards; i++) {
+		struct cache_shard *shard = &cache->shards[i];
+		shard->cache = cache_init(policy, shard_capacity, deallocate);
+		if (shard->cache == NULL) {
+			pr_err("cache initialization failed (shard: %zu)\n", i);
+			goto exception;
+		}
+		pthread_rwlock_init(&shard->rwlock, NULL);
+	}
+	return cache;
+
+exception:
+	sharded_cache_free(cache);
+	return NULL;
+}
+
+/**
+ * @brief insert the key, value to the sharded cache
+ *
+ * @param cache sharded cache data structure pointer
+ * @param key key which identifies the entry
+ * @param value value which contains the data
+ *
+ * @return 0 to success
+ *
+ * @note
+ * Same as `cache_put()`; the previous value of the key is replaced.
+ */
+int sharded_cache_put(struct sharded_cache *cache, const uint64_t key,
+		      uintptr_t value)
+{
+	struct cache_shard *shard = sharded_cache_select(cache, key);
+	int ret;
+
+	pthread_rwlock_wrlock(&shard->rwlock);
+	sharded_cache_drain(shard);
+	ret = cache_put(shard->cache, key, value);
+	pthread_rwlock_unlock(&shard->rwlock);
+	return ret;
+}
+
+/**
+ * @brief get data from the sharded cache
+ *
+ * @param cache sharded cache data structure pointer
+ * @param key key which identifies the entry
+ *
+ * @return data in the entry's value (0 when the key doesn't exist)
+ *
+ * @note
+ * The value can be evicted and deallocated by the other threads as soon as
+ * this returns. Use `sharded_cache_access()` when the value is a pointer.
+ */
+uintptr_t sharded_cache_get(struct sharded_cache *cache, const uint64_t key)
+{
+	struct cache_shard *shard = sharded_cache_select(cache, key);
+	uintptr_t value;
+	int is_full = 0;
+
+	pthread_rwlock_rdlock(&shard->rwlock);
+	value = cache_peek(shard->cache, key);
+	if (value) {
+		is_full = sharded_cache_record(shard, key);
+	}
+	pthread_rwlock_unlock(&shard->rwlock);
+
+	if (is_full) {
+		sharded_cache_try_drain(shard);
+	}
+	return value;
+}
+
+/**
+ * @brief run the function on the entry while it cannot be evicted
+ *
+ * @param cache sharded cache data structure pointer
+ * @param key key which identifies the entry
+ * @param access function which receives the key, value and `data`
+ * @param data private data of the function
+ *
+ * @return return value of the function, -ENOENT when the key doesn't exist
+ *
+ * @note
+ * The function runs under the shard's read lock. So, the concurrent
+ * accesses of a shard can run at the same time; the function must not
+ * modify the value and must not call the cache's functions.
+ */
+int sharded_cache_access(struct sharded_cache *cache, const uint64_t key,
+			 cache_access_fn access, void *data)
+{
+	struct cache_shard *shard = sharded_cache_select(cache, key);
+	uintptr_t value;
+	int is_full = 0;
+	int ret = -ENOENT;
+
+	pthread_rwlock_rdlock(&shard->rwlock);
+	value = cache_peek(shard->cache, key);
+	if (value) {
+		ret = access(key, value, data);
+		is_full = sharded_cache_record(shard, key);
+	}
+	pthread_rwlock_unlock(&shard->rwlock);
+
+	if (is_full) {
+		sharded_cache_try_drain(shard);
+	}
+	return ret;
+}
+
+/**
+ * @brief delete the entry from the sharded cache
+ *
+ * @param cache sharded cache data structure pointer
+ * @param key key which identifies the entry
+ *
+ * @return 0 to success, -ENOENT when the key doesn't exist
+ */
+int sharded_cache_delete(struct sharded_cache *cache, const uint64_t key)
+{
+	struct cache_shard *shard = sharded_cache_select(cache, key);
+	int ret;
+
+	pthread_rwlock_wrlock(&shard->rwlock);
+	ret = cache_delete(shard->cache, key);
+	pthread_rwlock_unlock(&shard->rwlock);
+	return ret;
+}
+
+/**
+ * @brief deallocate the sharded cache
+ *
+ * @param cache sharded cache data structure pointer
+ *
+ * @return 0 to success
+ *
+ * @note
+ * The remaining values are deallocated. No thread may use the cache.
+ */
+int sharded_cache_free(struct sharded_cache *cache)
+{
+	size_t i;
+
+	if (cache == NULL) {
+		return 0;
+	}
+	for (i = 0; i < cache->nr_shards; i++) {
+		struct cache_shard *shard = &cache->shards[i];
+		if (shard->cache == NULL) {
+			break;
+		}
+		cache_free(shard->cache);
+		pthread_rwlock_destroy(&shard->rwlock);
+	}
+	free(cache->shards);
+	free(cache);
+	return 0;
+}